@@ -0,0 +1,75 @@
+#include "bench.h"
+#include "dxut\animation.h"
+
+namespace {
+	XMVECTOR axis_angle(float x, float y, float z, float angle) {
+		return XMQuaternionRotationAxis(XMVector3Normalize(XMVectorSet(x, y, z, 0.f)), angle);
+	}
+
+	//a baked cycle as exporters hand it over: a quarter of the joints hold still, the rest swing at their
+	//own rate, a third keep a fixed offset and the others bob around, and no joint is ever scaled
+	raw_animation test_animation(uint32_t joint_count, uint32_t frame_count) {
+		raw_animation raw;
+		raw.sample_rate = 30.f;
+		raw.joint_count = joint_count;
+		raw.frame_count = frame_count;
+		raw.poses.resize((size_t)joint_count * frame_count);
+		for (uint32_t f = 0; f < frame_count; ++f) {
+			float t = f / raw.sample_rate;
+			for (uint32_t j = 0; j < joint_count; ++j) {
+				joint_pose& p = raw.poses[(size_t)f * joint_count + j];
+				XMVECTOR q = j % 4 == 0 ? axis_angle(0.f, 1.f, 0.f, .3f) : axis_angle(1.f, (float)j, .5f, 1.5f * sinf(t * (1.f + j * .1f)));
+				XMStoreFloat4(&p.rotation, q);
+				p.translation = j % 3 == 0 ? XMFLOAT3(0.f, 1.f, 0.f) : XMFLOAT3(sinf(t), .5f * cosf(2.f * t), .1f * t);
+				p.scale = XMFLOAT3(1.f, 1.f, 1.f);
+			}
+		}
+		return raw;
+	}
+}
+
+//memory of a clip against its raw frames, and sampling rates: one character playing forward with a cursor,
+//one seeking at random without one, and a crowd sampled and blended in parallel at every thread count
+BENCHMARK(animation) {
+	struct { uint32_t joints, frames; } sizes[] = { { 64, 300 }, { 128, 1800 } };
+	for (auto s : sizes) {
+		raw_animation raw = test_animation(s.joints, s.frames);
+		animation_clip clip;
+		double compress_ms = time_ms([&] { clip = animation_clip(raw); }, 3);
+		size_t raw_bytes = raw.poses.size() * sizeof(joint_pose);
+		printf("  %4u joints %5u frames  raw %9zu bytes  clip %8zu bytes (%4.1f%%)  %8zu keys  compress %7.1f ms\n", s.joints, s.frames,
+			raw_bytes, clip.memory_size(), 100. * clip.memory_size() / raw_bytes, clip.key_count(), compress_ms);
+
+		//every pose goes into its own slot, so none of the sampling can be optimized away
+		const uint32_t poses = 4096;
+		vector<joint_pose> out((size_t)poses * s.joints);
+		keep(out.data());
+		animation_cursor cursor;
+		double forward_ms = time_ms([&] {
+			for (uint32_t i = 0; i < poses; ++i) sample_animation(clip, clip.duration * i / poses, &out[(size_t)i * s.joints], &cursor);
+		});
+		double seek_ms = time_ms([&] {
+			for (uint32_t i = 0; i < poses; ++i) sample_animation(clip, clip.duration * (i * 2654435761u % poses) / poses, &out[(size_t)i * s.joints]);
+		});
+		printf("  %4u joints  forward %9.0f poses/s %7.1f M joint samples/s  seek %9.0f poses/s %7.1f M joint samples/s\n", s.joints,
+			poses / (forward_ms * 1e-3), poses * s.joints / (forward_ms * 1e3), poses / (seek_ms * 1e-3), poses * s.joints / (seek_ms * 1e3));
+
+		//a crowd where every character plays the clip at its own time and is blended halfway towards the next one
+		vector<joint_pose> blended(out.size());
+		keep(blended.data());
+		vector<animation_cursor> cursors(poses);
+		vector<animation_sample_job> sample_jobs(poses);
+		vector<pose_blend_job> blend_jobs(poses - 1);
+		for (uint32_t i = 0; i < poses; ++i) sample_jobs[i] = { &clip, clip.duration * (i % 97) / 97.f, &out[(size_t)i * s.joints], &cursors[i] };
+		for (uint32_t i = 0; i + 1 < poses; ++i) blend_jobs[i] = { &out[(size_t)i * s.joints], &out[(size_t)(i + 1) * s.joints], .5f, s.joints, &blended[(size_t)i * s.joints] };
+		for (uint32_t threads : thread_counts()) {
+			double sample_ms = 0., blend_ms = 0.;
+			with_threads(threads, [&] {
+				sample_ms = time_ms([&] { sample_animations(sample_jobs); });
+				blend_ms = time_ms([&] { blend_poses(blend_jobs); });
+			});
+			printf("  %4u joints  %2u threads  sample %9.0f poses/s  blend %9.0f poses/s\n", s.joints, threads,
+				poses / (sample_ms * 1e-3), blend_jobs.size() / (blend_ms * 1e-3));
+		}
+	}
+}
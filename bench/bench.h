@@ -0,0 +1,48 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+//CPU-only benchmarks of the library; none of them creates a device, so they run on any machine the library
+//builds on. Each file in bench/ adds its cases with BENCHMARK, and the executable runs every case whose
+//name contains the first command line argument (all of them without one)
+typedef void(*benchmark_function)();
+void register_benchmark(const char* name, benchmark_function f);
+
+struct benchmark_registration {
+	benchmark_registration(const char* name, benchmark_function f) { register_benchmark(name, f); }
+};
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static benchmark_registration name##_registration(#name, name); \
+	static void name()
+
+//median wall time of reps runs of f in milliseconds, after one run to warm caches and allocators up
+template <typename F>
+double time_ms(F&& f, int reps = 5) {
+	f();
+	vector<double> t(reps);
+	for (auto& x : t) {
+		auto start = chrono::high_resolution_clock::now();
+		f();
+		x = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
+	nth_element(t.begin(), t.begin() + reps / 2, t.end());
+	return t[reps / 2];
+}
+
+//runs f with parallel_for limited to threads workers
+void with_threads(uint32_t threads, const function<void()>& f);
+//1, 2, 4, ... up to the hardware thread count, which is always the last entry
+vector<uint32_t> thread_counts();
+
+//current and peak working set of the process in bytes; the peak never goes down, so cases that report it
+//should run in their own process (pass the case name on the command line)
+size_t working_set_bytes();
+size_t peak_working_set_bytes();
+
+//keeps the optimizer from dropping work whose result is otherwise unused
+void keep(const void* p);
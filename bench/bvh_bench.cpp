@@ -0,0 +1,91 @@
+#include "bench.h"
+#include "dxut\bvh.h"
+#include <random>
+
+namespace {
+	//what picking did before the bvh: Moller-Trumbore against every triangle
+	bool brute_force(const mesh_data& D, FXMVECTOR origin, FXMVECTOR direction, float t_max, ray_hit& hit) {
+		const auto& vertices = get<0>(D);
+		const auto& indices = get<1>(D);
+		bool found = false;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[i]].position);
+			XMVECTOR e1 = XMLoadFloat3(&vertices[indices[i + 1]].position) - p0, e2 = XMLoadFloat3(&vertices[indices[i + 2]].position) - p0;
+			XMVECTOR pv = XMVector3Cross(direction, e2);
+			float det = XMVectorGetX(XMVector3Dot(e1, pv));
+			if (det == 0.f) continue;
+			float inv = 1.f / det;
+			XMVECTOR tv = origin - p0;
+			float u = XMVectorGetX(XMVector3Dot(tv, pv)) * inv;
+			if (u < 0.f || u > 1.f) continue;
+			XMVECTOR qv = XMVector3Cross(tv, e1);
+			float v = XMVectorGetX(XMVector3Dot(direction, qv)) * inv;
+			if (v < 0.f || u + v > 1.f) continue;
+			float t = XMVectorGetX(XMVector3Dot(e2, qv)) * inv;
+			if (t < 0.f || t > t_max) continue;
+			t_max = t;
+			hit = { t, (uint32_t)(i / 3), u, v };
+			found = true;
+		}
+		return found;
+	}
+
+	//rays from a shell around the mesh towards points near its center, so most of them hit
+	void make_rays(size_t count, vector<XMFLOAT3>& origins, vector<XMFLOAT3>& directions) {
+		mt19937 rng(7);
+		uniform_real_distribution<float> u(-1.f, 1.f);
+		origins.resize(count);
+		directions.resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			XMVECTOR o = XMVector3Normalize(XMVectorSet(u(rng), u(rng), u(rng), 0.f)) * 3.f;
+			XMVECTOR target = XMVectorSet(u(rng), u(rng), u(rng), 0.f) * .5f;
+			XMStoreFloat3(&origins[i], o);
+			XMStoreFloat3(&directions[i], XMVector3Normalize(target - o));
+		}
+	}
+}
+
+//build time, and closest hit and any hit queries per second, for a sphere with a few hundred thousand
+//triangles; brute force only gets a few hundred rays, it is that slow
+BENCHMARK(bvh) {
+	uint32_t sizes[] = { 100, 300 };
+	for (uint32_t n : sizes) {
+		mesh_data D = generate_sphere_mesh(1.f, 2 * n, n);
+		size_t triangles = get<1>(D).size() / 3;
+		vector<XMFLOAT3> origins, directions;
+		make_rays(1 << 18, origins, directions);
+
+		//every query stores its result, so none of them can be optimized away
+		vector<float> t(origins.size());
+		keep(t.data());
+		size_t brute_rays = 256;
+		double brute_ms = time_ms([&] {
+			ray_hit hit;
+			for (size_t i = 0; i < brute_rays; ++i)
+				t[i] = brute_force(D, XMLoadFloat3(&origins[i]), XMLoadFloat3(&directions[i]), FLT_MAX, hit) ? hit.t : -1.f;
+		}, 1);
+		printf("  %7zu triangles  brute force %12.0f rays/s\n", triangles, brute_rays / (brute_ms * 1e-3));
+
+		for (uint32_t threads : thread_counts()) {
+			mesh_bvh bvh;
+			double build_ms = 0., closest_ms = 0., any_ms = 0.;
+			with_threads(threads, [&] {
+				build_ms = time_ms([&] { bvh = mesh_bvh(D); }, 3);
+				closest_ms = time_ms([&] {
+					parallel_for(size_t(0), origins.size(), [&](size_t i) {
+						ray_hit hit;
+						t[i] = bvh.intersect(XMLoadFloat3(&origins[i]), XMLoadFloat3(&directions[i]), FLT_MAX, hit) ? hit.t : -1.f;
+					});
+				}, 3);
+				any_ms = time_ms([&] {
+					parallel_for(size_t(0), origins.size(), [&](size_t i) {
+						XMVECTOR o = XMLoadFloat3(&origins[i]);
+						t[i] = bvh.occluded(o, o + XMLoadFloat3(&directions[i]) * 6.f) ? 1.f : 0.f;
+					});
+				}, 3);
+			});
+			printf("  %7zu triangles  %2u threads  build %7.1f ms  closest hit %12.0f rays/s  any hit %12.0f rays/s\n",
+				triangles, threads, build_ms, origins.size() / (closest_ms * 1e-3), origins.size() / (any_ms * 1e-3));
+		}
+	}
+}
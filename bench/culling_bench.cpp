@@ -0,0 +1,61 @@
+#include "bench.h"
+#include "dxut\culling.h"
+#include "dxut\cpu_features.h"
+#include <random>
+
+namespace {
+	const char* level_name(simd_level l) {
+		const char* names[] = { "scalar", "sse", "avx2", "avx512" };
+		return names[(int)l];
+	}
+
+	vector<simd_level> supported_levels() {
+		const cpu_features& f = get_cpu_features();
+		vector<simd_level> levels = { simd_level::scalar, simd_level::sse };
+		if (f.avx2 && f.fma) levels.push_back(simd_level::avx2);
+		if (f.avx512f && f.avx2 && f.fma) levels.push_back(simd_level::avx512);
+		return levels;
+	}
+
+	//objects scattered through a cube around a camera at its center, of which the 60 degree frustum sees about a tenth
+	template <typename F>
+	void run_cull(const char* kind, F add_bounds) {
+		XMMATRIX view = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.f, 0.f, 1.f, 0.f), XMVectorSet(0.f, 1.f, 0.f, 0.f));
+		frustum_planes frustum = extract_frustum_planes(view * XMMatrixPerspectiveFovLH(XMConvertToRadians(60.f), 16.f / 9.f, .1f, 1000.f));
+		simd_level initial = max_simd_level();
+
+		size_t counts[] = { 10000, 100000, 1000000 };
+		for (size_t count : counts) {
+			mt19937 rng(11);
+			uniform_real_distribution<float> position(-1000.f, 1000.f), size(.5f, 5.f);
+			auto bounds = add_bounds(count, rng, position, size);
+			vector<uint32_t> visible;
+			for (simd_level level : supported_levels()) {
+				set_max_simd_level(level);
+				for (uint32_t threads : thread_counts()) {
+					double ms = 0.;
+					with_threads(threads, [&] { ms = time_ms([&] { cull(frustum, bounds, visible); }, 11); });
+					printf("  %-7s %8zu objects  %-6s %2u threads  %7.3f ms  %7zu visible\n", kind, count, level_name(level), threads, ms, visible.size());
+				}
+			}
+		}
+		set_max_simd_level(initial);
+	}
+}
+
+BENCHMARK(culling) {
+	run_cull("spheres", [](size_t count, mt19937& rng, uniform_real_distribution<float>& position, uniform_real_distribution<float>& size) {
+		sphere_bounds_soa spheres;
+		spheres.resize(count);
+		for (size_t i = 0; i < count; ++i)
+			spheres.set(i, BoundingSphere(XMFLOAT3(position(rng), position(rng), position(rng)), size(rng)));
+		return spheres;
+	});
+	run_cull("boxes", [](size_t count, mt19937& rng, uniform_real_distribution<float>& position, uniform_real_distribution<float>& size) {
+		box_bounds_soa boxes;
+		boxes.resize(count);
+		for (size_t i = 0; i < count; ++i)
+			boxes.set(i, BoundingBox(XMFLOAT3(position(rng), position(rng), position(rng)), XMFLOAT3(size(rng), size(rng), size(rng))));
+		return boxes;
+	});
+}
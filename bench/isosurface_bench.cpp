@@ -0,0 +1,44 @@
+#include "bench.h"
+#include "dxut\isosurface.h"
+
+namespace {
+	//a sphere with a ripple on it, so the surface crosses cells at every orientation
+	float rippled_sphere(const XMFLOAT3& p) {
+		return sqrtf(p.x * p.x + p.y * p.y + p.z * p.z) - 1.f + .05f * sinf(8.f * p.x) * sinf(8.f * p.y) * sinf(8.f * p.z);
+	}
+
+	bool identical(const mesh_data& a, const mesh_data& b) {
+		return get<0>(a).size() == get<0>(b).size() && get<1>(a) == get<1>(b)
+			&& memcmp(get<0>(a).data(), get<0>(b).data(), get<0>(a).size() * sizeof(vertex)) == 0;
+	}
+}
+
+//meshing of a sampled grid, and of the field callback (which samples the grid first), at every thread count;
+//the output of every thread count is compared against the single threaded one
+BENCHMARK(isosurface) {
+	uint32_t sizes[] = { 64, 128, 256 };
+	for (uint32_t n : sizes) {
+		XMUINT3 dims(n, n, n);
+		XMFLOAT3 origin(-1.25f, -1.25f, -1.25f);
+		float spacing = 2.5f / (n - 1);
+		vector<float> samples((size_t)n * n * n);
+		for (uint32_t z = 0; z < n; ++z)
+			for (uint32_t y = 0; y < n; ++y)
+				for (uint32_t x = 0; x < n; ++x)
+					samples[((size_t)z * n + y) * n + x] = rippled_sphere(XMFLOAT3(origin.x + x * spacing, origin.y + y * spacing, origin.z + z * spacing));
+		double mcells = pow(n - 1., 3.) * 1e-6;
+
+		mesh_data reference;
+		for (uint32_t threads : thread_counts()) {
+			mesh_data D;
+			double grid_ms = 0., field_ms = 0.;
+			with_threads(threads, [&] {
+				grid_ms = time_ms([&] { D = generate_isosurface_mesh(samples.data(), dims, origin, spacing); }, 3);
+				field_ms = time_ms([&] { keep(get<0>(generate_isosurface_mesh(rippled_sphere, dims, origin, spacing)).data()); }, 3);
+			});
+			if (get<0>(reference).empty()) reference = D;
+			printf("  %4u^3  %2u threads  %8zu triangles  grid %8.1f ms %7.1f Mcells/s  field %8.1f ms  %s\n", n, threads,
+				get<1>(D).size() / 3, grid_ms, mcells / (grid_ms * 1e-3), field_ms, identical(D, reference) ? "identical" : "DIFFERS");
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#include "bench.h"
+#include <cstring>
+#include <psapi.h>
+
+namespace {
+	struct benchmark {
+		const char* name;
+		benchmark_function run;
+	};
+	vector<benchmark>& benchmarks() {
+		static vector<benchmark> all;
+		return all;
+	}
+	volatile const void* sink;
+}
+
+void register_benchmark(const char* name, benchmark_function f) {
+	benchmarks().push_back({ name, f });
+}
+
+void with_threads(uint32_t threads, const function<void()>& f) {
+	CurrentScheduler::Create(SchedulerPolicy(2, MinConcurrency, threads, MaxConcurrency, threads));
+	f();
+	CurrentScheduler::Detach();
+}
+
+vector<uint32_t> thread_counts() {
+	uint32_t hw = max(1u, thread::hardware_concurrency());
+	vector<uint32_t> counts;
+	for (uint32_t n = 1; n < hw; n *= 2) counts.push_back(n);
+	counts.push_back(hw);
+	return counts;
+}
+
+size_t working_set_bytes() {
+	PROCESS_MEMORY_COUNTERS c = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &c, sizeof(c));
+	return c.WorkingSetSize;
+}
+
+size_t peak_working_set_bytes() {
+	PROCESS_MEMORY_COUNTERS c = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &c, sizeof(c));
+	return c.PeakWorkingSetSize;
+}
+
+void keep(const void* p) {
+	sink = p;
+}
+
+int main(int argc, char** argv) {
+	const char* filter = argc > 1 ? argv[1] : "";
+	for (auto& b : benchmarks()) {
+		if (!strstr(b.name, filter)) continue;
+		printf("%s\n", b.name);
+		b.run();
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include "bench.h"
+#include "dxut\mesh.h"
+
+namespace {
+	//the generators as they were before they were pre-sized and split across threads, one push_back and
+	//one sinf/cosf per vertex, kept here as the baseline and as the reference for bit-identical output
+	mesh_data scalar_sphere(float radius, uint32_t Islices, uint32_t Istacks) {
+		vector<vertex> vertices; vector<uint32_t> indices;
+		vertices.push_back(vertex(0.f, radius, 0.f, 0.f, 1.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f));
+
+		auto slices = (float)Islices, stacks = (float)Istacks;
+		float dphi = XM_PI/stacks;
+		float dtheta = XM_2PI/slices;
+
+		for (uint32_t i = 1; i <= stacks-1; ++i) {
+			float phi = i*dphi;
+			for (uint32_t j = 0; j <= slices; ++j) {
+				float theta = j*dtheta;
+				auto P = XMVectorSet(radius*sinf(phi)*cosf(theta), radius*cosf(phi), radius*sinf(phi)*sinf(theta), 1.f);
+				auto T = XMVectorSet(-radius*sinf(phi)*sinf(theta), 0.f, radius*sinf(phi)*cosf(theta), 0.f);
+				vertices.push_back(vertex(P, XMVector3Normalize(P), XMVectorSet(theta/XM_2PI, phi/XM_PI, 0.f, 0.f), XMVector3Normalize(T)));
+			}
+		}
+		vertices.push_back(vertex(0.f, -radius, 0.f, 0.f, -1.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f));
+
+		for (uint32_t i = 1; i <= slices; ++i) {
+			indices.push_back(0);
+			indices.push_back(i+1);
+			indices.push_back(i);
+		}
+		uint32_t baseIndex = 1;
+		uint32_t ringVertexCount = Islices + 1;
+		for (uint32_t i = 0; i < stacks-2; ++i) {
+			for (uint32_t j = 0; j < slices; ++j) {
+				indices.push_back(baseIndex + i*ringVertexCount + j);
+				indices.push_back(baseIndex + i*ringVertexCount + j+1);
+				indices.push_back(baseIndex + (i+1)*ringVertexCount + j);
+				indices.push_back(baseIndex + (i+1)*ringVertexCount + j);
+				indices.push_back(baseIndex + i*ringVertexCount + j+1);
+				indices.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
+			}
+		}
+		uint32_t spix = (uint32_t)vertices.size()-1;
+		baseIndex = spix - ringVertexCount;
+		for (uint32_t i = 0; i < slices; ++i) {
+			indices.push_back(spix);
+			indices.push_back(baseIndex+i);
+			indices.push_back(baseIndex+i+1);
+		}
+		return{ vertices, indices };
+	}
+
+	//the old plane indexed with 16 bit row offsets and swapped rows and columns, so it is only a valid
+	//reference for square grids below 256 x 256
+	mesh_data scalar_plane(XMFLOAT2 dims, XMFLOAT2 div, XMFLOAT3 norm) {
+		vector<vertex> vertices; vector<uint32_t> indices;
+		XMVECTOR nw = XMVector3Normalize(XMLoadFloat3(&norm));
+		XMVECTOR t = (fabsf(XMVectorGetX(nw)) > .1 ? XMVectorSet(0, 1, 0, 0) : XMVectorSet(1, 0, 0, 0));
+		XMVECTOR nu = XMVector3Normalize(XMVector3Cross(t, nw));
+		XMVECTOR nv = XMVector3Cross(nw, nu);
+		XMFLOAT2 hdims{ .5f*dims.x, .5f*dims.y };
+		XMVECTOR divm1 = XMVectorSet(div.x - 1.f, div.y - 1.f, 0.f, 0.f);
+		XMVECTOR dxy = XMLoadFloat2(&dims) / divm1;
+		XMVECTOR duv = XMVectorReciprocal(divm1);
+
+		for (float i = 0; i < div.y; ++i) {
+			float y = hdims.y - i*XMVectorGetY(dxy);
+			for (float j = 0; j < div.x; ++j) {
+				float x = hdims.x - j*XMVectorGetX(dxy);
+				XMVECTOR p = nu*x + nv*y;
+				XMVECTOR tx = XMVectorSet(j, i, 0, 0)*duv;
+				vertices.push_back(vertex(p, -nw, tx, nu));
+			}
+		}
+		for (uint32_t i = 0; i < div.x - 1; ++i) {
+			for (uint32_t j = 0; j < div.y - 1; ++j) {
+				indices.push_back(i*(uint16_t)div.y + j);
+				indices.push_back(i*(uint16_t)div.y + j + 1);
+				indices.push_back((i + 1)*(uint16_t)div.y + j);
+				indices.push_back((i + 1)*(uint16_t)div.y + j);
+				indices.push_back(i*(uint16_t)div.y + j + 1);
+				indices.push_back((i + 1)*(uint16_t)div.y + j + 1);
+			}
+		}
+		reverse(indices.begin(), indices.end());
+		return{ vertices, indices };
+	}
+
+	bool identical(const mesh_data& a, const mesh_data& b) {
+		auto& va = get<0>(a); auto& vb = get<0>(b);
+		auto& ia = get<1>(a); auto& ib = get<1>(b);
+		return va.size() == vb.size() && ia.size() == ib.size() &&
+			memcmp(va.data(), vb.data(), va.size() * sizeof(vertex)) == 0 &&
+			memcmp(ia.data(), ib.data(), ia.size() * sizeof(uint32_t)) == 0;
+	}
+}
+
+BENCHMARK(sphere_generator) {
+	uint32_t sizes[] = { 64, 256, 1024 };
+	for (uint32_t n : sizes) {
+		mesh_data a, b;
+		double scalar = time_ms([&] { a = scalar_sphere(1.f, 2 * n, n); });
+		double current = time_ms([&] { b = generate_sphere_mesh(1.f, 2 * n, n); });
+		printf("  %4u x %4u  %8zu vertices  scalar %8.2f ms  generate_sphere_mesh %8.2f ms  %5.1fx  %s\n", 2 * n, n,
+			get<0>(b).size(), scalar, current, scalar / current, identical(a, b) ? "identical" : "DIFFERENT");
+	}
+}
+
+BENCHMARK(plane_generator) {
+	//one axis aligned and one oblique normal, the latter exercising every component of the basis
+	XMFLOAT3 normals[] = { XMFLOAT3(0, 1, 0), XMFLOAT3(.3f, .8f, -.5f) };
+	uint32_t sizes[] = { 64, 255 };
+	for (auto& nrm : normals) {
+		for (uint32_t n : sizes) {
+			XMFLOAT2 div((float)n, (float)n);
+			mesh_data a, b;
+			double scalar = time_ms([&] { a = scalar_plane(XMFLOAT2(10, 10), div, nrm); });
+			double current = time_ms([&] { b = generate_plane_mesh(XMFLOAT2(10, 10), div, nrm); });
+			printf("  normal (%g %g %g)  %4u x %4u  scalar %7.2f ms  generate_plane_mesh %7.2f ms  %5.1fx  %s\n", nrm.x, nrm.y, nrm.z,
+				n, n, scalar, current, scalar / current, identical(a, b) ? "identical" : "DIFFERENT");
+		}
+	}
+	//sizes the old generator could not index
+	for (uint32_t n : { 1024u, 2048u }) {
+		XMFLOAT2 div((float)n, (float)n);
+		mesh_data b;
+		double current = time_ms([&] { b = generate_plane_mesh(XMFLOAT2(10, 10), div); }, 3);
+		printf("  %4u x %4u  generate_plane_mesh %8.2f ms  %zu indices\n", n, n, current, get<1>(b).size());
+	}
+}
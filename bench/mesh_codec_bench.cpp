@@ -0,0 +1,33 @@
+#include "bench.h"
+#include "dxut\mesh_codec.h"
+#include "dxut\mesh_optimize.h"
+
+BENCHMARK(mesh_codec_decode) {
+	uint32_t sizes[] = { 100, 300, 1000 };
+	for (uint32_t n : sizes) {
+		mesh_data D = generate_sphere_mesh(1.f, 2 * n, n);
+		optimize_vertex_cache(D);
+		optimize_vertex_fetch(D);
+		const auto& vertices = get<0>(D);
+		const auto& indices = get<1>(D);
+		size_t raw_vertices = vertices.size() * sizeof(vertex), raw_indices = indices.size() * sizeof(uint32_t);
+
+		vector<uint8_t> vblob, iblob;
+		double encode = time_ms([&] {
+			vblob.clear();
+			iblob.clear();
+			encode_vertex_buffer(vertices.data(), vertices.size(), sizeof(vertex), vblob);
+			encode_index_buffer(indices.data(), indices.size(), iblob);
+		}, 3);
+
+		vector<vertex> v(vertices.size());
+		vector<uint32_t> i(indices.size());
+		double vertex_ms = time_ms([&] { decode_vertex_buffer(vblob.data(), vblob.size(), v.data(), v.size(), sizeof(vertex)); });
+		double index_ms = time_ms([&] { decode_index_buffer(iblob.data(), iblob.size(), i.data(), i.size(), v.size()); });
+
+		//throughput is counted in decoded (raw) bytes
+		printf("  %8zu vertices  ratio vertices %.2f indices %.2f  encode %7.1f ms  decode vertices %5.2f GB/s indices %5.2f GB/s"
+			"  mesh %5.2f GB/s\n", vertices.size(), (double)vblob.size() / raw_vertices, (double)iblob.size() / raw_indices, encode,
+			raw_vertices / vertex_ms * 1e-6, raw_indices / index_ms * 1e-6, (raw_vertices + raw_indices) / (vertex_ms + index_ms) * 1e-6);
+	}
+}
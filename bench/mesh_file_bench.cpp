@@ -0,0 +1,88 @@
+#include "bench.h"
+#include "dxut\mesh_file.h"
+#include <fstream>
+
+namespace {
+	wstring temp_mesh_path(const wchar_t* name) {
+		wchar_t dir[MAX_PATH];
+		GetTempPathW(MAX_PATH, dir);
+		return wstring(dir) + name;
+	}
+
+	//what every mesh went through before the mesh file: read into vectors, then copied into upload memory
+	void load_through_vectors(const wstring& path, uint8_t* upload) {
+		ifstream in(path, ios::binary);
+		mesh_file_header h;
+		in.read((char*)&h, sizeof(h));
+		vector<vertex> vertices((size_t)h.vertex_count);
+		vector<uint8_t> indices((size_t)h.index_size);
+		in.seekg(h.vertex_offset);
+		in.read((char*)vertices.data(), h.vertex_size);
+		in.seekg(h.index_offset);
+		in.read((char*)indices.data(), h.index_size);
+		memcpy(upload, vertices.data(), (size_t)h.vertex_size);
+		memcpy(upload + aligned_size256(h.vertex_size), indices.data(), indices.size());
+		BoundingBox box;
+		BoundingSphere sphere;
+		compute_bounds(vertices.data(), vertices.size(), sizeof(vertex), box, sphere);
+	}
+
+	//the CPU side of mesh::create_from_file: map, validate, copy both sections, compute bounds in place
+	void load_mapped(const wstring& path, uint8_t* upload) {
+		mapped_mesh_file file(path);
+		const mesh_file_header& h = file.header();
+		file.copy_vertices(upload);
+		file.copy_indices(upload + aligned_size256(h.vertex_size));
+		BoundingBox box;
+		BoundingSphere sphere;
+		compute_bounds(file.vertices(), (size_t)h.vertex_count, h.vertex_stride, box, sphere);
+	}
+
+	wstring bench_file_path() {
+		return temp_mesh_path(L"dxut_bench_mesh_file.dxmesh");
+	}
+
+	void write_bench_file() {
+		write_mesh_file(bench_file_path(), generate_sphere_mesh(1.f, 2000, 1000));
+	}
+
+	//both paths read the file from the OS file cache; upload stands in for a persistently mapped upload
+	//heap and is touched before timing. The process peak working set only ever grows, so the growth of
+	//the peak over the working set before the load is only known when the load sets a new peak, which
+	//takes running the case in its own process after mesh_file_write
+	template <typename F>
+	void run_load(const char* name, F load) {
+		wstring path = bench_file_path();
+		if (GetFileAttributesW(path.c_str()) == INVALID_FILE_ATTRIBUTES) write_bench_file();
+		mesh_file_header h;
+		{
+			mapped_mesh_file file(path);
+			h = file.header();
+		}
+		vector<uint8_t> upload(aligned_size256(h.vertex_size) + h.index_size, 1);
+
+		size_t before = working_set_bytes(), peak_before = peak_working_set_bytes();
+		double ms = time_ms([&] { load(path, upload.data()); });
+		size_t peak = peak_working_set_bytes();
+		double mb = (double)(h.vertex_size + h.index_size) / (1 << 20);
+		printf("  %-8s %7.1f MB  %7.2f ms  %6.2f GB/s  ", name, mb, ms, mb / 1024. / (ms * 1e-3));
+		if (peak > peak_before) printf("peak working set +%.1f MB\n", (double)(peak - before) / (1 << 20));
+		else printf("peak working set unknown, run the case on its own\n");
+	}
+}
+
+//for the peak working set, run each step as its own process:
+//  bench mesh_file_write && bench mesh_file_load_vectors && bench mesh_file_load_mapped
+//the file stays in the temp directory for the next run
+BENCHMARK(mesh_file_write) {
+	double ms = time_ms([] { write_bench_file(); }, 1);
+	printf("  wrote %ls in %.1f ms\n", bench_file_path().c_str(), ms);
+}
+
+BENCHMARK(mesh_file_load_vectors) {
+	run_load("vectors", load_through_vectors);
+}
+
+BENCHMARK(mesh_file_load_mapped) {
+	run_load("mapped", load_mapped);
+}
@@ -0,0 +1,106 @@
+#include "bench.h"
+#include "dxut\mesh_import.h"
+#include <fstream>
+
+namespace {
+	//a sphere written the way exporters write it: one v/vt/vn line each per vertex, faces as v/vt/vn triples
+	string obj_text(const mesh_data& D) {
+		const auto& vertices = get<0>(D);
+		const auto& indices = get<1>(D);
+		string text;
+		text.reserve(vertices.size() * 110 + indices.size() * 12);
+		char line[128];
+		for (const auto& v : vertices) {
+			text.append(line, snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", v.position.x, v.position.y, v.position.z));
+			text.append(line, snprintf(line, sizeof(line), "vt %.6f %.6f\n", v.texcoord.x, 1.f - v.texcoord.y));
+			text.append(line, snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", v.normal.x, v.normal.y, v.normal.z));
+		}
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			uint32_t a = indices[i] + 1, b = indices[i + 1] + 1, c = indices[i + 2] + 1;
+			text.append(line, snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c));
+		}
+		return text;
+	}
+
+	//the same sphere as a .glb: positions, normals and texcoords in separate views, 32 bit indices
+	size_t write_glb(const wstring& path, const mesh_data& D) {
+		const auto& vertices = get<0>(D);
+		const auto& indices = get<1>(D);
+		size_t n = vertices.size();
+		vector<uint8_t> bin(n * 32 + indices.size() * 4);
+		float* positions = (float*)bin.data();
+		float* normals = positions + n * 3;
+		float* texcoords = normals + n * 3;
+		for (size_t i = 0; i < n; ++i) {
+			memcpy(positions + i * 3, &vertices[i].position, 12);
+			memcpy(normals + i * 3, &vertices[i].normal, 12);
+			memcpy(texcoords + i * 2, &vertices[i].texcoord, 8);
+		}
+		memcpy(texcoords + n * 2, indices.data(), indices.size() * 4);
+
+		char json_text[1024];
+		string json(json_text, snprintf(json_text, sizeof(json_text),
+			"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":%zu}],\"bufferViews\":["
+			"{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+			"{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+			"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+			"{\"bufferView\":1,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+			"{\"bufferView\":2,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"},"
+			"{\"bufferView\":3,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}]}",
+			bin.size(), n * 12, n * 12, n * 12, n * 24, n * 8, n * 32, indices.size() * 4, n, n, n, indices.size()));
+		json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+		uint32_t header[3] = { 0x46546c67, 2, (uint32_t)(12 + 8 + json.size() + 8 + bin.size()) };	//'glTF'
+		uint32_t json_chunk[2] = { (uint32_t)json.size(), 0x4e4f534a };
+		uint32_t bin_chunk[2] = { (uint32_t)bin.size(), 0x004e4942 };
+		ofstream out(path, ios::binary | ios::trunc);
+		out.write((const char*)header, sizeof(header));
+		out.write((const char*)json_chunk, sizeof(json_chunk));
+		out.write(json.data(), json.size());
+		out.write((const char*)bin_chunk, sizeof(bin_chunk));
+		out.write((const char*)bin.data(), bin.size());
+		return header[2];
+	}
+}
+
+//throughput is counted in bytes of the input file; the OBJ text is parsed from memory so disk speed is left out
+BENCHMARK(mesh_import_obj) {
+	uint32_t sizes[] = { 300, 1000 };
+	for (uint32_t n : sizes) {
+		string text = obj_text(generate_sphere_mesh(1.f, 2 * n, n));
+		double mb = (double)text.size() / (1 << 20);
+		for (uint32_t threads : thread_counts()) {
+			double ms = 0.;
+			with_threads(threads, [&] {
+				ms = time_ms([&] {
+					mesh_data D = import_obj(text.data(), text.size());
+					keep(get<0>(D).data());
+				}, 3);
+			});
+			printf("  %7.1f MB  %2u threads  %8.1f ms  %7.1f MB/s\n", mb, threads, ms, mb / (ms * 1e-3));
+		}
+	}
+}
+
+//the .glb is read through the OS file cache after the first run
+BENCHMARK(mesh_import_gltf) {
+	wchar_t dir[MAX_PATH];
+	GetTempPathW(MAX_PATH, dir);
+	wstring path = wstring(dir) + L"dxut_bench_mesh_import.glb";
+	uint32_t sizes[] = { 300, 1000 };
+	for (uint32_t n : sizes) {
+		double mb = (double)write_glb(path, generate_sphere_mesh(1.f, 2 * n, n)) / (1 << 20);
+		for (uint32_t threads : thread_counts()) {
+			double ms = 0.;
+			with_threads(threads, [&] {
+				ms = time_ms([&] {
+					mesh_data D = import_gltf(path);
+					keep(get<0>(D).data());
+				}, 3);
+			});
+			printf("  %7.1f MB  %2u threads  %8.1f ms  %7.1f MB/s\n", mb, threads, ms, mb / (ms * 1e-3));
+		}
+	}
+	DeleteFileW(path.c_str());
+}
@@ -0,0 +1,49 @@
+#include "bench.h"
+#include "dxut\terrain.h"
+
+namespace {
+	//rolling hills from a few octaves of sines, so neighbouring leaves have similar but not equal ranges
+	float hill_height(float x, float z) {
+		float h = 0.f, a = 400.f, f = 1.f / 4000.f;
+		for (int o = 0; o < 5; ++o, a *= .45f, f *= 2.1f) h += a * sinf(x * f + o) * cosf(z * f * 1.3f - o);
+		return h;
+	}
+
+	terrain_quadtree hill_tree(uint32_t leaves, uint32_t levels, float leaf_size) {
+		terrain_quadtree tree(leaves, leaves, levels, leaf_size, -1000.f, 1000.f);
+		for (uint32_t z = 0; z < leaves; ++z) {
+			for (uint32_t x = 0; x < leaves; ++x) {
+				float a = hill_height(x * leaf_size, z * leaf_size), b = hill_height((x + 1) * leaf_size, (z + 1) * leaf_size);
+				tree.set_leaf(x, z, min(a, b) - 5.f, max(a, b) + 5.f);
+			}
+		}
+		tree.refresh(0, 0, leaves, leaves);
+		return tree;
+	}
+}
+
+//selection over quadtrees of 1.4M and 5.6M nodes, for a camera near the ground looking across the terrain,
+//once without culling and once against its frustum
+BENCHMARK(terrain_select) {
+	const float leaf_size = 64.f;
+	uint32_t sizes[] = { 1024, 2048 };
+	for (uint32_t leaves : sizes) {
+		uint32_t levels = 11;
+		terrain_quadtree tree = hill_tree(leaves, levels, leaf_size);
+		vector<float> ranges(levels);
+		for (uint32_t l = 0; l < levels; ++l) ranges[l] = 500.f * (float)(1u << l);
+
+		float center = leaves * leaf_size * .5f;
+		XMFLOAT3 eye(center, hill_height(center, center) + 50.f, center);
+		XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&eye), XMVectorSet(.6f, -.1f, .8f, 0.f), XMVectorSet(0.f, 1.f, 0.f, 0.f));
+		BoundingFrustum frustum(XMMatrixPerspectiveFovLH(XMConvertToRadians(60.f), 16.f / 9.f, 1.f, 100000.f));
+		frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+
+		vector<terrain_node> nodes;
+		const BoundingFrustum* culling[] = { nullptr, &frustum };
+		for (const BoundingFrustum* f : culling) {
+			double ms = time_ms([&] { tree.select(eye, ranges, f, nodes); }, 21);
+			printf("  %8zu tree nodes  %-8s %6zu selected  %7.3f ms\n", tree.node_count(), f ? "frustum" : "all", nodes.size(), ms);
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#include "bench.h"
+#include "dxut\transform.h"
+#include "dxut\cpu_features.h"
+#include <random>
+
+namespace {
+	const char* level_name(simd_level l) {
+		const char* names[] = { "scalar", "sse", "avx2", "avx512" };
+		return names[(int)l];
+	}
+
+	//scalar is the DirectXMath loop, which is the baseline the kernels are measured against
+	vector<simd_level> supported_levels() {
+		const cpu_features& f = get_cpu_features();
+		vector<simd_level> levels = { simd_level::scalar, simd_level::sse };
+		if (f.avx2 && f.fma) levels.push_back(simd_level::avx2);
+		if (f.avx512f && f.avx2 && f.fma) levels.push_back(simd_level::avx512);
+		return levels;
+	}
+
+	float largest_difference(const float* a, const float* b, size_t count) {
+		float d = 0.f;
+		for (size_t i = 0; i < count; ++i) d = max(d, fabsf(a[i] - b[i]));
+		return d;
+	}
+}
+
+//positions and normals transformed where they sit inside a vertex array, and world matrices multiplied into
+//instance data, at every supported SIMD level and thread count; the largest difference to the DirectXMath
+//level is printed alongside
+BENCHMARK(transform) {
+	const size_t count = 1 << 20;
+	mt19937 rng(13);
+	uniform_real_distribution<float> u(-2.f, 2.f);
+	vector<vertex> vertices(count);
+	for (auto& v : vertices) v = vertex(u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng));
+	vector<XMFLOAT4X4> worlds(count);
+	for (auto& w : worlds) XMStoreFloat4x4(&w, XMMatrixRotationRollPitchYaw(u(rng), u(rng), u(rng)) * XMMatrixTranslation(u(rng), u(rng), u(rng)));
+	XMMATRIX m = XMMatrixScaling(1.f, 2.f, .5f) * XMMatrixRotationRollPitchYaw(.3f, -.7f, 1.1f) * XMMatrixTranslation(4.f, -1.f, 2.f);
+	XMMATRIX view_projection = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.f, 0.f, 1.f, 0.f), XMVectorSet(0.f, 1.f, 0.f, 0.f))
+		* XMMatrixPerspectiveFovLH(XMConvertToRadians(60.f), 16.f / 9.f, .1f, 1000.f);
+	simd_level initial = max_simd_level();
+
+	//out of place, so every repetition starts from the same input
+	vector<vertex> out(count), reference;
+	vector<XMFLOAT4X4> matrices(count), reference_matrices;
+	keep(out.data());
+	keep(matrices.data());
+	for (simd_level level : supported_levels()) {
+		set_max_simd_level(level);
+		for (uint32_t threads : thread_counts()) {
+			double points_ms = 0., normals_ms = 0., matrices_ms = 0.;
+			with_threads(threads, [&] {
+				points_ms = time_ms([&] { transform_points(&vertices[0].position, sizeof(vertex), count, m, &out[0].position, sizeof(vertex)); });
+				normals_ms = time_ms([&] { transform_normals(&vertices[0].normal, sizeof(vertex), count, m, &out[0].normal, sizeof(vertex)); });
+				matrices_ms = time_ms([&] { world_view_projection(worlds.data(), count, XMMatrixIdentity(), view_projection, matrices.data()); });
+			});
+			if (reference.empty()) {
+				reference = out;
+				reference_matrices = matrices;
+			}
+			float vertex_error = largest_difference(&out[0].position.x, &reference[0].position.x, count * sizeof(vertex) / sizeof(float));
+			float matrix_error = largest_difference(&matrices[0]._11, &reference_matrices[0]._11, count * 16);
+			printf("  %-6s %2u threads  points %7.1f M/s  normals %7.1f M/s  matrices %7.1f M/s  max difference %.2g %.2g\n",
+				level_name(level), threads, count / (points_ms * 1e3), count / (normals_ms * 1e3), count / (matrices_ms * 1e3), vertex_error, matrix_error);
+		}
+	}
+	set_max_simd_level(initial);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+
+//local transform of one joint
+struct joint_pose {
+	XMFLOAT4 rotation;
+	XMFLOAT3 translation;
+	XMFLOAT3 scale;
+};
+
+//an animation baked at a fixed rate, the way exporters usually hand it over: frame_count poses of
+//joint_count joints each, frame after frame
+struct raw_animation {
+	float sample_rate;
+	uint32_t joint_count;
+	uint32_t frame_count;
+	vector<joint_pose> poses;
+};
+
+//largest error a removed key may leave behind; quantizing the kept keys adds up to about 1e-4 radians
+//to rotations and 1/65535 of a track's range to translations and scales
+struct animation_tolerance {
+	float rotation;		//radians
+	float translation;
+	float scale;
+
+	animation_tolerance() : rotation(0.001f), translation(0.0001f), scale(0.0001f) {}
+};
+
+//every joint has a rotation, a translation and a scale track, in that order and joint after joint. A track
+//keeps only the keys that linear interpolation between their neighbours cannot reproduce within the
+//tolerance, so a constant track is a single key. Keys take 8 bytes: a 16 bit frame number and three
+//16 bit values, which are the smallest three components of the rotation (15 bits each, plus 2 bits for
+//which one was dropped) or the translation or scale quantized to the track's range. The keys of each track
+//are contiguous and in time order, and tracks are in joint order, so sampling a whole pose walks the key
+//arrays front to back
+class animation_clip {
+public:
+	struct track {
+		uint32_t first, count;
+		XMFLOAT3 lo, extent;	//range of translation and scale tracks
+	};
+
+	float sample_rate;
+	float duration;
+	uint32_t joint_count;
+	vector<track> tracks;
+	vector<uint16_t> frames;
+	vector<uint16_t> values;
+
+	animation_clip() : sample_rate(30.f), duration(0.f), joint_count(0) {}
+	animation_clip(const raw_animation& raw, const animation_tolerance& tolerance = animation_tolerance());
+
+	//bytes taken by the clip and its keys
+	size_t memory_size() const;
+	size_t key_count() const { return frames.size(); }
+};
+
+//where each track of a clip was last sampled; playing forward from there finds the next keys with a step
+//or two instead of a search
+struct animation_cursor {
+	vector<uint32_t> keys;
+};
+
+//pose of all joints at time t (clamped to the clip), with rotations normalized-lerped four joints at a time
+void sample_animation(const animation_clip& clip, float t, joint_pose* pose, animation_cursor* cursor = nullptr);
+
+//out = a blended toward b by weight, for joint_count joints; out may be a or b
+void blend_poses(const joint_pose* a, const joint_pose* b, float weight, size_t joint_count, joint_pose* out);
+
+//the stages for many characters at once, in parallel
+struct animation_sample_job {
+	const animation_clip* clip;
+	float time;
+	joint_pose* pose;
+	animation_cursor* cursor;
+};
+struct pose_blend_job {
+	const joint_pose* a;
+	const joint_pose* b;
+	float weight;
+	size_t joint_count;
+	joint_pose* out;
+};
+void sample_animations(const vector<animation_sample_job>& jobs);
+void blend_poses(const vector<pose_blend_job>& jobs);
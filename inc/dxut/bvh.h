@@ -0,0 +1,61 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+//closest hit of a ray query; t is in units of the ray direction, and (u, v) are the barycentrics of the
+//second and third corner of the triangle, which is numbered as in the index buffer the bvh was built from
+struct ray_hit {
+	float t;
+	uint32_t triangle;
+	float u, v;
+};
+
+//bounding volume hierarchy over the triangles of a mesh for CPU side ray casts: picking, line of sight and
+//the like. It is built top down with binned SAH (subtrees built in parallel), then collapsed so that every
+//interior node has up to four children stored next to each other, which a query tests with one SSE pass
+//positions and indices are copied in, so the source data can go away; refit takes new positions for the
+//same triangles and only recomputes the boxes, which stays cheap for deforming meshes but loses quality
+//when they move far from the pose the tree was built for
+class mesh_bvh {
+public:
+	//count > 0: leaf over triangles [first, first + count) of the leaf order
+	//count == 0: interior node whose children are nodes first .. first + 3; unused child slots have
+	//first == 0 as well, since node 0 is the root and never anyone's child
+	struct node {
+		XMFLOAT3 lo;
+		uint32_t first;
+		XMFLOAT3 hi;
+		uint32_t count;
+	};
+	static_assert(sizeof(node) == 32, "two nodes per cache line");
+
+	mesh_bvh() {}
+	mesh_bvh(const mesh_data& D, uint32_t max_leaf_size = 4);
+	//positions are float3s vertex_stride bytes apart
+	mesh_bvh(const void* positions, size_t vertex_count, size_t vertex_stride, const uint32_t* indices, size_t index_count,
+		uint32_t max_leaf_size = 4);
+
+	void refit(const mesh_data& D) { refit(get<0>(D).data(), get<0>(D).size(), sizeof(vertex)); }
+	void refit(const void* positions, size_t vertex_count, size_t vertex_stride);
+
+	//closest hit with t in [0, t_max]; both sides of a triangle are hit
+	bool intersect(FXMVECTOR origin, FXMVECTOR direction, float t_max, ray_hit& hit) const;
+	//closest hit between a and b, with t going from 0 at a to 1 at b
+	bool intersect_segment(FXMVECTOR a, FXMVECTOR b, ray_hit& hit) const { return intersect(a, b - a, 1.f, hit); }
+	//whether anything lies between a and b; stops at the first hit found
+	bool occluded(FXMVECTOR a, FXMVECTOR b) const;
+
+	const vector<node>& nodes() const { return tree; }
+	size_t triangle_count() const { return triangles.size(); }
+
+private:
+	vector<node> tree;
+	vector<XMFLOAT3> positions;
+	vector<XMUINT3> triangles;		//in leaf order
+	vector<uint32_t> triangle_id;	//index in the source of each triangle in leaf order
+
+	void build(uint32_t max_leaf_size);
+	template <bool any_hit>
+	bool traverse(FXMVECTOR origin, FXMVECTOR direction, float t_max, ray_hit& hit) const;
+};
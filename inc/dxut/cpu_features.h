@@ -0,0 +1,21 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+
+//instruction sets the CPU and the OS both support, read once through cpuid/xgetbv; kernels with several
+//SIMD versions pick one from this at run time, so the library itself builds for the baseline instruction set
+struct cpu_features {
+	bool sse41;
+	bool avx;
+	bool avx2;
+	bool fma;
+	bool avx512f;
+};
+
+const cpu_features& get_cpu_features();
+
+//widest vector path a kernel may take; lower it to compare the paths against each other
+enum class simd_level : uint8_t { scalar, sse, avx2, avx512 };
+
+simd_level max_simd_level();
+void set_max_simd_level(simd_level level);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include <DirectXCollision.h>
+
+//the six planes of a view frustum (left, right, bottom, top, near, far), as (normal, d) with unit
+//normals pointing inwards, so a point p is inside when dot(normal, p) + d >= 0 for all of them
+struct frustum_planes {
+	XMFLOAT4 planes[6];
+};
+
+//Gribb/Hartmann extraction from view * projection, e.g. camera.GetViewMatrix() * camera.GetProjectionMatrix(...);
+//clip space z goes from 0 to w as in D3D. Planes come out in the space the matrix maps from
+frustum_planes extract_frustum_planes(FXMMATRIX view_projection);
+
+//bounds in structure of arrays layout, so one vector load brings in the same component of 4, 8 or 16 of them
+struct sphere_bounds_soa {
+	vector<float> x, y, z, radius;
+
+	size_t size() const { return x.size(); }
+	void resize(size_t n) { x.resize(n); y.resize(n); z.resize(n); radius.resize(n); }
+	void set(size_t i, const BoundingSphere& s) {
+		x[i] = s.Center.x; y[i] = s.Center.y; z[i] = s.Center.z; radius[i] = s.Radius;
+	}
+	void push_back(const BoundingSphere& s) { resize(size() + 1); set(size() - 1, s); }
+};
+
+struct box_bounds_soa {
+	vector<float> center_x, center_y, center_z;
+	vector<float> extent_x, extent_y, extent_z;
+
+	size_t size() const { return center_x.size(); }
+	void resize(size_t n) {
+		center_x.resize(n); center_y.resize(n); center_z.resize(n);
+		extent_x.resize(n); extent_y.resize(n); extent_z.resize(n);
+	}
+	void set(size_t i, const BoundingBox& b) {
+		center_x[i] = b.Center.x; center_y[i] = b.Center.y; center_z[i] = b.Center.z;
+		extent_x[i] = b.Extents.x; extent_y[i] = b.Extents.y; extent_z[i] = b.Extents.z;
+	}
+	void push_back(const BoundingBox& b) { resize(size() + 1); set(size() - 1, b); }
+};
+
+//replaces visible with the ascending indices of the bounds that are not entirely behind any one plane,
+//and returns how many there are. Like any plane by plane test this keeps a few bounds that only come
+//close to the frustum near its edges
+//blocks of bounds are tested in parallel, with the widest of SSE, AVX2 and AVX-512 that max_simd_level allows
+size_t cull(const frustum_planes& frustum, const sphere_bounds_soa& spheres, vector<uint32_t>& visible);
+size_t cull(const frustum_planes& frustum, const box_bounds_soa& boxes, vector<uint32_t>& visible);
@@ -309,6 +309,7 @@ public:
 			WaitForSingleObject(fenceEvent, INFINITE);
 		}
 		empty_upload_pool();
+		retired.clear();
 		free_shaders();
 		device.Reset();
 		swapChain.Reset();
@@ -324,6 +325,7 @@ public:
 
 	void start_frame() {
 		wait_for_gpu(); 
+		release_retired();
 		frameCounter++;
 	}
 
@@ -548,6 +550,18 @@ public:
 		upload_pool.clear();
 	}
 
+	//resources that commands already recorded still read, kept until the fence value signaled after those
+	//commands has completed; release_retired drops them, start_frame does so every frame
+	vector<pair<UINT64, ComPtr<ID3D12Resource>>> retired;
+	void retire(ComPtr<ID3D12Resource> r) {
+		retired.push_back({ fenceValue, r });
+	}
+	void release_retired() {
+		const UINT64 completed = fence ? fence->GetCompletedValue() : 0;
+		retired.erase(remove_if(retired.begin(), retired.end(),
+			[completed](const pair<UINT64, ComPtr<ID3D12Resource>>& r) { return r.first <= completed; }), retired.end());
+	}
+
 #ifdef SOIL
 	map<string, ComPtr<ID3D12Resource>> texture_cashe;
 	inline void load_texture(ComPtr<ID3D12GraphicsCommandList> cmdlist,
@@ -4,6 +4,26 @@
 #include "dxut\DXWindow.h"
 #include "dxut\DXDevice.h"
 #include "dxut\mesh.h"
+#include "dxut\mesh_optimize.h"
+#include "dxut\meshlet.h"
+#include "dxut\mesh_simplify.h"
+#include "dxut\vertex_quantize.h"
+#include "dxut\mesh_codec.h"
+#include "dxut\mesh_file.h"
+#include "dxut\mesh_import.h"
+#include "dxut\mesh_tangents.h"
+#include "dxut\geometry_pool.h"
+#include "dxut\instance_buffer.h"
+#include "dxut\terrain.h"
+#include "dxut\primitive_cache.h"
+#include "dxut\isosurface.h"
+#include "dxut\bvh.h"
+#include "dxut\cpu_features.h"
+#include "dxut\culling.h"
+#include "dxut\occlusion.h"
+#include "dxut\skinning.h"
+#include "dxut\animation.h"
+#include "dxut\transform.h"
 #include "dxut\SimpleCamera.h"
 #include "dxut\StepTimer.h"
 
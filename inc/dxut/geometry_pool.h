@@ -0,0 +1,66 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\DXDevice.h"
+#include "dxut\range_allocator.h"
+
+class geometry_pool;
+
+//where one mesh lives inside a geometry_pool; indices are stored relative to base_vertex, so the
+//vertex range can move without rewriting them. Returns its ranges to the pool when destroyed
+struct geometry_allocation {
+	geometry_pool* pool;
+	uint32_t base_vertex, vertex_count;
+	uint32_t start_index, index_count;
+
+	geometry_allocation() : pool(nullptr), base_vertex(0), vertex_count(0), start_index(0), index_count(0) {}
+	geometry_allocation(const geometry_allocation&) = delete;
+	geometry_allocation& operator =(const geometry_allocation&) = delete;
+	~geometry_allocation();
+};
+
+//one vertex buffer and one index buffer shared by many meshes of the same vertex stride, instead of a
+//pair of committed resources (each rounded up to 64KB) per mesh. Ranges are handed out by a best fit
+//free list; when it runs out the buffers double, and defragment packs them back together
+//the pool must outlive every allocation made from it. Growing and defragmenting copy into new buffers
+//and hand the old ones to dv->retire, which releases them once the frame that copies out of them is done;
+//defragment leaves a side that is packed already alone
+class geometry_pool {
+public:
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	D3D12_INDEX_BUFFER_VIEW ibv;
+
+	geometry_pool(DXDevice* dv, uint32_t vertex_stride, uint32_t vertex_capacity, uint32_t index_capacity,
+		DXGI_FORMAT index_format = DXGI_FORMAT_R32_UINT);
+	geometry_pool(const geometry_pool&) = delete;
+	geometry_pool& operator =(const geometry_pool&) = delete;
+
+	//copies the geometry into the pool; indices are relative to the first of the given vertices and
+	//must fit index_format
+	shared_ptr<geometry_allocation> allocate(ComPtr<ID3D12GraphicsCommandList> commandList,
+		const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count);
+
+	void defragment(ComPtr<ID3D12GraphicsCommandList> commandList);
+
+	uint32_t vertex_stride() const { return stride; }
+	const range_allocator& vertex_ranges() const { return vertex_space; }
+	const range_allocator& index_ranges() const { return index_space; }
+
+private:
+	friend struct geometry_allocation;
+
+	DXDevice* dv;
+	uint32_t stride;
+	DXGI_FORMAT index_format;
+	uint32_t index_stride;
+	ComPtr<ID3D12Resource> vbuf, ibuf;
+	range_allocator vertex_space, index_space;
+	map<uint32_t, geometry_allocation*> live;	//start_index -> allocation, to patch them after a move
+
+	void release(geometry_allocation* a);
+	ComPtr<ID3D12Resource> create_buffer(uint64_t size, D3D12_RESOURCE_STATES state);
+	void update_views();
+	//moves the contents of both buffers into new ones with the given capacities, applying the moves
+	void rebuild(ComPtr<ID3D12GraphicsCommandList> commandList, uint64_t vertex_capacity, uint64_t index_capacity,
+		const vector<range_allocator::relocation>& vertex_moves, const vector<range_allocator::relocation>& index_moves);
+};
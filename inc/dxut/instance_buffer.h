@@ -0,0 +1,56 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\DXDevice.h"
+
+//per instance vertex data that changes from frame to frame. The CPU side copy is the one to write to;
+//a persistently mapped upload buffer holds one copy per frame in flight, and upload() brings only the
+//instances written since that copy was last used up to date. The GPU reads the upload heap directly,
+//so there is no copy on the command list and no barrier
+//upload(frame) assumes the GPU is done with the draws that read slot frame, which holds as long as frames
+//are paced by DXDevice::start_frame and frame cycles through 0 .. DXDevice::FrameCount-1
+class dynamic_instance_buffer {
+public:
+	dynamic_instance_buffer(DXDevice* dv, uint32_t stride, uint32_t capacity);
+	~dynamic_instance_buffer();
+	dynamic_instance_buffer(const dynamic_instance_buffer&) = delete;
+	dynamic_instance_buffer& operator =(const dynamic_instance_buffer&) = delete;
+
+	//the number of instances that are drawn; growing past the capacity reallocates
+	void resize(uint32_t count);
+	uint32_t size() const { return count; }
+	uint32_t capacity() const { return cap; }
+	uint32_t stride() const { return instance_stride; }
+
+	//writable storage of instance i, which is marked as modified
+	void* instance(uint32_t i);
+	template <typename T>
+	T& at(uint32_t i) {
+		assert(sizeof(T) == instance_stride);
+		return *(T*)instance(i);
+	}
+	void update(uint32_t first, uint32_t n, const void* src);
+	//writes world[k] * view_projection into the matrix at byte offset of instances first .. first + n - 1;
+	//world matrices are world_stride bytes apart, so they can be read straight out of scene data
+	void update_transforms(uint32_t first, uint32_t n, const XMFLOAT4X4* world, size_t world_stride,
+		FXMMATRIX view_projection, uint32_t offset = 0, bool transpose = false);
+
+	//copies what changed into the slot of this frame and returns the view to bind at draw time
+	const D3D12_VERTEX_BUFFER_VIEW& upload(uint32_t frame);
+
+private:
+	struct dirty_range {
+		uint32_t begin, end;
+	};
+
+	DXDevice* dv;
+	uint32_t instance_stride, cap, count;
+	vector<uint8_t> data;
+	ComPtr<ID3D12Resource> buffer;
+	uint8_t* mapped;
+	dirty_range dirty[DXDevice::FrameCount];
+	D3D12_VERTEX_BUFFER_VIEW views[DXDevice::FrameCount];
+
+	void mark(uint32_t begin, uint32_t end);
+	void create_buffer();
+};
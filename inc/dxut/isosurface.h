@@ -0,0 +1,20 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+#include <functional>
+
+//surface nets (the dual contouring family without the QEF): every grid cell the surface passes through gets
+//one vertex at the mean of the crossings on its edges, shared by the quads of all four cells around every
+//crossed edge, so the output needs no welding. Values below iso are inside, and normals point up the gradient,
+//which for a signed distance field is out of the surface. Slabs of cells along z are meshed in parallel and
+//concatenated in order, so the result does not depend on the thread count
+//texcoords are left at zero, and tangents are any vector perpendicular to the normal
+
+//samples holds dims.x * dims.y * dims.z values, x fastest; sample (x, y, z) sits at origin + spacing * (x, y, z)
+mesh_data generate_isosurface_mesh(const float* samples, XMUINT3 dims, XMFLOAT3 origin, float spacing, float iso = 0.f);
+
+//samples field on the grid first (in parallel, so it has to be safe to call from several threads) and takes
+//normals from central differences of field at the vertices
+mesh_data generate_isosurface_mesh(const function<float(const XMFLOAT3&)>& field, XMUINT3 dims, XMFLOAT3 origin,
+	float spacing, float iso = 0.f);
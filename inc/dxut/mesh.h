@@ -2,6 +2,8 @@
 
 #include "dxut\cmmn.h"
 #include "dxut\DXDevice.h"
+#include "dxut\geometry_pool.h"
+#include <DirectXCollision.h>
 using namespace std;
 
 
@@ -24,44 +26,87 @@ struct vertex {
 
 typedef tuple<vector<vertex>, vector<uint32_t>> mesh_data;
 
+class mapped_mesh_file;
+
 struct mesh {
 	ComPtr<ID3D12Resource> vbufres, ibufres;
 	D3D12_VERTEX_BUFFER_VIEW vbv;
 	D3D12_INDEX_BUFFER_VIEW  ibv;
 	uint32_t num_indices;
+	//object space bounds of the vertex positions; set by the constructors that take vertex and by
+	//create_from_file, the raw buffer constructor leaves them at their defaults since it does not know the vertex layout
+	BoundingBox bounding_box;
+	BoundingSphere bounding_sphere;
+	//set for meshes that live in a geometry_pool; they have no buffers of their own, and take the pool's
+	//views and their ranges through the allocation, which stays current when the pool grows or defragments
+	shared_ptr<geometry_allocation> allocation;
 
 	mesh() { }
 
+	//index_format describes the data in indices, either DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT; bounds are
+	//left to the caller, e.g. compute_bounds for float3 positions or its quantized_vertex_stream overload
 	mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList,
-		void* vertices, size_t total_vertex_size, size_t vertex_stride, void* indices, size_t idxsz, uint32_t idxcnt);
+		void* vertices, size_t total_vertex_size, size_t vertex_stride, void* indices, size_t idxsz, uint32_t idxcnt,
+		DXGI_FORMAT index_format = DXGI_FORMAT_R32_UINT);
 
+	//index_format is the format of the index buffer to create; DXGI_FORMAT_UNKNOWN picks R16_UINT
+	//whenever the largest index fits, and R32_UINT otherwise
 	mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList,
+		const vector<vertex>& vertices, const vector<uint32_t>& indices, DXGI_FORMAT index_format = DXGI_FORMAT_UNKNOWN);
+
+	mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList, const mesh_data& D,
+		DXGI_FORMAT index_format = DXGI_FORMAT_UNKNOWN)
+		: mesh(dv, commandList, get<0>(D), get<1>(D), index_format) {}
+
+	//sub-allocates from pool instead of creating buffers; the pool's vertex stride has to be sizeof(vertex)
+	mesh(geometry_pool& pool, ComPtr<ID3D12GraphicsCommandList> commandList,
 		const vector<vertex>& vertices, const vector<uint32_t>& indices);
 
-	mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList, const mesh_data& D)
-		: mesh(dv, commandList, get<0>(D), get<1>(D)) {}
+	mesh(geometry_pool& pool, ComPtr<ID3D12GraphicsCommandList> commandList, const mesh_data& D)
+		: mesh(pool, commandList, get<0>(D), get<1>(D)) {}
 
 	//this function generates a mesh with only vec2f positions in the vertex buffer
 	static unique_ptr<mesh> create_full_screen_quad(DXDevice* dv,
 		ComPtr<ID3D12GraphicsCommandList> commandList, XMFLOAT2 ext = XMFLOAT2(1.f, 1.f));
 
+	//copies the sections of a mapped mesh file straight into one upload resource, without staging them in memory;
+	//bounds are the box stored in the header and the sphere around it
+	static unique_ptr<mesh> create_from_file(DXDevice* dv,
+		ComPtr<ID3D12GraphicsCommandList> commandList, const mapped_mesh_file& file);
+
 	static void create_instance_buffer(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> cmdlist,
 		void* data, size_t total_data_size, size_t stride, D3D12_VERTEX_BUFFER_VIEW* vbv, ComPtr<ID3D12Resource>& res);
 
+	const D3D12_VERTEX_BUFFER_VIEW& vertex_buffer_view() const { return allocation ? allocation->pool->vbv : vbv; }
+	const D3D12_INDEX_BUFFER_VIEW& index_buffer_view() const { return allocation ? allocation->pool->ibv : ibv; }
+	uint32_t start_index() const { return allocation ? allocation->start_index : 0; }
+	int32_t base_vertex() const { return allocation ? (int32_t)allocation->base_vertex : 0; }
+
 	void draw(ComPtr<ID3D12GraphicsCommandList> cmdlist) const {
-		cmdlist->IASetVertexBuffers(0, 1, &vbv);
-		cmdlist->IASetIndexBuffer(&ibv);
-		cmdlist->DrawIndexedInstanced(num_indices, 1, 0, 0, 0);
+		cmdlist->IASetVertexBuffers(0, 1, &vertex_buffer_view());
+		cmdlist->IASetIndexBuffer(&index_buffer_view());
+		cmdlist->DrawIndexedInstanced(num_indices, 1, start_index(), base_vertex(), 0);
+	}
+	//instance_data is bound from slot 1 on
+	void draw(ComPtr<ID3D12GraphicsCommandList> cmdlist, uint32_t num_instances,
+		const D3D12_VERTEX_BUFFER_VIEW* instance_data, uint32_t num_instance_views) const
+	{
+		cmdlist->IASetVertexBuffers(0, 1, &vertex_buffer_view());
+		if (num_instance_views > 0) cmdlist->IASetVertexBuffers(1, num_instance_views, instance_data);
+		cmdlist->IASetIndexBuffer(&index_buffer_view());
+		cmdlist->DrawIndexedInstanced(num_indices, num_instances, start_index(), base_vertex(), 0);
 	}
-	void draw(ComPtr<ID3D12GraphicsCommandList> cmdlist, uint32_t num_instances, vector<D3D12_VERTEX_BUFFER_VIEW> instance_data) const {
-		cmdlist->IASetVertexBuffers(0, 1, &vbv);
-		cmdlist->IASetVertexBuffers(1, instance_data.size(), instance_data.data());
-		cmdlist->IASetIndexBuffer(&ibv);
-		cmdlist->DrawIndexedInstanced(num_indices, num_instances, 0, 0, 0);
+	void draw(ComPtr<ID3D12GraphicsCommandList> cmdlist, uint32_t num_instances, const vector<D3D12_VERTEX_BUFFER_VIEW>& instance_data) const {
+		draw(cmdlist, num_instances, instance_data.data(), (uint32_t)instance_data.size());
 	}
 };
 
 
+//AABB and bounding sphere of count float3 positions that are stride bytes apart; the sphere is the smaller
+//of the one around the box center and a Ritter sphere grown from the most distant pair of extremal points
+void compute_bounds(const void* positions, size_t count, size_t stride, BoundingBox& box, BoundingSphere& sphere);
+
+//centered on the origin; transform_mesh (transform.h) places them elsewhere with the batched kernels
 mesh_data generate_cube_mesh(DirectX::XMFLOAT3 extents);
 mesh_data generate_sphere_mesh(float radius, uint32_t slices, uint32_t stacks);
 mesh_data generate_quad_mesh(DirectX::XMFLOAT2 extents, bool xz = true);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+//index buffers are coded per triangle against a FIFO of recent edges and vertices, so triangles that
+//continue a strip or fan cost about one byte; triangles may come back rotated, but never rewound
+//decoding fails on a stream that is truncated, has bytes left over, or names a vertex at or past vertex_count
+void encode_index_buffer(const uint32_t* indices, size_t index_count, vector<uint8_t>& out);
+bool decode_index_buffer(const uint8_t* data, size_t size, uint32_t* indices, size_t index_count, size_t vertex_count);
+
+//vertex buffers are coded as byte planes of per-vertex deltas, packed in groups of 16 at 0, 2, 4 or 8 bits;
+//works best after optimize_vertex_fetch, when neighbouring vertices are close in memory and in space
+void encode_vertex_buffer(const void* vertices, size_t vertex_count, size_t vertex_stride, vector<uint8_t>& out);
+bool decode_vertex_buffer(const uint8_t* data, size_t size, void* vertices, size_t vertex_count, size_t vertex_stride);
+
+//a self describing blob holding both buffers of a mesh_data
+vector<uint8_t> encode_mesh(const mesh_data& D);
+bool decode_mesh(const uint8_t* data, size_t size, mesh_data& D);
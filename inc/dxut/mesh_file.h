@@ -0,0 +1,79 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+#include "dxut\mesh_simplify.h"
+
+//on-disk layout: header, then the vertex, index, LOD and submesh sections, each starting on a
+//256 byte boundary so they can be copied straight out of a mapped view into upload memory
+const uint32_t mesh_file_magic = 0x464d5844; //'DXMF'
+const uint32_t mesh_file_version = 1;
+
+struct mesh_file_submesh {
+	uint32_t start_index;
+	uint32_t index_count;
+	int32_t base_vertex;
+	uint32_t material;
+};
+
+struct mesh_file_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertex_stride;
+	uint32_t index_format;	//DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+
+	uint64_t vertex_count;
+	uint64_t index_count;
+
+	uint64_t vertex_offset, vertex_size;
+	uint64_t index_offset, index_size;
+	uint64_t lod_offset, submesh_offset;
+	uint32_t lod_count, submesh_count;
+
+	XMFLOAT3 bounds_min;	//box around the vertex positions, all zero without vertices
+	XMFLOAT3 bounds_max;
+};
+
+//lods and submeshes index the single index buffer; with no LODs given, one covering all of D is written
+bool write_mesh_file(const wstring& path, const mesh_data& D,
+	const vector<lod_range>& lods = vector<lod_range>(), const vector<mesh_file_submesh>& submeshes = vector<mesh_file_submesh>(),
+	DXGI_FORMAT index_format = DXGI_FORMAT_UNKNOWN);
+
+//a read-only memory mapping of a whole file; throws runtime_error if it can not be opened
+class mapped_file {
+public:
+	mapped_file(const wstring& path);
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator =(const mapped_file&) = delete;
+
+	const uint8_t* data() const { return view; }
+	size_t size() const { return file_size; }
+
+private:
+	HANDLE file, mapping;
+	const uint8_t* view;
+	size_t file_size;
+};
+
+//a read-only mapping of a mesh file; sections are used in place and never copied into vectors
+class mapped_mesh_file {
+public:
+	mapped_mesh_file(const wstring& path);
+
+	const mesh_file_header& header() const { return *(const mesh_file_header*)view; }
+	const void* vertices() const { return view + header().vertex_offset; }
+	const void* indices() const { return view + header().index_offset; }
+	const lod_range* lods() const { return (const lod_range*)(view + header().lod_offset); }
+	const mesh_file_submesh* submeshes() const { return (const mesh_file_submesh*)(view + header().submesh_offset); }
+	size_t size() const { return map.size(); }
+
+	//copies both buffers to caller memory, e.g. a mapped upload resource
+	void copy_vertices(void* dst) const { memcpy(dst, vertices(), (size_t)header().vertex_size); }
+	void copy_indices(void* dst) const { memcpy(dst, indices(), (size_t)header().index_size); }
+
+private:
+	mapped_file map;
+	const uint8_t* view;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+//OBJ and glTF are right-handed with counter-clockwise front faces, while this library is left-handed with
+//clockwise ones (see generate_cube_mesh). With convert_handedness, which is the default, z is negated on
+//positions, normals and tangents and every triangle's winding is reversed, so assets come in facing the
+//way they were authored; without it positions, normals, tangents and winding are kept as stored
+
+//Wavefront OBJ: the text is split into chunks at line boundaries and parsed in parallel; every distinct
+//position/texcoord/normal triple becomes one vertex. Polygons are fanned into triangles, texcoords are
+//flipped to the D3D top-left origin, and tangents (and normals, if the file has none) are left zero
+//throws runtime_error on malformed input
+mesh_data import_obj(const wstring& path, bool convert_handedness = true);
+mesh_data import_obj(const char* text, size_t size, bool convert_handedness = true);
+
+//glTF 2.0, either .gltf with external or data: URI buffers, or binary .glb; external buffers are memory
+//mapped. All triangle primitives of the default scene are merged into one mesh_data in world space
+//throws runtime_error on malformed or unsupported input
+mesh_data import_gltf(const wstring& path, bool convert_handedness = true);
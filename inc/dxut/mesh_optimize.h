@@ -0,0 +1,47 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+//post-transform vertex cache efficiency of an index buffer, measured against a FIFO cache
+struct vertex_cache_stats {
+	float acmr;	//average cache miss ratio: vertex shader invocations per triangle (0.5 - 3)
+	float atvr;	//average transformed vertex ratio: vertex shader invocations per vertex (>= 1)
+};
+
+struct vertex_cache_report {
+	vertex_cache_stats before, after;
+};
+
+vertex_cache_stats analyze_vertex_cache(const vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = 16);
+
+//reorders triangles for a FIFO post-transform cache of cache_size entries using Tipsify (Sander et al. 2007)
+//triangles keep their winding and vertex order, so only the draw order changes
+vertex_cache_report optimize_vertex_cache(vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = 16);
+vertex_cache_report optimize_vertex_cache(mesh_data& D, uint32_t cache_size = 16);
+
+//sorts clusters of triangles by a view-independent occlusion potential so that outward facing
+//triangles on the hull are drawn before the ones they are likely to hide (Sander et al. 2007)
+//meant to run after optimize_vertex_cache; clusters are cut so that the ACMR of the result stays
+//within threshold times the ACMR of the input (1.05 allows at most a 5% regression)
+vertex_cache_report optimize_overdraw(mesh_data& D, float threshold = 1.05f, uint32_t cache_size = 16);
+
+//renumbers vertices in the order the index buffer first references them, drops the ones that are
+//never referenced and remaps the indices; run after the triangle order is final
+//returns the number of vertices that were removed
+size_t optimize_vertex_fetch(mesh_data& D);
+
+//per attribute tolerance for weld_vertices; 0 only merges bitwise equal values (with -0 == 0)
+struct weld_epsilon {
+	float position = 0.f;
+	float normal = 0.f;
+	float texcoord = 0.f;
+	float tangent = 0.f;
+};
+
+//merges vertices whose attributes all quantize to the same cell of an epsilon sized grid and rewrites
+//the index buffer; the first occurrence of each group is kept, so the result does not depend on the
+//thread count. Near duplicates that straddle a cell boundary are not merged. Values more than 2^62 cells
+//from zero, infinities among them, only merge when equal, and all NaNs count as one value
+//returns the number of vertices that were removed
+size_t weld_vertices(mesh_data& D, const weld_epsilon& epsilon = weld_epsilon());
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+struct mesh_lod {
+	vector<uint32_t> indices;
+	float error;	//sum of the simplify_mesh errors of this level and the ones above it, in mesh units
+};
+
+//simplifies the triangles in indices (which reference the vertices of D) by collapsing edges in order of
+//quadric error until the index count reaches target_index_count or the next collapse would exceed max_error
+//vertices that share a position (the sides of a UV/normal seam) move together: a position only collapses
+//onto a neighbor when every one of its sides shares an edge with its own side of that neighbor, which
+//lets seams shorten along themselves but never lets attributes stretch across them. Open borders never
+//move. Collapses only ever move a vertex onto an existing neighbor, so the result still indexes the
+//original vertex buffer
+//returns the largest RMS distance, over all collapses, of a moved position to the planes of the
+//triangles it stood for; it bounds how far the surface moved rather than averaging it
+float simplify_mesh(const mesh_data& D, const vector<uint32_t>& indices, size_t target_index_count,
+	vector<uint32_t>& result, float max_error = FLT_MAX);
+
+//builds a chain of LODs, one per entry of ratios (fractions of the original triangle count, decreasing)
+//each level is simplified from the previous one; the first entry of the result is always D itself
+vector<mesh_lod> build_lod_chain(const mesh_data& D, const vector<float>& ratios, float max_error = FLT_MAX);
+
+struct lod_range {
+	uint32_t start_index;
+	uint32_t index_count;
+	float error;
+};
+
+//a mesh whose index buffer holds every LOD back to back, all sharing the one vertex buffer
+struct lod_mesh : public mesh {
+	vector<lod_range> lods;
+
+	lod_mesh() {}
+
+	lod_mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList,
+		const vector<vertex>& vertices, const vector<mesh_lod>& chain);
+
+	//coarsest level whose error is at most max_error
+	size_t select_lod(float max_error) const {
+		size_t l = 0;
+		while (l + 1 < lods.size() && lods[l + 1].error <= max_error) ++l;
+		return l;
+	}
+
+	//draw(cmdlist) and the instanced mesh::draw overloads draw level 0
+	using mesh::draw;
+	void draw(ComPtr<ID3D12GraphicsCommandList> cmdlist, size_t lod, uint32_t num_instances = 1) const {
+		cmdlist->IASetVertexBuffers(0, 1, &vertex_buffer_view());
+		cmdlist->IASetIndexBuffer(&index_buffer_view());
+		cmdlist->DrawIndexedInstanced(lods[lod].index_count, num_instances, start_index() + lods[lod].start_index, base_vertex(), 0);
+	}
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+//both passes compute a contribution per triangle corner in parallel and then let every vertex sum its
+//corners in index buffer order, so the result is bit-identical for any number of threads
+
+//angle weighted vertex normals; every vertex only sees the triangles that index it, so UV and
+//hard edge seams stay apart. With weld_seams, vertices that share a position get the same smooth normal
+void generate_normals(mesh_data& D, bool weld_seams = false);
+
+//MikkTSpace style tangent frames: each triangle's texture space u direction is projected into the plane
+//of its corners' normals, weighted by the corner angle in that plane, summed per vertex and normalized.
+//tangents gets one float4 per vertex, whose w is the bitangent sign: the bitangent, pointing along +v, is
+//w * cross(normal, tangent); the xyz also go into vertex::tangent. A vertex whose triangles map the texture
+//with opposite orientations (mirrored UVs) is split: it keeps the orientation of its first triangle and a
+//copy appended after the existing vertices takes the others, with the index buffer rewritten to match.
+//Triangles with degenerate texcoords contribute nothing, and a vertex left without a tangent gets any
+//vector perpendicular to its normal and w = 1
+//returns the number of vertices added by splits
+size_t generate_tangents(mesh_data& D, vector<XMFLOAT4>& tangents);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+struct meshlet {
+	uint32_t vertex_offset;		//first entry in meshlet_data::vertex_indices
+	uint32_t vertex_count;
+	uint32_t triangle_offset;	//first entry in meshlet_data::primitive_indices
+	uint32_t triangle_count;
+};
+
+//the cluster is entirely back facing, and can be culled, if
+//  dot(center - camera_position, cone_axis) >= cone_cutoff * length(center - camera_position) + radius
+struct meshlet_bounds {
+	XMFLOAT3 center;
+	float radius;
+	XMFLOAT3 cone_axis;
+	float cone_cutoff;	//sine of the cone's half angle, 1 when the normals span a hemisphere or more
+};
+
+//all arrays are flat and tightly packed so each can be uploaded as one structured buffer;
+//vertex_indices index the mesh's existing vertex buffer, and each primitive_indices entry packs the three
+//meshlet-local vertex indices of a triangle as i0 | i1 << 8 | i2 << 16
+struct meshlet_data {
+	vector<meshlet> meshlets;
+	vector<meshlet_bounds> bounds;
+	vector<uint32_t> vertex_indices;
+	vector<uint32_t> primitive_indices;
+};
+
+//partitions the triangles of D into meshlets in index buffer order, so run optimize_vertex_cache first
+//for tight clusters; max_vertices may be at most 256
+meshlet_data build_meshlets(const mesh_data& D, uint32_t max_vertices = 64, uint32_t max_triangles = 124);
+
+meshlet_bounds compute_meshlet_bounds(const meshlet_data& M, const meshlet& m, const vector<vertex>& vertices);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+#include "dxut\culling.h"
+
+//a small depth buffer drawn on the CPU from a few occluder proxies, against which the bounding boxes of
+//other objects are tested before they are drawn. Occluder triangles are transformed in parallel, clipped
+//to the near plane and binned into tiles, and then the tiles are filled in parallel with SSE, four pixels
+//at a time. Every tile also keeps its farthest depth, which settles most box tests without looking at
+//pixels. Depths are clip space z / w (0 near, 1 far) as in D3D; coverage is sampled at pixel centers
+//and both sides of a triangle are drawn. Taking the nearest depth per pixel makes the result independent
+//of the order triangles are drawn in, and so of the number of threads
+class occlusion_buffer {
+public:
+	static const uint32_t tile_width = 32, tile_height = 16;
+
+	//the size is rounded up to whole tiles
+	occlusion_buffer(uint32_t width, uint32_t height);
+
+	//empties the buffer and sets the world to clip space transform of this frame
+	void clear(FXMMATRIX view_projection);
+
+	//transforms the occluder and bins its triangles; nothing is drawn until rasterize
+	void add_occluder(const mesh_data& D, FXMMATRIX world);
+	void add_occluder(const XMFLOAT3* positions, size_t vertex_stride, size_t vertex_count,
+		const uint32_t* indices, size_t index_count, FXMMATRIX world);
+	void rasterize();
+
+	//whether any part of the world space box could be in front of the occluders; boxes that cross the near
+	//plane always are
+	bool visible(const BoundingBox& box) const;
+	//keeps those of the given indices into boxes that are visible, in order, and returns how many are left
+	size_t filter(const box_bounds_soa& boxes, vector<uint32_t>& indices) const;
+
+	uint32_t width() const { return w; }
+	uint32_t height() const { return h; }
+	//row major, top row first
+	const float* depth() const { return pixels.data(); }
+
+private:
+	//edge functions and depth as planes over pixel coordinates, with the pixel bounds of the triangle
+	struct raster_triangle {
+		float ea[3], eb[3], ec[3];
+		float za, zb, zc;
+		int32_t x0, y0, x1, y1;
+	};
+
+	uint32_t w, h, tiles_x, tiles_y;
+	XMFLOAT4X4 view_projection;
+	vector<float> pixels;
+	vector<float> tile_max;
+	vector<raster_triangle> triangles;
+	vector<vector<uint32_t>> bins;
+	vector<XMFLOAT4> clip;
+
+	void setup(const XMFLOAT4& a, const XMFLOAT4& b, const XMFLOAT4& c);
+	void rasterize_tile(uint32_t tile);
+};
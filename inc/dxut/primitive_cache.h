@@ -0,0 +1,72 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+//hands out one shared mesh per distinct generate_*_mesh call instead of building and uploading the same
+//geometry again every time. Float parameters are rounded to mantissa_bits bits of mantissa before they form
+//the key, so every magnitude is told apart to the same relative precision (2^-(mantissa_bits + 1)), and the
+//mesh is generated from the rounded values, so calls that round the same get the same mesh no matter which
+//of them came first
+//meshes are created on the command list of the call that missed, and go into pool when one is given
+class primitive_cache {
+public:
+	primitive_cache(DXDevice* dv, geometry_pool* pool = nullptr, uint32_t mantissa_bits = 14);
+	primitive_cache(const primitive_cache&) = delete;
+	primitive_cache& operator =(const primitive_cache&) = delete;
+
+	shared_ptr<const mesh> cube(ComPtr<ID3D12GraphicsCommandList> commandList, XMFLOAT3 extents);
+	shared_ptr<const mesh> sphere(ComPtr<ID3D12GraphicsCommandList> commandList, float radius, uint32_t slices, uint32_t stacks);
+	shared_ptr<const mesh> quad(ComPtr<ID3D12GraphicsCommandList> commandList, XMFLOAT2 extents, bool xz = true);
+	shared_ptr<const mesh> plane(ComPtr<ID3D12GraphicsCommandList> commandList, XMFLOAT2 dims, XMFLOAT2 div,
+		XMFLOAT3 norm = XMFLOAT3(0, 1, 0));
+
+	uint64_t hits() const { return hit_count.load(); }
+	uint64_t misses() const { return miss_count.load(); }
+	size_t size() const;
+
+	//drops the meshes nobody else holds on to anymore, and returns how many went
+	size_t trim();
+	void clear();
+
+private:
+	enum class primitive : uint8_t { cube, sphere, quad, plane };
+	struct key {
+		primitive kind;
+		int32_t params[8];
+		bool operator <(const key& k) const {
+			if (kind != k.kind) return kind < k.kind;
+			return memcmp(params, k.params, sizeof(params)) < 0;
+		}
+	};
+
+	DXDevice* dv;
+	geometry_pool* pool;
+	uint32_t mantissa_bits;
+	mutable mutex lock;
+	map<key, shared_ptr<const mesh>> meshes;
+	atomic<uint64_t> hit_count, miss_count;
+
+	//the float's bits with the mantissa rounded to mantissa_bits; a carry moves into the exponent, which is
+	//the correctly rounded value, except past the largest float where it truncates instead of becoming infinity
+	int32_t canonical(float v) const {
+		if (v == 0.f) return 0;	//-0 as well
+		uint32_t b;
+		memcpy(&b, &v, sizeof(b));
+		if ((b & 0x7f800000u) == 0x7f800000u) return (int32_t)b;	//infinities and NaNs stay as they are
+		uint32_t drop = 23 - mantissa_bits, mask = (1u << drop) - 1;
+		uint32_t r = (b + (1u << drop >> 1)) & ~mask;
+		if ((r & 0x7f800000u) == 0x7f800000u) r = b & ~mask;
+		return (int32_t)r;
+	}
+	float value(int32_t c) const {
+		float v;
+		memcpy(&v, &c, sizeof(v));
+		return v;
+	}
+	shared_ptr<const mesh> find_or_create(ComPtr<ID3D12GraphicsCommandList> commandList, const key& k,
+		const function<mesh_data()>& generate);
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+
+//sub-allocates ranges of [0, capacity) in abstract units (vertices, indices, bytes); it only does the
+//bookkeeping, so it has no device dependency and can be exercised entirely on the CPU
+//free ranges are kept both by offset, to coalesce neighbors on release, and by size, to find the
+//best fit for a request in logarithmic time
+class range_allocator {
+public:
+	static const uint64_t invalid = ~0ull;
+
+	//one live range moving during defragment; from == to for ranges that stay put
+	struct relocation {
+		uint64_t from, to, size;
+	};
+
+	range_allocator(uint64_t capacity = 0);
+
+	//returns the offset of a free range of the given size, or invalid if no free range is large enough
+	uint64_t allocate(uint64_t size);
+	//offset must be the start of a live range
+	void release(uint64_t offset);
+
+	//extends the allocator to new_capacity, which has to be at least capacity()
+	void grow(uint64_t new_capacity);
+
+	//packs all live ranges towards offset 0 in their current order and reports where each one went,
+	//in ascending offset order, so a copy front to back never overwrites a range before it is read
+	vector<relocation> defragment();
+
+	uint64_t capacity() const { return total; }
+	uint64_t used() const { return in_use; }
+	uint64_t largest_free() const { return free_by_size.empty() ? 0 : free_by_size.rbegin()->first; }
+	size_t free_range_count() const { return free_by_offset.size(); }
+	size_t allocation_count() const { return live.size(); }
+
+private:
+	uint64_t total, in_use;
+	map<uint64_t, uint64_t> live;				//offset -> size
+	map<uint64_t, uint64_t> free_by_offset;		//offset -> size
+	multimap<uint64_t, uint64_t> free_by_size;	//size -> offset
+
+	void add_free(uint64_t offset, uint64_t size);
+	void remove_free(map<uint64_t, uint64_t>::iterator it);
+};
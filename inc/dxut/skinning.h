@@ -0,0 +1,36 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+//vertex with up to four bone influences; the vertex members keep their offsets, so the first 44 bytes
+//can be read as a plain vertex, and the whole thing fills one 64 byte cache line
+struct skinned_vertex : vertex {
+	uint8_t bones[4];
+	XMFLOAT4 weights;	//expected to add up to 1
+
+	skinned_vertex() {}
+	skinned_vertex(const vertex& v, const uint8_t b[4], const XMFLOAT4& w) : vertex(v), weights(w) {
+		memcpy(bones, b, sizeof(bones));
+	}
+
+	//POSITION, NORMAL, TEXCOORD and TANGENT as for vertex, then BLENDINDICES and BLENDWEIGHT
+	static vector<D3D12_INPUT_ELEMENT_DESC> input_layout();
+};
+static_assert(sizeof(skinned_vertex) == 64, "one cache line per vertex");
+
+//linear blend skinning of count vertices with bone matrices in the DirectXMath row vector convention
+//(p' = p * M, affine). Normals and tangents go through the blended matrix without its translation and are
+//renormalized, which is exact for rotations and uniform scales (a zero normal or tangent stays zero); texcoords
+//are copied
+//every output vertex is written once, front to back and without being read, into out_stride byte steps
+//starting at out, so out can be mapped upload memory. Blocks of vertices are skinned in parallel. Within a
+//block it goes one vertex at a time: when max_simd_level allows AVX2, a vertex blends two matrix rows per
+//256 bit register, but vertices are not spread across lanes, since each of them reads its own four bones
+void skin_vertices(const skinned_vertex* vertices, size_t count, const XMFLOAT4X4* bone_matrices, size_t bone_count,
+	void* out, size_t out_stride = sizeof(vertex));
+
+inline void skin_vertices(const vector<skinned_vertex>& vertices, const vector<XMFLOAT4X4>& bone_matrices, vector<vertex>& out) {
+	out.resize(vertices.size());
+	skin_vertices(vertices.data(), vertices.size(), bone_matrices.data(), bone_matrices.size(), out.data());
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+#include "dxut\instance_buffer.h"
+#include <mutex>
+
+//a heightfield split into square tiles that are streamed from disk, and rendered with CDLOD (Strugar 2010):
+//one shared grid patch is instanced over the nodes of a quadtree, and each level is used up to a distance
+//twice that of the level below it, with the vertex shader morphing a level into the next over the last
+//part of its range so the transitions are continuous
+struct terrain_desc {
+	uint32_t tiles_x, tiles_z;
+	uint32_t tile_samples;		//height samples per tile side, not counting the border row shared with the next tile
+	float sample_spacing;		//world units between samples
+	float height_scale;			//world height = sample / 65535 * height_scale + height_offset
+	float height_offset;
+	uint32_t patch_quads;		//grid quads per side of the shared patch; a power of two that divides tile_samples
+	uint32_t lod_count;			//quadtree levels; level 0 nodes are one patch at full sample resolution
+	float lod0_range;			//distance up to which level 0 is used; every level doubles it
+	float morph_ratio;			//part of a level's range after which it starts morphing into the next
+	//swprintf pattern with the tile's x and z (as %u) that names a file of (tile_samples + 1)^2 little endian
+	//uint16 heights, row by row along +x
+	wstring tile_path;
+	uint32_t resident_tiles;	//height tiles kept on the GPU at once
+	float stream_range;			//the nearest resident_tiles tiles closer to the camera than this are loaded
+};
+
+//one instance of the shared patch; quadrant is 4 for the whole node, or 0 - 3 (x + 2z) when the node only
+//fills in the part of its area that is not covered by its finer children
+struct terrain_node {
+	XMFLOAT2 origin;	//world x and z of the node's minimum corner
+	float size;
+	uint32_t lod;
+	uint32_t quadrant;
+};
+
+//per level shader constants
+struct terrain_lod_constants {
+	float morph_start, morph_end;
+	float inv_morph_range;
+	float node_size;
+};
+
+//min/max heights of every node of the quadtree, level by level in row major order; it never touches the
+//GPU, so selection can be run and measured on its own
+class terrain_quadtree {
+public:
+	terrain_quadtree() : leaves_x(0), leaves_z(0), leaf_size(0.f) {}
+	terrain_quadtree(uint32_t leaves_x, uint32_t leaves_z, uint32_t levels, float leaf_size,
+		float min_height, float max_height);
+
+	//sets the height range of a leaf; call refresh afterwards to update its ancestors
+	void set_leaf(uint32_t x, uint32_t z, float min_height, float max_height) { bounds[0][z * leaves_x + x] = XMFLOAT2(min_height, max_height); }
+	//recomputes the ancestors of the leaves in [x0, x1) x [z0, z1)
+	void refresh(uint32_t x0, uint32_t z0, uint32_t x1, uint32_t z1);
+
+	//selects the nodes to draw for a camera at camera_position with the given ranges (one per level,
+	//each larger than the last); nodes outside frustum are skipped, pass nullptr to keep them
+	void select(const XMFLOAT3& camera_position, const vector<float>& ranges, const BoundingFrustum* frustum,
+		vector<terrain_node>& nodes) const;
+
+	uint32_t level_count() const { return (uint32_t)bounds.size(); }
+	size_t node_count() const;
+
+private:
+	uint32_t leaves_x, leaves_z;
+	float leaf_size;
+	vector<uint32_t> width, height;		//nodes per level along x and z
+	vector<vector<XMFLOAT2>> bounds;	//x = min, y = max
+
+	BoundingBox node_box(uint32_t level, uint32_t x, uint32_t z) const;
+	bool select_node(uint32_t level, uint32_t x, uint32_t z, const XMFLOAT3& camera_position,
+		const vector<float>& ranges, const BoundingFrustum* frustum, vector<terrain_node>& nodes) const;
+};
+
+class terrain {
+public:
+	terrain_desc desc;
+	terrain_quadtree tree;
+	mesh patch;		//patch_quads^2 quads over [0, 1]^2 in xz, with the indices of each quadrant contiguous
+	vector<terrain_lod_constants> lods;
+
+	//for the vertex shader: tile_slots[z * tiles_x + x] is the slice of heights that holds the tile, or -1
+	//while it is not resident (it is then drawn at height_offset)
+	ComPtr<ID3D12Resource> heights;		//Texture2DArray R16_UNORM, (tile_samples + 1)^2 per slice
+	ComPtr<ID3D12Resource> tile_slots;	//int32 per tile
+
+	terrain(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList, const terrain_desc& desc);
+	~terrain();
+	terrain(const terrain&) = delete;
+	terrain& operator =(const terrain&) = delete;
+
+	//SRVs of heights and tile_slots at index and index + 1 of the heap
+	void create_views(descriptor_heap& heap, uint32_t index);
+
+	//uploads the tiles that finished loading and starts loading the ones that came into stream_range
+	void update(ComPtr<ID3D12GraphicsCommandList> commandList, const XMFLOAT3& camera_position);
+
+	void select(const XMFLOAT3& camera_position, const BoundingFrustum* frustum, vector<terrain_node>& nodes) const;
+
+	//draws the patch once per quadrant kind, with the nodes as the per instance stream in slot 1
+	void draw(ComPtr<ID3D12GraphicsCommandList> commandList, const vector<terrain_node>& nodes,
+		dynamic_instance_buffer& instances, uint32_t frame) const;
+
+	//input layout of the patch vertices followed by the terrain_node instance stream
+	static vector<D3D12_INPUT_ELEMENT_DESC> input_layout();
+
+private:
+	struct loaded_tile {
+		uint32_t tile;
+		vector<uint16_t> samples;
+	};
+	//shared with the loading tasks, which may outlive a frame
+	struct stream_queue {
+		mutex lock;
+		vector<loaded_tile> done;
+	};
+	enum class tile_state : uint8_t { unloaded, loading, resident, failed };
+
+	DXDevice* dv;
+	vector<float> ranges;
+	vector<tile_state> state;
+	vector<int32_t> slot_of_tile;
+	vector<uint32_t> tile_in_slot;
+	vector<uint64_t> slot_last_used;
+	uint64_t update_count;
+	shared_ptr<stream_queue> queue;
+	vector<concurrency::task<void>> in_flight;
+	uint32_t quadrant_index_count;
+	bool slots_dirty;
+
+	void integrate(ComPtr<ID3D12GraphicsCommandList> commandList, loaded_tile& t);
+};
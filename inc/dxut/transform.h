@@ -0,0 +1,39 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+//batched versions of XMVector3Transform and XMMatrixMultiply over strided arrays, so positions can be
+//transformed where they sit inside vertices and matrices where they sit inside instance data. Blocks are
+//processed in parallel, whichever way max_simd_level allows: four (AVX-512) or two (AVX2) elements per
+//register with fused multiply-adds, one per register with SSE, which agrees with DirectXMath, or through
+//DirectXMath itself at the scalar level. Output may overwrite the input when the strides match
+//matrices follow the DirectXMath row vector convention (p' = p * m)
+//the generate_*_mesh functions do not go through these: the cube and quad are written out vertex by
+//vertex, and the sphere and plane compute each vertex from its angles or grid position in the same pass
+//that stores it, so a kernel pass would only add a second sweep over the vertices. The plane is also
+//compared bit for bit against a scalar reference, which the fused kernels would not match. Use
+//transform_mesh to place a generated mesh
+
+//float3 points: out = (p, 1) * m, for affine m
+void transform_points(const void* in, size_t in_stride, size_t count, FXMMATRIX m, void* out, size_t out_stride);
+
+//float3 directions: out = (d, 0) * m, normalized when asked (zero vectors stay zero); normals go through
+//the inverse transpose of a transform with non-uniform scale
+void transform_normals(const void* in, size_t in_stride, size_t count, FXMMATRIX m, void* out, size_t out_stride,
+	bool normalize = true);
+
+//out[i] = a[i] * b for 4x4 float matrices, transposed on the way out if asked, e.g. for HLSL constant
+//buffers declared without row_major
+void multiply_matrices(const void* a, size_t a_stride, size_t count, FXMMATRIX b, void* out, size_t out_stride,
+	bool transpose = false);
+
+inline void world_view_projection(const XMFLOAT4X4* world, size_t count, FXMMATRIX view, CXMMATRIX projection,
+	XMFLOAT4X4* out, bool transpose = false)
+{
+	multiply_matrices(world, sizeof(XMFLOAT4X4), count, view * projection, out, sizeof(XMFLOAT4X4), transpose);
+}
+
+//positions by world, normals by its inverse transpose and tangents by world, both renormalized; a
+//mirroring world also turns the triangles around so they keep facing out
+void transform_mesh(mesh_data& D, FXMMATRIX world);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include "dxut\mesh.h"
+
+struct quantize_options {
+	bool position_unorm16;	//R16G16B16A16_UNORM relative to the mesh AABB instead of R32G32B32_FLOAT
+	bool octahedral_frame;	//normal and tangent octahedral encoded as two SNORM components each
+	uint32_t frame_bits;	//8 or 16 bits per octahedral component
+	bool half_texcoords;	//R16G16_FLOAT instead of R32G32_FLOAT
+
+	quantize_options() : position_unorm16(true), octahedral_frame(true), frame_bits(16), half_texcoords(true) {}
+};
+
+//shader side: position = packed.xyz * position_scale.xyz + position_offset.xyz
+//octahedral normals decode as n = float3(e.xy, 1 - abs(e.x) - abs(e.y)); if (n.z < 0) n.xy = (1 - abs(n.yx)) * select(n.xy >= 0, 1, -1);
+//normalize(n). sign() would return 0 for a zero component, where the encoder folds it to +1
+//(select needs HLSL 2021; (n.xy >= 0 ? 1 : -1) is the same for earlier versions)
+struct dequantize_constants {
+	XMFLOAT4 position_scale;
+	XMFLOAT4 position_offset;
+};
+
+//a packed vertex buffer and everything needed to bind and decode it; elements are laid out as
+//POSITION, TEXCOORD, NORMAL, TANGENT so the smaller octahedral components end the vertex
+struct quantized_vertex_stream {
+	vector<uint8_t> data;
+	uint32_t stride;
+	size_t vertex_count;
+	quantize_options options;
+	vector<D3D12_INPUT_ELEMENT_DESC> layout;
+	dequantize_constants constants;
+};
+
+quantized_vertex_stream quantize_vertices(const vector<vertex>& vertices, const quantize_options& opt = quantize_options());
+inline quantized_vertex_stream quantize_vertices(const mesh_data& D, const quantize_options& opt = quantize_options()) {
+	return quantize_vertices(get<0>(D), opt);
+}
+
+//CPU reference decode of vertex i, the same math a vertex shader does with the constants
+vertex dequantize_vertex(const quantized_vertex_stream& s, size_t i);
+
+//bounds of the decoded positions, for a mesh created from s.data; UNORM16 positions take the box straight
+//from the dequantization constants, which span every position the format can decode to, and the sphere
+//around that box. Float positions get compute_bounds
+void compute_bounds(const quantized_vertex_stream& s, BoundingBox& box, BoundingSphere& sphere);
+
+XMFLOAT2 octahedral_encode(FXMVECTOR n);
+XMVECTOR octahedral_decode(XMFLOAT2 e);
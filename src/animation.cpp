@@ -0,0 +1,263 @@
+#include "dxut\cmmn.h"
+#include "dxut\animation.h"
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+	const float sqrt2 = 1.41421356f;
+
+#pragma region keys
+	//the component with the largest magnitude is dropped and rebuilt from the unit length, the other three
+	//lie in [-1/sqrt2, 1/sqrt2] and take 15 bits each; the 2 bit index of the dropped one fills the 48 bits
+	void pack_rotation(XMFLOAT4 q, uint16_t* out) {
+		float c[4] = { q.x, q.y, q.z, q.w };
+		uint32_t largest = 0;
+		for (uint32_t i = 1; i < 4; ++i)
+			if (fabsf(c[i]) > fabsf(c[largest])) largest = i;
+		float sign = c[largest] < 0.f ? -1.f : 1.f;
+		uint64_t bits = largest;
+		for (uint32_t i = 0; i < 4; ++i) {
+			if (i == largest) continue;
+			float u = (c[i] * sign * sqrt2 * 0.5f + 0.5f) * 32767.f;
+			bits = (bits << 15) | (uint64_t)min(max(lroundf(u), 0l), 32767l);
+		}
+		out[0] = (uint16_t)(bits >> 32);
+		out[1] = (uint16_t)(bits >> 16);
+		out[2] = (uint16_t)bits;
+	}
+
+	XMFLOAT4 unpack_rotation(const uint16_t* in) {
+		uint64_t bits = ((uint64_t)in[0] << 32) | ((uint64_t)in[1] << 16) | in[2];
+		uint32_t largest = (uint32_t)(bits >> 45);
+		float c[4], sum = 0.f;
+		for (int32_t i = 3, shift = 0; i >= 0; --i) {
+			if ((uint32_t)i == largest) continue;
+			c[i] = (((bits >> shift) & 0x7fff) / 32767.f * 2.f - 1.f) / sqrt2;
+			sum += c[i] * c[i];
+			shift += 15;
+		}
+		c[largest] = sqrtf(max(1.f - sum, 0.f));
+		return XMFLOAT4(c[0], c[1], c[2], c[3]);
+	}
+
+	void pack_vector(const XMFLOAT3& v, const animation_clip::track& t, uint16_t* out) {
+		const float* x = &v.x;
+		const float* lo = &t.lo.x;
+		const float* e = &t.extent.x;
+		for (uint32_t i = 0; i < 3; ++i)
+			out[i] = e[i] > 0.f ? (uint16_t)min(max(lroundf((x[i] - lo[i]) / e[i] * 65535.f), 0l), 65535l) : 0;
+	}
+
+	XMVECTOR unpack_vector(const uint16_t* in, const animation_clip::track& t) {
+		return XMVectorMultiplyAdd(XMVectorSet(in[0], in[1], in[2], 0.f) * (1.f / 65535.f), XMLoadFloat3(&t.extent), XMLoadFloat3(&t.lo));
+	}
+
+	XMVECTOR nlerp(FXMVECTOR a, FXMVECTOR b, float w) {
+		XMVECTOR bb = XMVectorGetX(XMVector4Dot(a, b)) < 0.f ? -b : b;
+		return XMVector4Normalize(XMVectorLerp(a, bb, w));
+	}
+
+	//frames of the keys to keep out of frame_count, the first and last always among them; interpolates(a, b, f)
+	//says whether the frames a and b reproduce frame f closely enough
+	template <typename F>
+	vector<uint32_t> reduce_keys(uint32_t frame_count, F interpolates) {
+		vector<uint32_t> keys = { 0 };
+		bool constant = true;
+		for (uint32_t f = 1; f < frame_count && constant; ++f) constant = interpolates(0, 0, f);
+		if (constant) return keys;
+
+		uint32_t start = 0;
+		for (uint32_t end = 2; end < frame_count; ++end) {
+			bool fits = true;
+			for (uint32_t f = start + 1; f < end && fits; ++f) fits = interpolates(start, end, f);
+			if (!fits) {
+				start = end - 1;
+				keys.push_back(start);
+			}
+		}
+		keys.push_back(frame_count - 1);
+		return keys;
+	}
+#pragma endregion
+
+	//rotations a[i] to b[i] by w[i] for n <= 4 joints, as four lanes of x, y, z and w
+	void nlerp4(const XMFLOAT4* a, const XMFLOAT4* b, const float* w, uint32_t n, XMFLOAT4* out) {
+		XMMATRIX qa, qb;
+		for (uint32_t i = 0; i < 4; ++i) {
+			qa.r[i] = i < n ? XMLoadFloat4(&a[i]) : XMQuaternionIdentity();
+			qb.r[i] = i < n ? XMLoadFloat4(&b[i]) : XMQuaternionIdentity();
+		}
+		qa = XMMatrixTranspose(qa);
+		qb = XMMatrixTranspose(qb);
+		XMVECTOR weight = XMVectorSet(w[0], n > 1 ? w[1] : 0.f, n > 2 ? w[2] : 0.f, n > 3 ? w[3] : 0.f);
+		XMVECTOR dot = qa.r[0] * qb.r[0] + qa.r[1] * qb.r[1] + qa.r[2] * qb.r[2] + qa.r[3] * qb.r[3];
+		//the shorter way round: b is negated in the lanes where it points away from a
+		XMVECTOR flip = XMVectorLess(dot, XMVectorZero());
+		XMVECTOR len2 = XMVectorZero();
+		XMMATRIX q;
+		for (uint32_t c = 0; c < 4; ++c) {
+			XMVECTOR bc = XMVectorSelect(qb.r[c], -qb.r[c], flip);
+			q.r[c] = XMVectorMultiplyAdd(weight, bc - qa.r[c], qa.r[c]);
+			len2 = XMVectorMultiplyAdd(q.r[c], q.r[c], len2);
+		}
+		XMVECTOR inv = XMVectorReciprocalSqrt(len2);
+		for (uint32_t c = 0; c < 4; ++c) q.r[c] *= inv;
+		q = XMMatrixTranspose(q);
+		for (uint32_t i = 0; i < n; ++i) XMStoreFloat4(&out[i], q.r[i]);
+	}
+
+	//key at or before frame, starting from hint
+	inline uint32_t find_key(const animation_clip& clip, const animation_clip::track& t, uint32_t frame, uint32_t hint) {
+		const uint16_t* f = clip.frames.data() + t.first;
+		uint32_t k = min(hint, t.count - 1);
+		if (f[k] > frame) {
+			k = (uint32_t)(upper_bound(f, f + t.count, (uint16_t)frame) - f);
+			return k ? k - 1 : 0;
+		}
+		while (k + 1 < t.count && f[k + 1] <= frame) ++k;
+		return k;
+	}
+}
+
+animation_clip::animation_clip(const raw_animation& raw, const animation_tolerance& tolerance)
+	: sample_rate(raw.sample_rate), joint_count(raw.joint_count)
+{
+	assert(raw.frame_count >= 1 && raw.frame_count <= 65536);
+	assert(raw.poses.size() == (size_t)raw.frame_count * raw.joint_count);
+	duration = (raw.frame_count - 1) / raw.sample_rate;
+	uint32_t n = raw.frame_count;
+	auto pose = [&](uint32_t f, uint32_t j) -> const joint_pose& { return raw.poses[(size_t)f * joint_count + j]; };
+
+	//tracks are reduced in parallel and laid out in order afterwards
+	vector<vector<uint32_t>> kept(joint_count * 3);
+	tracks.resize(joint_count * 3);
+	//angles from the chord between the quaternions, 4 asin(|a - b| / 2); the cosine of angles this small
+	//is 1 to float precision
+	float max_chord = 2.f * sinf(tolerance.rotation * 0.25f);
+	parallel_for(0u, joint_count, [&](uint32_t j) {
+		kept[3 * j] = reduce_keys(n, [&](uint32_t a, uint32_t b, uint32_t f) {
+			float w = a == b ? 0.f : (float)(f - a) / (b - a);
+			XMVECTOR q = nlerp(XMLoadFloat4(&pose(a, j).rotation), XMLoadFloat4(&pose(b, j).rotation), w);
+			XMVECTOR r = XMVector4Normalize(XMLoadFloat4(&pose(f, j).rotation));
+			if (XMVectorGetX(XMVector4Dot(q, r)) < 0.f) r = -r;
+			return XMVectorGetX(XMVector4Length(q - r)) <= max_chord;
+		});
+		for (uint32_t c = 1; c < 3; ++c) {
+			float tol = c == 1 ? tolerance.translation : tolerance.scale;
+			auto value = [&](uint32_t f) { return XMLoadFloat3(c == 1 ? &pose(f, j).translation : &pose(f, j).scale); };
+			kept[3 * j + c] = reduce_keys(n, [&](uint32_t a, uint32_t b, uint32_t f) {
+				float w = a == b ? 0.f : (float)(f - a) / (b - a);
+				XMVECTOR d = XMVectorAbs(XMVectorLerp(value(a), value(b), w) - value(f));
+				return XMVectorGetX(XMVector3Length(d)) <= tol;
+			});
+			XMVECTOR lo = value(0), hi = lo;
+			for (uint32_t f : kept[3 * j + c]) {
+				lo = XMVectorMin(lo, value(f));
+				hi = XMVectorMax(hi, value(f));
+			}
+			XMStoreFloat3(&tracks[3 * j + c].lo, lo);
+			XMStoreFloat3(&tracks[3 * j + c].extent, hi - lo);
+		}
+	});
+
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < (uint32_t)tracks.size(); ++i) {
+		tracks[i].first = total;
+		tracks[i].count = (uint32_t)kept[i].size();
+		total += tracks[i].count;
+	}
+	frames.resize(total);
+	values.resize(3 * (size_t)total);
+	parallel_for(0u, (uint32_t)tracks.size(), [&](uint32_t i) {
+		const track& t = tracks[i];
+		uint32_t j = i / 3, c = i % 3;
+		for (uint32_t k = 0; k < t.count; ++k) {
+			uint32_t f = kept[i][k];
+			frames[t.first + k] = (uint16_t)f;
+			uint16_t* v = values.data() + 3 * (size_t)(t.first + k);
+			if (c == 0) {
+				XMFLOAT4 q;
+				XMStoreFloat4(&q, XMVector4Normalize(XMLoadFloat4(&pose(f, j).rotation)));
+				pack_rotation(q, v);
+			} else pack_vector(c == 1 ? pose(f, j).translation : pose(f, j).scale, t, v);
+		}
+	});
+}
+
+size_t animation_clip::memory_size() const {
+	return sizeof(*this) + tracks.size() * sizeof(track) + frames.size() * sizeof(uint16_t) + values.size() * sizeof(uint16_t);
+}
+
+void sample_animation(const animation_clip& clip, float t, joint_pose* pose, animation_cursor* cursor) {
+	if (cursor && cursor->keys.size() != clip.tracks.size()) cursor->keys.assign(clip.tracks.size(), 0);
+	float frame = min(max(t, 0.f), clip.duration) * clip.sample_rate;
+	uint32_t whole = (uint32_t)frame;
+
+	//the two keys around frame on track i and how far between them it is
+	auto keys = [&](uint32_t i, const uint16_t*& a, const uint16_t*& b, float& w) {
+		const animation_clip::track& tr = clip.tracks[i];
+		uint32_t k = find_key(clip, tr, whole, cursor ? cursor->keys[i] : 0);
+		if (cursor) cursor->keys[i] = k;
+		uint32_t k1 = min(k + 1, tr.count - 1);
+		uint16_t f0 = clip.frames[tr.first + k], f1 = clip.frames[tr.first + k1];
+		w = f1 > f0 ? min(max((frame - f0) / (f1 - f0), 0.f), 1.f) : 0.f;
+		a = clip.values.data() + 3 * (size_t)(tr.first + k);
+		b = clip.values.data() + 3 * (size_t)(tr.first + k1);
+	};
+
+	for (uint32_t j0 = 0; j0 < clip.joint_count; j0 += 4) {
+		uint32_t n = min(4u, clip.joint_count - j0);
+		XMFLOAT4 qa[4], qb[4], q[4];
+		float w[4];
+		for (uint32_t i = 0; i < n; ++i) {
+			uint32_t j = j0 + i;
+			const uint16_t *a, *b;
+			keys(3 * j, a, b, w[i]);
+			qa[i] = unpack_rotation(a);
+			qb[i] = unpack_rotation(b);
+			for (uint32_t c = 1; c < 3; ++c) {
+				float wc;
+				keys(3 * j + c, a, b, wc);
+				const animation_clip::track& tr = clip.tracks[3 * j + c];
+				XMStoreFloat3(c == 1 ? &pose[j].translation : &pose[j].scale, XMVectorLerp(unpack_vector(a, tr), unpack_vector(b, tr), wc));
+			}
+		}
+		nlerp4(qa, qb, w, n, q);
+		for (uint32_t i = 0; i < n; ++i) pose[j0 + i].rotation = q[i];
+	}
+}
+
+void blend_poses(const joint_pose* a, const joint_pose* b, float weight, size_t joint_count, joint_pose* out) {
+	for (size_t j0 = 0; j0 < joint_count; j0 += 4) {
+		uint32_t n = (uint32_t)min((size_t)4, joint_count - j0);
+		XMFLOAT4 qa[4], qb[4], q[4];
+		float w[4] = { weight, weight, weight, weight };
+		for (uint32_t i = 0; i < n; ++i) {
+			qa[i] = a[j0 + i].rotation;
+			qb[i] = b[j0 + i].rotation;
+		}
+		nlerp4(qa, qb, w, n, q);
+		for (uint32_t i = 0; i < n; ++i) {
+			size_t j = j0 + i;
+			XMVECTOR t = XMVectorLerp(XMLoadFloat3(&a[j].translation), XMLoadFloat3(&b[j].translation), weight);
+			XMVECTOR s = XMVectorLerp(XMLoadFloat3(&a[j].scale), XMLoadFloat3(&b[j].scale), weight);
+			out[j].rotation = q[i];
+			XMStoreFloat3(&out[j].translation, t);
+			XMStoreFloat3(&out[j].scale, s);
+		}
+	}
+}
+
+void sample_animations(const vector<animation_sample_job>& jobs) {
+	parallel_for(size_t(0), jobs.size(), [&](size_t i) {
+		sample_animation(*jobs[i].clip, jobs[i].time, jobs[i].pose, jobs[i].cursor);
+	});
+}
+
+void blend_poses(const vector<pose_blend_job>& jobs) {
+	parallel_for(size_t(0), jobs.size(), [&](size_t i) {
+		const pose_blend_job& b = jobs[i];
+		blend_poses(b.a, b.b, b.weight, b.joint_count, b.out);
+	});
+}
@@ -0,0 +1,394 @@
+#include "dxut\cmmn.h"
+#include "dxut\bvh.h"
+#include <atomic>
+#ifdef _XM_SSE_INTRINSICS_
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+	struct aabb {
+		XMFLOAT3 lo, hi;
+
+		aabb() : lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+		void grow(const XMFLOAT3& p) {
+			lo = XMFLOAT3(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+			hi = XMFLOAT3(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+		}
+		void grow(const aabb& b) { grow(b.lo); grow(b.hi); }
+		float area() const {
+			if (hi.x < lo.x) return 0.f;
+			float dx = hi.x - lo.x, dy = hi.y - lo.y, dz = hi.z - lo.z;
+			return 2.f * (dx * dy + dy * dz + dz * dx);
+		}
+	};
+
+	inline float axis(const XMFLOAT3& p, uint32_t a) { return (&p.x)[a]; }
+
+	//binary tree as built; it is collapsed into the 4-wide one afterwards
+	struct build_node {
+		aabb box;
+		uint32_t left, right;	//~0u for leaves
+		uint32_t begin, count;
+	};
+
+	struct builder {
+		static const uint32_t bin_count = 16;
+		static const uint32_t parallel_threshold = 4096;
+		//past this depth splits fall back to the median, which bounds the depth of the tree and so the
+		//traversal stack
+		static const uint32_t max_sah_depth = 48;
+
+		vector<aabb> boxes;
+		vector<XMFLOAT3> centroids;
+		vector<uint32_t> order;
+		vector<build_node> nodes;
+		atomic<uint32_t> node_count;
+		uint32_t max_leaf_size;
+
+		uint32_t build(uint32_t begin, uint32_t count, uint32_t depth) {
+			uint32_t index = node_count++;
+			build_node& n = nodes[index];
+			n.begin = begin;
+			n.count = count;
+			n.left = n.right = ~0u;
+			aabb cb;
+			for (uint32_t i = begin; i < begin + count; ++i) {
+				n.box.grow(boxes[order[i]]);
+				cb.grow(centroids[order[i]]);
+			}
+			if (count <= 1) return index;
+
+			uint32_t mid = begin;
+#pragma region binned sah
+			float best_cost = FLT_MAX;
+			uint32_t best_axis = 0, best_split = 0;
+			if (depth < max_sah_depth) {
+				for (uint32_t a = 0; a < 3; ++a) {
+					float lo = axis(cb.lo, a), extent = axis(cb.hi, a) - lo;
+					if (extent <= 0.f) continue;
+					float scale = bin_count / extent;
+					aabb bins[bin_count];
+					uint32_t counts[bin_count] = {};
+					for (uint32_t i = begin; i < begin + count; ++i) {
+						uint32_t b = min((uint32_t)((axis(centroids[order[i]], a) - lo) * scale), bin_count - 1);
+						counts[b]++;
+						bins[b].grow(boxes[order[i]]);
+					}
+					//areas of everything right of each split, swept from the right
+					float right_area[bin_count];
+					uint32_t right_count[bin_count];
+					aabb r;
+					uint32_t rc = 0;
+					for (uint32_t b = bin_count - 1; b > 0; --b) {
+						r.grow(bins[b]);
+						rc += counts[b];
+						right_area[b] = r.area();
+						right_count[b] = rc;
+					}
+					aabb l;
+					uint32_t lc = 0;
+					for (uint32_t s = 1; s < bin_count; ++s) {
+						l.grow(bins[s - 1]);
+						lc += counts[s - 1];
+						if (lc == 0 || right_count[s] == 0) continue;
+						float cost = l.area() * lc + right_area[s] * right_count[s];
+						if (cost < best_cost) {
+							best_cost = cost;
+							best_axis = a;
+							best_split = s;
+						}
+					}
+				}
+			}
+			if (best_cost < FLT_MAX) {
+				//relative to intersecting every triangle here, with a box test costing about as much as a triangle
+				float parent_area = n.box.area();
+				float split_cost = 1.f + (parent_area > 0.f ? best_cost / parent_area : (float)count);
+				if (count <= max_leaf_size && split_cost >= (float)count) return index;
+				float lo = axis(cb.lo, best_axis), scale = bin_count / (axis(cb.hi, best_axis) - lo);
+				mid = (uint32_t)(std::partition(order.begin() + begin, order.begin() + begin + count, [&](uint32_t t) {
+					return min((uint32_t)((axis(centroids[t], best_axis) - lo) * scale), bin_count - 1) < best_split;
+				}) - order.begin());
+			}
+#pragma endregion
+			if (mid == begin || mid == begin + count) {
+				if (count <= max_leaf_size) return index;
+				//all centroids in one spot, or too deep: halve along the widest centroid extent
+				uint32_t a = 0;
+				XMFLOAT3 e(cb.hi.x - cb.lo.x, cb.hi.y - cb.lo.y, cb.hi.z - cb.lo.z);
+				if (e.y > axis(e, a)) a = 1;
+				if (e.z > axis(e, a)) a = 2;
+				mid = begin + count / 2;
+				nth_element(order.begin() + begin, order.begin() + mid, order.begin() + begin + count,
+					[&](uint32_t x, uint32_t y) { return axis(centroids[x], a) < axis(centroids[y], a); });
+			}
+
+			uint32_t left, right;
+			if (count > parallel_threshold) {
+				concurrency::parallel_invoke(
+					[&] { left = build(begin, mid - begin, depth + 1); },
+					[&] { right = build(mid, begin + count - mid, depth + 1); });
+			} else {
+				left = build(begin, mid - begin, depth + 1);
+				right = build(mid, begin + count - mid, depth + 1);
+			}
+			n.left = left;
+			n.right = right;
+			return index;
+		}
+	};
+
+	struct ray_data {
+		XMFLOAT3 o, inv;
+	};
+
+	//mask of the (up to four) children of an interior node whose boxes the ray enters before t, with their
+	//entry distances
+	inline uint32_t hit_children(const mesh_bvh::node* c, const ray_data& r, float t, float t_near[4]) {
+#ifdef _XM_SSE_INTRINSICS_
+		__m128 l0 = _mm_loadu_ps(&c[0].lo.x), l1 = _mm_loadu_ps(&c[1].lo.x), l2 = _mm_loadu_ps(&c[2].lo.x), l3 = _mm_loadu_ps(&c[3].lo.x);
+		__m128 h0 = _mm_loadu_ps(&c[0].hi.x), h1 = _mm_loadu_ps(&c[1].hi.x), h2 = _mm_loadu_ps(&c[2].hi.x), h3 = _mm_loadu_ps(&c[3].hi.x);
+		//rows become x, y, z and first (or count) of the four children
+		_MM_TRANSPOSE4_PS(l0, l1, l2, l3);
+		_MM_TRANSPOSE4_PS(h0, h1, h2, h3);
+		__m128 ox = _mm_set1_ps(r.o.x), oy = _mm_set1_ps(r.o.y), oz = _mm_set1_ps(r.o.z);
+		__m128 ix = _mm_set1_ps(r.inv.x), iy = _mm_set1_ps(r.inv.y), iz = _mm_set1_ps(r.inv.z);
+		__m128 ax = _mm_mul_ps(_mm_sub_ps(l0, ox), ix), bx = _mm_mul_ps(_mm_sub_ps(h0, ox), ix);
+		__m128 ay = _mm_mul_ps(_mm_sub_ps(l1, oy), iy), by = _mm_mul_ps(_mm_sub_ps(h1, oy), iy);
+		__m128 az = _mm_mul_ps(_mm_sub_ps(l2, oz), iz), bz = _mm_mul_ps(_mm_sub_ps(h2, oz), iz);
+		__m128 tn = _mm_max_ps(_mm_max_ps(_mm_min_ps(ax, bx), _mm_min_ps(ay, by)), _mm_max_ps(_mm_min_ps(az, bz), _mm_setzero_ps()));
+		__m128 tf = _mm_min_ps(_mm_min_ps(_mm_max_ps(ax, bx), _mm_max_ps(ay, by)), _mm_min_ps(_mm_max_ps(az, bz), _mm_set1_ps(t)));
+		__m128i unused = _mm_cmpeq_epi32(_mm_or_si128(_mm_castps_si128(l3), _mm_castps_si128(h3)), _mm_setzero_si128());
+		_mm_storeu_ps(t_near, tn);
+		return (uint32_t)(_mm_movemask_ps(_mm_cmple_ps(tn, tf)) & ~_mm_movemask_ps(_mm_castsi128_ps(unused)));
+#else
+		uint32_t mask = 0;
+		for (uint32_t k = 0; k < 4; ++k) {
+			if (c[k].first == 0 && c[k].count == 0) continue;
+			float ax = (c[k].lo.x - r.o.x) * r.inv.x, bx = (c[k].hi.x - r.o.x) * r.inv.x;
+			float ay = (c[k].lo.y - r.o.y) * r.inv.y, by = (c[k].hi.y - r.o.y) * r.inv.y;
+			float az = (c[k].lo.z - r.o.z) * r.inv.z, bz = (c[k].hi.z - r.o.z) * r.inv.z;
+			float tn = max(max(min(ax, bx), min(ay, by)), max(min(az, bz), 0.f));
+			float tf = min(min(max(ax, bx), max(ay, by)), min(max(az, bz), t));
+			t_near[k] = tn;
+			if (tn <= tf) mask |= 1u << k;
+		}
+		return mask;
+#endif
+	}
+
+	inline bool hit_box(const mesh_bvh::node& n, const ray_data& r, float t) {
+		float ax = (n.lo.x - r.o.x) * r.inv.x, bx = (n.hi.x - r.o.x) * r.inv.x;
+		float ay = (n.lo.y - r.o.y) * r.inv.y, by = (n.hi.y - r.o.y) * r.inv.y;
+		float az = (n.lo.z - r.o.z) * r.inv.z, bz = (n.hi.z - r.o.z) * r.inv.z;
+		float tn = max(max(min(ax, bx), min(ay, by)), max(min(az, bz), 0.f));
+		float tf = min(min(max(ax, bx), max(ay, by)), min(max(az, bz), t));
+		return tn <= tf;
+	}
+}
+
+mesh_bvh::mesh_bvh(const mesh_data& D, uint32_t max_leaf_size)
+	: mesh_bvh(get<0>(D).data(), get<0>(D).size(), sizeof(vertex), get<1>(D).data(), get<1>(D).size(), max_leaf_size)
+{}
+
+mesh_bvh::mesh_bvh(const void* vertices, size_t vertex_count, size_t vertex_stride, const uint32_t* indices, size_t index_count,
+	uint32_t max_leaf_size)
+{
+	positions.resize(vertex_count);
+	for (size_t i = 0; i < vertex_count; ++i) positions[i] = *(const XMFLOAT3*)((const uint8_t*)vertices + i * vertex_stride);
+	triangles.resize(index_count / 3);
+	for (size_t t = 0; t < triangles.size(); ++t) triangles[t] = XMUINT3(indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]);
+	build(max(max_leaf_size, 1u));
+}
+
+void mesh_bvh::build(uint32_t max_leaf_size) {
+	tree.clear();
+	uint32_t n = (uint32_t)triangles.size();
+	if (n == 0) return;
+
+	builder b;
+	b.max_leaf_size = max_leaf_size;
+	b.boxes.resize(n);
+	b.centroids.resize(n);
+	b.order.resize(n);
+	parallel_for(0u, n, [&](uint32_t t) {
+		aabb box;
+		box.grow(positions[triangles[t].x]);
+		box.grow(positions[triangles[t].y]);
+		box.grow(positions[triangles[t].z]);
+		b.boxes[t] = box;
+		b.centroids[t] = XMFLOAT3((box.lo.x + box.hi.x) * 0.5f, (box.lo.y + box.hi.y) * 0.5f, (box.lo.z + box.hi.z) * 0.5f);
+		b.order[t] = t;
+	});
+	b.nodes.resize(2 * (size_t)n);
+	b.node_count = 0;
+	uint32_t root = b.build(0, n, 0);
+
+#pragma region collapse
+	//each interior node takes the binary children, then keeps opening the largest interior child until it
+	//has four; children always come after their parent, which refit relies on
+	tree.push_back({});
+	vector<pair<uint32_t, uint32_t>> pending = { { 0u, root } };
+	while (!pending.empty()) {
+		uint32_t ti = pending.back().first;
+		const build_node& bn = b.nodes[pending.back().second];
+		pending.pop_back();
+		tree[ti].lo = bn.box.lo;
+		tree[ti].hi = bn.box.hi;
+		if (bn.left == ~0u) {
+			tree[ti].first = bn.begin;
+			tree[ti].count = bn.count;
+			continue;
+		}
+		uint32_t children[4] = { bn.left, bn.right };
+		uint32_t k = 2;
+		while (k < 4) {
+			int32_t open = -1;
+			float open_area = -1.f;
+			for (uint32_t i = 0; i < k; ++i) {
+				const build_node& c = b.nodes[children[i]];
+				if (c.left != ~0u && c.box.area() > open_area) {
+					open = (int32_t)i;
+					open_area = c.box.area();
+				}
+			}
+			if (open < 0) break;
+			const build_node& c = b.nodes[children[open]];
+			children[open] = c.left;
+			children[k++] = c.right;
+		}
+		uint32_t first = (uint32_t)tree.size();
+		tree[ti].first = first;
+		tree[ti].count = 0;
+		tree.resize(first + 4, node{ XMFLOAT3(0.f, 0.f, 0.f), 0, XMFLOAT3(0.f, 0.f, 0.f), 0 });
+		for (uint32_t i = 0; i < k; ++i) pending.push_back({ first + i, children[i] });
+	}
+#pragma endregion
+
+	vector<XMUINT3> sorted(n);
+	for (uint32_t i = 0; i < n; ++i) sorted[i] = triangles[b.order[i]];
+	triangles.swap(sorted);
+	triangle_id.swap(b.order);
+}
+
+void mesh_bvh::refit(const void* vertices, size_t vertex_count, size_t vertex_stride) {
+	assert(vertex_count == positions.size());
+	for (size_t i = 0; i < vertex_count; ++i) positions[i] = *(const XMFLOAT3*)((const uint8_t*)vertices + i * vertex_stride);
+	if (tree.empty()) return;
+
+	parallel_for(size_t(0), tree.size(), [&](size_t i) {
+		node& n = tree[i];
+		if (n.count == 0) return;
+		aabb box;
+		for (uint32_t t = n.first; t < n.first + n.count; ++t) {
+			box.grow(positions[triangles[t].x]);
+			box.grow(positions[triangles[t].y]);
+			box.grow(positions[triangles[t].z]);
+		}
+		n.lo = box.lo;
+		n.hi = box.hi;
+	});
+	for (size_t i = tree.size(); i-- > 0;) {
+		node& n = tree[i];
+		if (n.count != 0 || (n.first == 0 && i != 0)) continue;
+		aabb box;
+		for (uint32_t k = 0; k < 4; ++k) {
+			const node& c = tree[n.first + k];
+			if (c.first == 0 && c.count == 0) continue;
+			box.grow(c.lo);
+			box.grow(c.hi);
+		}
+		n.lo = box.lo;
+		n.hi = box.hi;
+	}
+}
+
+template <bool any_hit>
+bool mesh_bvh::traverse(FXMVECTOR origin, FXMVECTOR direction, float t_max, ray_hit& hit) const {
+	if (tree.empty()) return false;
+	ray_data r;
+	XMStoreFloat3(&r.o, origin);
+	XMStoreFloat3(&r.inv, XMVectorReciprocal(direction));
+	float t = t_max;
+	bool found = false;
+
+	auto test_leaf = [&](const node& n) {
+		for (uint32_t i = n.first; i < n.first + n.count; ++i) {
+			//Moller-Trumbore
+			XMVECTOR p0 = XMLoadFloat3(&positions[triangles[i].x]);
+			XMVECTOR e1 = XMLoadFloat3(&positions[triangles[i].y]) - p0;
+			XMVECTOR e2 = XMLoadFloat3(&positions[triangles[i].z]) - p0;
+			XMVECTOR pv = XMVector3Cross(direction, e2);
+			float det = XMVectorGetX(XMVector3Dot(e1, pv));
+			if (fabsf(det) < 1e-20f) continue;
+			float inv_det = 1.f / det;
+			XMVECTOR tv = origin - p0;
+			float u = XMVectorGetX(XMVector3Dot(tv, pv)) * inv_det;
+			if (u < 0.f || u > 1.f) continue;
+			XMVECTOR qv = XMVector3Cross(tv, e1);
+			float v = XMVectorGetX(XMVector3Dot(direction, qv)) * inv_det;
+			if (v < 0.f || u + v > 1.f) continue;
+			float d = XMVectorGetX(XMVector3Dot(e2, qv)) * inv_det;
+			if (d < 0.f || d > t) continue;
+			t = d;
+			hit = { d, triangle_id[i], u, v };
+			found = true;
+			if (any_hit) return true;
+		}
+		return false;
+	};
+
+	const node& root = tree[0];
+	if (!hit_box(root, r, t)) return false;
+	if (root.count) {
+		test_leaf(root);
+		return found;
+	}
+
+	//the depth is bounded by the median fallback of the builder, so this never fills up
+	struct entry {
+		uint32_t node;
+		float t_near;
+	};
+	entry stack[256];
+	uint32_t top = 0;
+	stack[top++] = { 0, 0.f };
+	while (top) {
+		entry e = stack[--top];
+		if (e.t_near > t) continue;
+		const node& n = tree[e.node];
+		float t_near[4];
+		uint32_t mask = hit_children(&tree[n.first], r, t, t_near);
+		//interior children go on the stack farthest first, so the nearest is opened next
+		entry push[4];
+		uint32_t pushed = 0;
+		for (uint32_t k = 0; k < 4; ++k) {
+			if (!(mask & (1u << k))) continue;
+			const node& c = tree[n.first + k];
+			if (c.count) {
+				if (test_leaf(c)) return true;
+				continue;
+			}
+			entry x = { n.first + k, t_near[k] };
+			uint32_t j = pushed++;
+			for (; j > 0 && push[j - 1].t_near < x.t_near; --j) push[j] = push[j - 1];
+			push[j] = x;
+		}
+		assert(top + pushed <= 256);
+		for (uint32_t k = 0; k < pushed; ++k) stack[top++] = push[k];
+	}
+	return found;
+}
+
+bool mesh_bvh::intersect(FXMVECTOR origin, FXMVECTOR direction, float t_max, ray_hit& hit) const {
+	return traverse<false>(origin, direction, t_max, hit);
+}
+
+bool mesh_bvh::occluded(FXMVECTOR a, FXMVECTOR b) const {
+	ray_hit hit;
+	return traverse<true>(a, b - a, 1.f, hit);
+}
@@ -0,0 +1,65 @@
+#include "dxut\cmmn.h"
+#include "dxut\cpu_features.h"
+#include <atomic>
+#ifdef _XM_SSE_INTRINSICS_
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	cpu_features detect() {
+		cpu_features f = {};
+#ifdef _XM_SSE_INTRINSICS_
+		int r[4];
+		__cpuid(r, 0);
+		int max_leaf = r[0];
+		if (max_leaf < 1) return f;
+		__cpuid(r, 1);
+		f.sse41 = (r[2] & (1 << 19)) != 0;
+		bool osxsave = (r[2] & (1 << 27)) != 0;
+		bool avx = (r[2] & (1 << 28)) != 0;
+		bool fma = (r[2] & (1 << 12)) != 0;
+		//the OS has to save the ymm (and for AVX-512 the opmask and zmm) registers on context switches
+		uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+		bool ymm = (xcr0 & 0x6) == 0x6, zmm = (xcr0 & 0xe6) == 0xe6;
+		f.avx = avx && ymm;
+		f.fma = fma && f.avx;
+		if (max_leaf >= 7) {
+			__cpuidex(r, 7, 0);
+			f.avx2 = f.avx && (r[1] & (1 << 5)) != 0;
+			f.avx512f = zmm && (r[1] & (1 << 16)) != 0;
+		}
+#endif
+		return f;
+	}
+
+	simd_level supported_level() {
+		const cpu_features& f = get_cpu_features();
+#ifdef _XM_SSE_INTRINSICS_
+		//the avx512 kernels use fma as well, which avx512f implies on every real CPU but not in every VM
+		if (f.avx512f && f.avx2 && f.fma) return simd_level::avx512;
+		if (f.avx2 && f.fma) return simd_level::avx2;
+		return simd_level::sse;
+#else
+		(void)f;
+		return simd_level::scalar;
+#endif
+	}
+
+	atomic<simd_level> level_cap(simd_level::avx512);
+}
+
+const cpu_features& get_cpu_features() {
+	static const cpu_features f = detect();
+	return f;
+}
+
+simd_level max_simd_level() {
+	static const simd_level supported = supported_level();
+	return min(supported, level_cap.load());
+}
+
+void set_max_simd_level(simd_level level) {
+	level_cap = level;
+}
@@ -0,0 +1,193 @@
+#include "dxut\cmmn.h"
+#include "dxut\culling.h"
+#include "dxut\cpu_features.h"
+#ifdef _XM_SSE_INTRINSICS_
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+using namespace std;
+
+frustum_planes extract_frustum_planes(FXMMATRIX view_projection) {
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, view_projection);
+	//row vectors, so clip space x, y, z and w are the dot products with the matrix columns
+	XMVECTOR c0 = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR c1 = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR c2 = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR c3 = XMVectorSet(m._14, m._24, m._34, m._44);
+	XMVECTOR p[6] = { c3 + c0, c3 - c0, c3 + c1, c3 - c1, c2, c3 - c2 };
+	frustum_planes f;
+	for (uint32_t i = 0; i < 6; ++i) XMStoreFloat4(&f.planes[i], XMPlaneNormalize(p[i]));
+	return f;
+}
+
+namespace {
+	//plane components laid out for broadcasting, with the absolute normals that project box extents
+	struct plane_data {
+		float nx[6], ny[6], nz[6], d[6];
+		float ax[6], ay[6], az[6];
+
+		plane_data(const frustum_planes& f) {
+			for (uint32_t p = 0; p < 6; ++p) {
+				nx[p] = f.planes[p].x; ny[p] = f.planes[p].y; nz[p] = f.planes[p].z; d[p] = f.planes[p].w;
+				ax[p] = fabsf(nx[p]); ay[p] = fabsf(ny[p]); az[p] = fabsf(nz[p]);
+			}
+		}
+	};
+
+	//c holds x, y, z and radius for spheres, or center x, y, z and extent x, y, z for boxes; every block
+	//function writes the visible indices of [begin, end) to out and returns how many. The vector versions
+	//write every lane's index and only advance past the kept ones, since which are kept is unpredictable
+	typedef uint32_t(*cull_block)(const plane_data& pd, const float* const* c, uint32_t begin, uint32_t end, uint32_t* out);
+
+	template <bool box>
+	inline bool visible_scalar(const plane_data& pd, const float* const* c, uint32_t i) {
+		for (uint32_t p = 0; p < 6; ++p) {
+			float dist = pd.nx[p] * c[0][i] + pd.ny[p] * c[1][i] + pd.nz[p] * c[2][i] + pd.d[p];
+			float r = box ? pd.ax[p] * c[3][i] + pd.ay[p] * c[4][i] + pd.az[p] * c[5][i] : c[3][i];
+			if (dist + r < 0.f) return false;
+		}
+		return true;
+	}
+
+	template <bool box>
+	uint32_t cull_scalar(const plane_data& pd, const float* const* c, uint32_t begin, uint32_t end, uint32_t* out) {
+		uint32_t n = 0;
+		for (uint32_t i = begin; i < end; ++i)
+			if (visible_scalar<box>(pd, c, i)) out[n++] = i;
+		return n;
+	}
+
+#ifdef _XM_SSE_INTRINSICS_
+	template <bool box>
+	uint32_t cull_sse(const plane_data& pd, const float* const* c, uint32_t begin, uint32_t end, uint32_t* out) {
+		uint32_t n = 0, i = begin;
+		for (; i + 4 <= end; i += 4) {
+			__m128 x = _mm_loadu_ps(c[0] + i), y = _mm_loadu_ps(c[1] + i), z = _mm_loadu_ps(c[2] + i);
+			__m128 e0 = _mm_loadu_ps(c[3] + i), e1 = e0, e2 = e0;
+			if (box) {
+				e1 = _mm_loadu_ps(c[4] + i);
+				e2 = _mm_loadu_ps(c[5] + i);
+			}
+			__m128 keep = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (uint32_t p = 0; p < 6; ++p) {
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(pd.nx[p])), _mm_mul_ps(y, _mm_set1_ps(pd.ny[p]))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(pd.nz[p])), _mm_set1_ps(pd.d[p])));
+				__m128 r = box ? _mm_add_ps(_mm_add_ps(_mm_mul_ps(e0, _mm_set1_ps(pd.ax[p])), _mm_mul_ps(e1, _mm_set1_ps(pd.ay[p]))),
+					_mm_mul_ps(e2, _mm_set1_ps(pd.az[p]))) : e0;
+				keep = _mm_and_ps(keep, _mm_cmpge_ps(_mm_add_ps(dist, r), _mm_setzero_ps()));
+			}
+			uint32_t m = (uint32_t)_mm_movemask_ps(keep);
+			for (uint32_t k = 0; k < 4; ++k) {
+				out[n] = i + k;
+				n += (m >> k) & 1;
+			}
+		}
+		for (; i < end; ++i)
+			if (visible_scalar<box>(pd, c, i)) out[n++] = i;
+		return n;
+	}
+
+	template <bool box>
+	uint32_t cull_avx2(const plane_data& pd, const float* const* c, uint32_t begin, uint32_t end, uint32_t* out) {
+		uint32_t n = 0, i = begin;
+		for (; i + 8 <= end; i += 8) {
+			__m256 x = _mm256_loadu_ps(c[0] + i), y = _mm256_loadu_ps(c[1] + i), z = _mm256_loadu_ps(c[2] + i);
+			__m256 e0 = _mm256_loadu_ps(c[3] + i), e1 = e0, e2 = e0;
+			if (box) {
+				e1 = _mm256_loadu_ps(c[4] + i);
+				e2 = _mm256_loadu_ps(c[5] + i);
+			}
+			__m256 keep = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (uint32_t p = 0; p < 6; ++p) {
+				__m256 dist = _mm256_fmadd_ps(x, _mm256_set1_ps(pd.nx[p]),
+					_mm256_fmadd_ps(y, _mm256_set1_ps(pd.ny[p]), _mm256_fmadd_ps(z, _mm256_set1_ps(pd.nz[p]), _mm256_set1_ps(pd.d[p]))));
+				__m256 r = box ? _mm256_fmadd_ps(e0, _mm256_set1_ps(pd.ax[p]),
+					_mm256_fmadd_ps(e1, _mm256_set1_ps(pd.ay[p]), _mm256_mul_ps(e2, _mm256_set1_ps(pd.az[p])))) : e0;
+				keep = _mm256_and_ps(keep, _mm256_cmp_ps(_mm256_add_ps(dist, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+			uint32_t m = (uint32_t)_mm256_movemask_ps(keep);
+			for (uint32_t k = 0; k < 8; ++k) {
+				out[n] = i + k;
+				n += (m >> k) & 1;
+			}
+		}
+		for (; i < end; ++i)
+			if (visible_scalar<box>(pd, c, i)) out[n++] = i;
+		return n;
+	}
+
+	template <bool box>
+	uint32_t cull_avx512(const plane_data& pd, const float* const* c, uint32_t begin, uint32_t end, uint32_t* out) {
+		uint32_t n = 0, i = begin;
+		__m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		for (; i + 16 <= end; i += 16) {
+			__m512 x = _mm512_loadu_ps(c[0] + i), y = _mm512_loadu_ps(c[1] + i), z = _mm512_loadu_ps(c[2] + i);
+			__m512 e0 = _mm512_loadu_ps(c[3] + i), e1 = e0, e2 = e0;
+			if (box) {
+				e1 = _mm512_loadu_ps(c[4] + i);
+				e2 = _mm512_loadu_ps(c[5] + i);
+			}
+			__mmask16 keep = 0xffff;
+			for (uint32_t p = 0; p < 6; ++p) {
+				__m512 dist = _mm512_fmadd_ps(x, _mm512_set1_ps(pd.nx[p]),
+					_mm512_fmadd_ps(y, _mm512_set1_ps(pd.ny[p]), _mm512_fmadd_ps(z, _mm512_set1_ps(pd.nz[p]), _mm512_set1_ps(pd.d[p]))));
+				__m512 r = box ? _mm512_fmadd_ps(e0, _mm512_set1_ps(pd.ax[p]),
+					_mm512_fmadd_ps(e1, _mm512_set1_ps(pd.ay[p]), _mm512_mul_ps(e2, _mm512_set1_ps(pd.az[p])))) : e0;
+				keep = _mm512_mask_cmp_ps_mask(keep, _mm512_add_ps(dist, r), _mm512_setzero_ps(), _CMP_GE_OQ);
+			}
+			//the indices of the kept lanes, packed together in one store
+			_mm512_mask_compressstoreu_epi32(out + n, keep, _mm512_add_epi32(lanes, _mm512_set1_epi32((int)i)));
+			n += (uint32_t)_mm_popcnt_u32(keep);
+		}
+		for (; i < end; ++i)
+			if (visible_scalar<box>(pd, c, i)) out[n++] = i;
+		return n;
+	}
+#endif
+
+	template <bool box>
+	cull_block pick_block() {
+#ifdef _XM_SSE_INTRINSICS_
+		switch (max_simd_level()) {
+		case simd_level::avx512: return cull_avx512<box>;
+		case simd_level::avx2: return cull_avx2<box>;
+		case simd_level::sse: return cull_sse<box>;
+		default: break;
+		}
+#endif
+		return cull_scalar<box>;
+	}
+
+	size_t cull_soa(const frustum_planes& frustum, const float* const* c, size_t count, cull_block f, vector<uint32_t>& visible) {
+		plane_data pd(frustum);
+		visible.resize(count);
+		//blocks write their indices in place, and are moved together afterwards
+		const uint32_t block_size = 8192;
+		uint32_t block_count = (uint32_t)((count + block_size - 1) / block_size);
+		vector<uint32_t> found(block_count);
+		parallel_for(0u, block_count, [&](uint32_t b) {
+			uint32_t begin = b * block_size, end = (uint32_t)min((size_t)begin + block_size, count);
+			found[b] = f(pd, c, begin, end, visible.data() + begin);
+		});
+		size_t n = 0;
+		for (uint32_t b = 0; b < block_count; ++b) {
+			if (n != (size_t)b * block_size) memmove(visible.data() + n, visible.data() + (size_t)b * block_size, found[b] * sizeof(uint32_t));
+			n += found[b];
+		}
+		visible.resize(n);
+		return n;
+	}
+}
+
+size_t cull(const frustum_planes& frustum, const sphere_bounds_soa& spheres, vector<uint32_t>& visible) {
+	const float* c[] = { spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.radius.data() };
+	return cull_soa(frustum, c, spheres.size(), pick_block<false>(), visible);
+}
+
+size_t cull(const frustum_planes& frustum, const box_bounds_soa& boxes, vector<uint32_t>& visible) {
+	const float* c[] = { boxes.center_x.data(), boxes.center_y.data(), boxes.center_z.data(),
+		boxes.extent_x.data(), boxes.extent_y.data(), boxes.extent_z.data() };
+	return cull_soa(frustum, c, boxes.size(), pick_block<true>(), visible);
+}
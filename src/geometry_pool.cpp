@@ -0,0 +1,172 @@
+#include "dxut\cmmn.h"
+#include "dxut\geometry_pool.h"
+
+using namespace DirectX;
+using namespace std;
+
+geometry_allocation::~geometry_allocation() {
+	if (pool) pool->release(this);
+}
+
+geometry_pool::geometry_pool(DXDevice* dv, uint32_t vertex_stride, uint32_t vertex_capacity, uint32_t index_capacity,
+	DXGI_FORMAT index_format)
+	: dv(dv), stride(vertex_stride), index_format(index_format),
+	index_stride(index_format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t)),
+	vertex_space(max(vertex_capacity, 1u)), index_space(max(index_capacity, 1u))
+{
+	assert(index_format == DXGI_FORMAT_R16_UINT || index_format == DXGI_FORMAT_R32_UINT);
+	vbuf = create_buffer(vertex_space.capacity() * stride, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+	ibuf = create_buffer(index_space.capacity() * index_stride, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+	update_views();
+}
+
+ComPtr<ID3D12Resource> geometry_pool::create_buffer(uint64_t size, D3D12_RESOURCE_STATES state) {
+	ComPtr<ID3D12Resource> r;
+	chk(dv->device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		state,
+		nullptr,
+		IID_PPV_ARGS(&r)));
+	return r;
+}
+
+void geometry_pool::update_views() {
+	vbv.BufferLocation = vbuf->GetGPUVirtualAddress();
+	vbv.StrideInBytes = stride;
+	vbv.SizeInBytes = (UINT)(vertex_space.capacity() * stride);
+	ibv.BufferLocation = ibuf->GetGPUVirtualAddress();
+	ibv.Format = index_format;
+	ibv.SizeInBytes = (UINT)(index_space.capacity() * index_stride);
+}
+
+shared_ptr<geometry_allocation> geometry_pool::allocate(ComPtr<ID3D12GraphicsCommandList> commandList,
+	const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count)
+{
+	assert(vertex_count > 0 && index_count > 0);
+
+	uint64_t vo = vertex_space.allocate(vertex_count), io = index_space.allocate(index_count);
+	if (vo == range_allocator::invalid || io == range_allocator::invalid) {
+		//the buffer that ran out gets copied into one of at least twice the size anyway, so it is packed on the way
+		if (vo != range_allocator::invalid) vertex_space.release(vo);
+		if (io != range_allocator::invalid) index_space.release(io);
+		uint64_t vcap = vertex_space.capacity(), icap = index_space.capacity();
+		vector<range_allocator::relocation> vmoves, imoves;
+		if (vertex_space.largest_free() < vertex_count) {
+			do vcap *= 2; while (vcap - vertex_space.used() < vertex_count);
+			vmoves = vertex_space.defragment();
+		}
+		if (index_space.largest_free() < index_count) {
+			do icap *= 2; while (icap - index_space.used() < index_count);
+			imoves = index_space.defragment();
+		}
+		rebuild(commandList, vcap, icap, vmoves, imoves);
+
+		vo = vertex_space.allocate(vertex_count);
+		io = index_space.allocate(index_count);
+		assert(vo != range_allocator::invalid && io != range_allocator::invalid);
+	}
+
+	auto a = make_shared<geometry_allocation>();
+	a->pool = this;
+	a->base_vertex = (uint32_t)vo;
+	a->vertex_count = vertex_count;
+	a->start_index = (uint32_t)io;
+	a->index_count = index_count;
+	live[a->start_index] = a.get();
+
+#pragma region upload
+	uint64_t vertex_size = (uint64_t)vertex_count * stride, index_size = (uint64_t)index_count * index_stride;
+	uint64_t index_at = aligned_size256(vertex_size);
+	auto up = dv->new_upload_resource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(index_at + index_size),
+		D3D12_RESOURCE_STATE_GENERIC_READ);
+	uint8_t* dst;
+	CD3DX12_RANGE no_read(0, 0);
+	chk(up->Map(0, &no_read, (void**)&dst));
+	memcpy(dst, vertices, (size_t)vertex_size);
+	if (index_format == DXGI_FORMAT_R16_UINT) {
+		uint16_t* small_indices = (uint16_t*)(dst + index_at);
+		for (uint32_t i = 0; i < index_count; ++i) {
+			assert(indices[i] <= 0xffff);
+			small_indices[i] = (uint16_t)indices[i];
+		}
+	} else memcpy(dst + index_at, indices, (size_t)index_size);
+	up->Unmap(0, nullptr);
+
+	D3D12_RESOURCE_BARRIER to_copy[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(vbuf.Get(),
+			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_COPY_DEST),
+		CD3DX12_RESOURCE_BARRIER::Transition(ibuf.Get(),
+			D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_RESOURCE_STATE_COPY_DEST)
+	};
+	commandList->ResourceBarrier(2, to_copy);
+	commandList->CopyBufferRegion(vbuf.Get(), vo * stride, up.Get(), 0, vertex_size);
+	commandList->CopyBufferRegion(ibuf.Get(), io * index_stride, up.Get(), index_at, index_size);
+	D3D12_RESOURCE_BARRIER to_read[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(vbuf.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
+		CD3DX12_RESOURCE_BARRIER::Transition(ibuf.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER)
+	};
+	commandList->ResourceBarrier(2, to_read);
+#pragma endregion
+
+	return a;
+}
+
+void geometry_pool::release(geometry_allocation* a) {
+	live.erase(a->start_index);
+	vertex_space.release(a->base_vertex);
+	index_space.release(a->start_index);
+	a->pool = nullptr;
+}
+
+void geometry_pool::defragment(ComPtr<ID3D12GraphicsCommandList> commandList) {
+	//a side with at most one free range is packed already, so it keeps its buffer
+	vector<range_allocator::relocation> vmoves, imoves;
+	if (vertex_space.free_range_count() > 1) vmoves = vertex_space.defragment();
+	if (index_space.free_range_count() > 1) imoves = index_space.defragment();
+	if (vmoves.empty() && imoves.empty()) return;
+	rebuild(commandList, vertex_space.capacity(), index_space.capacity(), vmoves, imoves);
+}
+
+void geometry_pool::rebuild(ComPtr<ID3D12GraphicsCommandList> commandList, uint64_t vertex_capacity, uint64_t index_capacity,
+	const vector<range_allocator::relocation>& vertex_moves, const vector<range_allocator::relocation>& index_moves)
+{
+	//allocations are found by their index range, so patch the vertex side through a lookup by old base vertex
+	map<uint32_t, geometry_allocation*> by_vertex;
+	for (auto& l : live) by_vertex[l.second->base_vertex] = l.second;
+
+	auto rebuild_buffer = [&](ComPtr<ID3D12Resource>& buf, range_allocator& space, uint64_t capacity, uint32_t unit,
+		D3D12_RESOURCE_STATES read_state, const vector<range_allocator::relocation>& moves)
+	{
+		bool in_place = all_of(moves.begin(), moves.end(), [](const range_allocator::relocation& m) { return m.from == m.to; });
+		if (capacity == space.capacity() && in_place) return;
+		auto old = buf;
+		buf = create_buffer(capacity * unit, D3D12_RESOURCE_STATE_COPY_DEST);
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(old.Get(),
+			read_state, D3D12_RESOURCE_STATE_COPY_SOURCE));
+		for (const auto& m : moves)
+			commandList->CopyBufferRegion(buf.Get(), m.to * unit, old.Get(), m.from * unit, m.size * unit);
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(buf.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, read_state));
+		dv->retire(old);
+		if (capacity > space.capacity()) space.grow(capacity);
+	};
+	rebuild_buffer(vbuf, vertex_space, vertex_capacity, stride, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, vertex_moves);
+	rebuild_buffer(ibuf, index_space, index_capacity, index_stride, D3D12_RESOURCE_STATE_INDEX_BUFFER, index_moves);
+
+	for (const auto& m : vertex_moves) by_vertex[(uint32_t)m.from]->base_vertex = (uint32_t)m.to;
+	if (!index_moves.empty()) {
+		map<uint32_t, geometry_allocation*> moved;
+		for (const auto& m : index_moves) {
+			geometry_allocation* a = live[(uint32_t)m.from];
+			a->start_index = (uint32_t)m.to;
+			moved[a->start_index] = a;
+		}
+		live = move(moved);
+	}
+	update_views();
+}
@@ -0,0 +1,97 @@
+#include "dxut\cmmn.h"
+#include "dxut\instance_buffer.h"
+#include "dxut\transform.h"
+
+using namespace std;
+
+dynamic_instance_buffer::dynamic_instance_buffer(DXDevice* dv, uint32_t stride, uint32_t capacity)
+	: dv(dv), instance_stride(stride), cap(max(capacity, 1u)), count(0), mapped(nullptr)
+{
+	data.resize((size_t)cap * instance_stride);
+	create_buffer();
+}
+
+dynamic_instance_buffer::~dynamic_instance_buffer() {
+	if (buffer) buffer->Unmap(0, nullptr);
+}
+
+void dynamic_instance_buffer::create_buffer() {
+	//every slot starts on a 256 byte boundary, like constant buffers do
+	uint64_t slot_size = aligned_size256((uint64_t)cap * instance_stride);
+	chk(dv->device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(slot_size * DXDevice::FrameCount),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&buffer)));
+	CD3DX12_RANGE no_read(0, 0);
+	chk(buffer->Map(0, &no_read, (void**)&mapped));
+
+	for (uint32_t f = 0; f < DXDevice::FrameCount; ++f) {
+		views[f].BufferLocation = buffer->GetGPUVirtualAddress() + f * slot_size;
+		views[f].StrideInBytes = instance_stride;
+		views[f].SizeInBytes = count * instance_stride;
+		//a new buffer has nothing in it yet
+		dirty[f] = { 0, count };
+	}
+}
+
+void dynamic_instance_buffer::resize(uint32_t n) {
+	if (n > cap) {
+		//the old buffer may still be read by frames in flight, so it is released once they are done
+		buffer->Unmap(0, nullptr);
+		dv->retire(buffer);
+		buffer.Reset();
+		cap = max(n, cap * 2);
+		data.resize((size_t)cap * instance_stride);
+		count = n;
+		create_buffer();
+		return;
+	}
+	if (n > count) mark(count, n);
+	count = n;
+	for (uint32_t f = 0; f < DXDevice::FrameCount; ++f) views[f].SizeInBytes = count * instance_stride;
+}
+
+void dynamic_instance_buffer::mark(uint32_t begin, uint32_t end) {
+	for (auto& d : dirty) {
+		if (d.begin >= d.end) d = { begin, end };
+		else d = { min(d.begin, begin), max(d.end, end) };
+	}
+}
+
+void* dynamic_instance_buffer::instance(uint32_t i) {
+	assert(i < count);
+	mark(i, i + 1);
+	return data.data() + (size_t)i * instance_stride;
+}
+
+void dynamic_instance_buffer::update(uint32_t first, uint32_t n, const void* src) {
+	assert(first + n <= count);
+	if (n == 0) return;
+	memcpy(data.data() + (size_t)first * instance_stride, src, (size_t)n * instance_stride);
+	mark(first, first + n);
+}
+
+void dynamic_instance_buffer::update_transforms(uint32_t first, uint32_t n, const XMFLOAT4X4* world, size_t world_stride,
+	FXMMATRIX view_projection, uint32_t offset, bool transpose)
+{
+	assert(first + n <= count && offset + sizeof(XMFLOAT4X4) <= instance_stride);
+	if (n == 0) return;
+	multiply_matrices(world, world_stride, n, view_projection, data.data() + (size_t)first * instance_stride + offset,
+		instance_stride, transpose);
+	mark(first, first + n);
+}
+
+const D3D12_VERTEX_BUFFER_VIEW& dynamic_instance_buffer::upload(uint32_t frame) {
+	assert(frame < DXDevice::FrameCount);
+	dirty_range& d = dirty[frame];
+	uint32_t end = min(d.end, count);
+	if (d.begin < end) {
+		uint64_t slot_size = aligned_size256((uint64_t)cap * instance_stride);
+		size_t offset = (size_t)d.begin * instance_stride;
+		memcpy(mapped + frame * slot_size + offset, data.data() + offset, (size_t)(end - d.begin) * instance_stride);
+	}
+	d = { 0, 0 };
+	return views[frame];
+}
@@ -0,0 +1,176 @@
+#include "dxut\cmmn.h"
+#include "dxut\isosurface.h"
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+	//some unit vector perpendicular to n
+	inline XMVECTOR any_perpendicular(FXMVECTOR n) {
+		XMVECTOR axis = fabsf(XMVectorGetX(n)) < 0.9f ? XMVectorSet(1.f, 0.f, 0.f, 0.f) : XMVectorSet(0.f, 1.f, 0.f, 0.f);
+		return XMVector3Normalize(XMVector3Cross(n, axis));
+	}
+
+	struct sample_grid {
+		const float* s;
+		uint32_t nx, ny, nz;
+
+		float at(uint32_t x, uint32_t y, uint32_t z) const { return s[((size_t)z * ny + y) * nx + x]; }
+
+		//central differences in sample units, one sided at the border
+		XMVECTOR gradient(uint32_t x, uint32_t y, uint32_t z) const {
+			uint32_t x0 = x ? x - 1 : 0, x1 = min(x + 1, nx - 1);
+			uint32_t y0 = y ? y - 1 : 0, y1 = min(y + 1, ny - 1);
+			uint32_t z0 = z ? z - 1 : 0, z1 = min(z + 1, nz - 1);
+			return XMVectorSet((at(x1, y, z) - at(x0, y, z)) / (float)(x1 - x0),
+				(at(x, y1, z) - at(x, y0, z)) / (float)(y1 - y0),
+				(at(x, y, z1) - at(x, y, z0)) / (float)(z1 - z0), 0.f);
+		}
+	};
+
+	//gradient(cell x, y, z, position within the cell in [0, 1]^3, world position) gives the unnormalized normal
+	template <typename Gradient>
+	mesh_data surface_nets(const sample_grid& g, XMFLOAT3 origin, float spacing, float iso, Gradient gradient) {
+		mesh_data D;
+		if (g.nx < 2 || g.ny < 2 || g.nz < 2) return D;
+		uint32_t cx = g.nx - 1, cy = g.ny - 1, cz = g.nz - 1;
+		XMVECTOR o = XMLoadFloat3(&origin);
+
+#pragma region vertices
+		//index of the vertex of each cell, or -1; local to the cell's slab until the slabs are concatenated
+		vector<int32_t> cell_vertex((size_t)cx * cy * cz, -1);
+		vector<vector<vertex>> slab_vertices(cz);
+		parallel_for(0u, cz, [&](uint32_t z) {
+			auto& sv = slab_vertices[z];
+			for (uint32_t y = 0; y < cy; ++y) {
+				for (uint32_t x = 0; x < cx; ++x) {
+					//corner i is at (i & 1, (i >> 1) & 1, i >> 2)
+					float v[8];
+					uint32_t inside = 0;
+					for (uint32_t i = 0; i < 8; ++i) {
+						v[i] = g.at(x + (i & 1), y + ((i >> 1) & 1), z + (i >> 2));
+						if (v[i] < iso) inside |= 1u << i;
+					}
+					if (inside == 0 || inside == 0xff) continue;
+
+					XMVECTOR sum = XMVectorZero();
+					float n = 0.f;
+					for (uint32_t i = 0; i < 8; ++i) {
+						for (uint32_t bit = 1; bit < 8; bit <<= 1) {
+							if (i & bit) continue;
+							uint32_t j = i | bit;
+							if (((inside >> i) & 1) == ((inside >> j) & 1)) continue;
+							float t = (iso - v[i]) / (v[j] - v[i]);
+							XMVECTOR a = XMVectorSet((float)(i & 1), (float)((i >> 1) & 1), (float)(i >> 2), 0.f);
+							XMVECTOR b = XMVectorSet((float)(j & 1), (float)((j >> 1) & 1), (float)(j >> 2), 0.f);
+							sum += XMVectorLerp(a, b, t);
+							n += 1.f;
+						}
+					}
+					XMFLOAT3 f;
+					XMStoreFloat3(&f, sum / n);
+					XMVECTOR p = o + XMVectorSet(x + f.x, y + f.y, z + f.z, 0.f) * spacing;
+					XMFLOAT3 pw;
+					XMStoreFloat3(&pw, p);
+					XMVECTOR nrm = gradient(x, y, z, f, pw);
+					nrm = XMVectorGetX(XMVector3LengthSq(nrm)) > 0.f ? XMVector3Normalize(nrm) : XMVectorSet(0.f, 1.f, 0.f, 0.f);
+					cell_vertex[((size_t)z * cy + y) * cx + x] = (int32_t)sv.size();
+					sv.emplace_back(p, nrm, XMVectorZero(), any_perpendicular(nrm));
+				}
+			}
+		});
+
+		vector<uint32_t> vertex_offset(cz + 1, 0);
+		for (uint32_t z = 0; z < cz; ++z) vertex_offset[z + 1] = vertex_offset[z] + (uint32_t)slab_vertices[z].size();
+		auto& V = get<0>(D);
+		V.resize(vertex_offset[cz]);
+		parallel_for(0u, cz, [&](uint32_t z) {
+			copy(slab_vertices[z].begin(), slab_vertices[z].end(), V.begin() + vertex_offset[z]);
+			vector<vertex>().swap(slab_vertices[z]);
+			int32_t* cv = cell_vertex.data() + (size_t)z * cy * cx;
+			for (size_t c = 0; c < (size_t)cy * cx; ++c)
+				if (cv[c] >= 0) cv[c] += (int32_t)vertex_offset[z];
+		});
+#pragma endregion
+
+#pragma region quads
+		//every crossed grid edge joins the vertices of the four cells around it; the quad faces up the
+		//edge's axis when the edge goes from inside to outside
+		vector<vector<uint32_t>> slab_indices(g.nz);
+		parallel_for(0u, g.nz, [&](uint32_t z) {
+			auto& si = slab_indices[z];
+			uint32_t dims[3] = { g.nx, g.ny, g.nz };
+			for (uint32_t y = 0; y < g.ny; ++y) {
+				for (uint32_t x = 0; x < g.nx; ++x) {
+					uint32_t p[3] = { x, y, z };
+					bool in0 = g.at(x, y, z) < iso;
+					for (uint32_t a = 0; a < 3; ++a) {
+						uint32_t b = (a + 1) % 3, c = (a + 2) % 3;
+						if (p[a] + 1 >= dims[a] || p[b] == 0 || p[b] + 1 >= dims[b] || p[c] == 0 || p[c] + 1 >= dims[c]) continue;
+						uint32_t q[3] = { x, y, z };
+						q[a]++;
+						bool in1 = g.at(q[0], q[1], q[2]) < iso;
+						if (in0 == in1) continue;
+
+						auto cell = [&](uint32_t db, uint32_t dc) {
+							uint32_t r[3] = { x, y, z };
+							r[b] -= db;
+							r[c] -= dc;
+							return (uint32_t)cell_vertex[((size_t)r[2] * cy + r[1]) * cx + r[0]];
+						};
+						uint32_t c00 = cell(1, 1), c10 = cell(0, 1), c11 = cell(0, 0), c01 = cell(1, 0);
+						if (in0) {
+							uint32_t tris[] = { c00, c10, c11, c00, c11, c01 };
+							si.insert(si.end(), tris, tris + 6);
+						} else {
+							uint32_t tris[] = { c00, c11, c10, c00, c01, c11 };
+							si.insert(si.end(), tris, tris + 6);
+						}
+					}
+				}
+			}
+		});
+
+		vector<size_t> index_offset(g.nz + 1, 0);
+		for (uint32_t z = 0; z < g.nz; ++z) index_offset[z + 1] = index_offset[z] + slab_indices[z].size();
+		auto& I = get<1>(D);
+		I.resize(index_offset[g.nz]);
+		parallel_for(0u, g.nz, [&](uint32_t z) {
+			copy(slab_indices[z].begin(), slab_indices[z].end(), I.begin() + index_offset[z]);
+		});
+#pragma endregion
+		return D;
+	}
+}
+
+mesh_data generate_isosurface_mesh(const float* samples, XMUINT3 dims, XMFLOAT3 origin, float spacing, float iso) {
+	sample_grid g = { samples, dims.x, dims.y, dims.z };
+	//the corner gradients blended across the cell the same way the values are
+	return surface_nets(g, origin, spacing, iso, [&](uint32_t x, uint32_t y, uint32_t z, const XMFLOAT3& f, const XMFLOAT3&) {
+		XMVECTOR n = XMVectorZero();
+		for (uint32_t i = 0; i < 8; ++i) {
+			float w = ((i & 1) ? f.x : 1.f - f.x) * (((i >> 1) & 1) ? f.y : 1.f - f.y) * ((i >> 2) ? f.z : 1.f - f.z);
+			n += g.gradient(x + (i & 1), y + ((i >> 1) & 1), z + (i >> 2)) * w;
+		}
+		return n;
+	});
+}
+
+mesh_data generate_isosurface_mesh(const function<float(const XMFLOAT3&)>& field, XMUINT3 dims, XMFLOAT3 origin,
+	float spacing, float iso)
+{
+	vector<float> samples((size_t)dims.x * dims.y * dims.z);
+	parallel_for(0u, dims.y * dims.z, [&](uint32_t row) {
+		uint32_t y = row % dims.y, z = row / dims.y;
+		float* s = samples.data() + (size_t)row * dims.x;
+		for (uint32_t x = 0; x < dims.x; ++x)
+			s[x] = field(XMFLOAT3(origin.x + x * spacing, origin.y + y * spacing, origin.z + z * spacing));
+	});
+	sample_grid g = { samples.data(), dims.x, dims.y, dims.z };
+	float h = spacing * 0.5f;
+	return surface_nets(g, origin, spacing, iso, [&](uint32_t, uint32_t, uint32_t, const XMFLOAT3&, const XMFLOAT3& p) {
+		return XMVectorSet(field(XMFLOAT3(p.x + h, p.y, p.z)) - field(XMFLOAT3(p.x - h, p.y, p.z)),
+			field(XMFLOAT3(p.x, p.y + h, p.z)) - field(XMFLOAT3(p.x, p.y - h, p.z)),
+			field(XMFLOAT3(p.x, p.y, p.z + h)) - field(XMFLOAT3(p.x, p.y, p.z - h)), 0.f);
+	});
+}
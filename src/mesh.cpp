@@ -5,7 +5,8 @@ using namespace DirectX;
 using namespace std;
 
 mesh::mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList,
-	void* vertices, size_t total_vertex_size, size_t vertex_stride, void* indices, size_t indices_size, uint32_t idxcnt)
+	void* vertices, size_t total_vertex_size, size_t vertex_stride, void* indices, size_t indices_size, uint32_t idxcnt,
+	DXGI_FORMAT index_format)
 {	
 	D3D12_SUBRESOURCE_DATA srd = {};
 #pragma region vertices
@@ -51,7 +52,7 @@ mesh::mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList,
 	UpdateSubresources<1>(commandList.Get(), ibufres.Get(), ibufup.Get(), 0, 0, 1, &srd);
 
 	ibv.BufferLocation = ibufres->GetGPUVirtualAddress();
-	ibv.Format = DXGI_FORMAT_R32_UINT;
+	ibv.Format = index_format;
 	ibv.SizeInBytes = indices_size;
 
 	num_indices = idxcnt;
@@ -96,70 +97,215 @@ void mesh::create_instance_buffer(DXDevice * dv, ComPtr<ID3D12GraphicsCommandLis
 		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
 }
 
+void compute_bounds(const void* positions, size_t count, size_t stride, BoundingBox& box, BoundingSphere& sphere) {
+	if (count == 0) {
+		box = BoundingBox(XMFLOAT3(0.f, 0.f, 0.f), XMFLOAT3(0.f, 0.f, 0.f));
+		sphere = BoundingSphere(XMFLOAT3(0.f, 0.f, 0.f), 0.f);
+		return;
+	}
+	const uint8_t* base = (const uint8_t*)positions;
+	auto load = [&](size_t i) { return XMLoadFloat3((const XMFLOAT3*)(base + i * stride)); };
+
+	const size_t chunk_size = 16384;
+	size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+#pragma region box
+	//per chunk min/max, along with which points attain them so the Ritter seed comes for free;
+	//the indices ride along in the integer lanes of a vector and are picked with the same masks
+	struct extremes {
+		XMVECTOR lo, hi;
+		XMVECTOR lo_at, hi_at;
+	};
+	vector<extremes> chunks(chunk_count);
+	parallel_for(size_t(0), chunk_count, [&](size_t c) {
+		size_t begin = c * chunk_size, end = min(count, begin + chunk_size);
+		extremes e;
+		e.lo = e.hi = load(begin);
+		e.lo_at = e.hi_at = XMVectorReplicateInt((uint32_t)begin);
+		for (size_t i = begin + 1; i < end; ++i) {
+			XMVECTOR p = load(i);
+			XMVECTOR at = XMVectorReplicateInt((uint32_t)i);
+			XMVECTOR less = XMVectorLess(p, e.lo), greater = XMVectorGreater(p, e.hi);
+			e.lo = XMVectorSelect(e.lo, p, less);
+			e.lo_at = XMVectorSelect(e.lo_at, at, less);
+			e.hi = XMVectorSelect(e.hi, p, greater);
+			e.hi_at = XMVectorSelect(e.hi_at, at, greater);
+		}
+		chunks[c] = e;
+	});
+	extremes all = chunks[0];
+	for (size_t c = 1; c < chunk_count; ++c) {
+		XMVECTOR less = XMVectorLess(chunks[c].lo, all.lo), greater = XMVectorGreater(chunks[c].hi, all.hi);
+		all.lo = XMVectorSelect(all.lo, chunks[c].lo, less);
+		all.lo_at = XMVectorSelect(all.lo_at, chunks[c].lo_at, less);
+		all.hi = XMVectorSelect(all.hi, chunks[c].hi, greater);
+		all.hi_at = XMVectorSelect(all.hi_at, chunks[c].hi_at, greater);
+	}
+	BoundingBox::CreateFromPoints(box, all.lo, all.hi);
+#pragma endregion
+
+#pragma region sphere
+	XMVECTOR box_center = (all.lo + all.hi) * 0.5f;
+	vector<float> chunk_radius(chunk_count);
+	parallel_for(size_t(0), chunk_count, [&](size_t c) {
+		size_t begin = c * chunk_size, end = min(count, begin + chunk_size);
+		XMVECTOR r = XMVectorZero();
+		for (size_t i = begin; i < end; ++i) r = XMVectorMax(r, XMVector3LengthSq(load(i) - box_center));
+		chunk_radius[c] = XMVectorGetX(r);
+	});
+	float box_radius = sqrtf(*max_element(chunk_radius.begin(), chunk_radius.end()));
+
+	//Ritter: start from the most distant pair of extremal points, then grow to cover every point
+	uint32_t lo_at[4], hi_at[4];
+	XMStoreInt4(lo_at, all.lo_at);
+	XMStoreInt4(hi_at, all.hi_at);
+	XMVECTOR a = load(lo_at[0]), b = load(hi_at[0]);
+	for (uint32_t axis = 1; axis < 3; ++axis) {
+		XMVECTOR pa = load(lo_at[axis]), pb = load(hi_at[axis]);
+		if (XMVectorGetX(XMVector3LengthSq(pb - pa)) > XMVectorGetX(XMVector3LengthSq(b - a))) {
+			a = pa;
+			b = pb;
+		}
+	}
+	XMVECTOR center = (a + b) * 0.5f;
+	float radius = XMVectorGetX(XMVector3Length(b - a)) * 0.5f;
+	for (size_t i = 0; i < count; ++i) {
+		XMVECTOR d = load(i) - center;
+		float dist = XMVectorGetX(XMVector3Length(d));
+		if (dist > radius) {
+			float grown = (radius + dist) * 0.5f;
+			center += d * ((grown - radius) / dist);
+			radius = grown;
+		}
+	}
+
+	if (box_radius <= radius) {
+		center = box_center;
+		radius = box_radius;
+	}
+	XMStoreFloat3(&sphere.Center, center);
+	sphere.Radius = radius;
+#pragma endregion
+}
+
+static DXGI_FORMAT choose_index_format(const vector<uint32_t>& indices) {
+	uint32_t max_index = 0;
+	for (auto i : indices) max_index = max(max_index, i);
+	return max_index <= 0xffff ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
 mesh::mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList,
+	const vector<vertex>& vertices, const vector<uint32_t>& indices, DXGI_FORMAT index_format)
+{
+	if (index_format == DXGI_FORMAT_UNKNOWN) index_format = choose_index_format(indices);
+
+	if (index_format == DXGI_FORMAT_R16_UINT) {
+		vector<uint16_t> small_indices(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i) {
+			assert(indices[i] <= 0xffff);
+			small_indices[i] = (uint16_t)indices[i];
+		}
+		*this = mesh(dv, commandList,
+			(void*)vertices.data(), sizeof(vertex)*vertices.size(), sizeof(vertex),
+			(void*)small_indices.data(), sizeof(uint16_t)*small_indices.size(), small_indices.size(), DXGI_FORMAT_R16_UINT);
+	} else {
+		*this = mesh(dv, commandList,
+			(void*)vertices.data(), sizeof(vertex)*vertices.size(), sizeof(vertex),
+			(void*)indices.data(), sizeof(uint32_t)*indices.size(), indices.size(), DXGI_FORMAT_R32_UINT);
+	}
+	compute_bounds(vertices.data(), vertices.size(), sizeof(vertex), bounding_box, bounding_sphere);
+}
+
+mesh::mesh(geometry_pool& pool, ComPtr<ID3D12GraphicsCommandList> commandList,
 	const vector<vertex>& vertices, const vector<uint32_t>& indices)
-	: mesh(dv, commandList, 
-		(void*)vertices.data(), sizeof(vertex)*vertices.size(), sizeof(vertex),
-		(void*)indices.data(),  sizeof(uint32_t)*indices.size(), indices.size())
-{}
+	: vbv(), ibv()
+{
+	assert(pool.vertex_stride() == sizeof(vertex));
+	allocation = pool.allocate(commandList, vertices.data(), (uint32_t)vertices.size(), indices.data(), (uint32_t)indices.size());
+	num_indices = (uint32_t)indices.size();
+	compute_bounds(vertices.data(), vertices.size(), sizeof(vertex), bounding_box, bounding_sphere);
+}
 
 mesh_data generate_sphere_mesh(float radius, uint32_t Islices, uint32_t Istacks) {
-	vector<vertex> vertices; vector<uint32_t> indices;
-	vertices.push_back(vertex(0.f, radius, 0.f, 0.f, 1.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f)); //top vertex
+	//below two stacks there is no ring to hang the caps on
+	if (Istacks < 2) return{};
 
 	auto slices = (float)Islices, stacks = (float)Istacks;
 
 	float dphi = XM_PI/stacks;
 	float dtheta = XM_2PI/slices;
 
-	for(uint32_t i = 1; i <= stacks-1; ++i) {
+	uint32_t ringVertexCount = Islices + 1;
+	uint32_t ringCount = Istacks - 1;
+
+	//sizes are known up front: two poles plus stacks-1 rings, and 6 indices per slice per stack
+	vector<vertex> vertices(2 + ringCount*ringVertexCount);
+	vector<uint32_t> indices(6 * Islices * ringCount);
+
+	vertices[0] = vertex(0.f, radius, 0.f, 0.f, 1.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f); //top vertex
+	vertices[vertices.size()-1] = vertex(0.f, -radius, 0.f, 0.f, -1.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f); //bottom vertex
+
+	//every ring shares the same theta values, so evaluate them once instead of per vertex
+	vector<float> sin_theta(ringVertexCount), cos_theta(ringVertexCount);
+	for(uint32_t j = 0; j < ringVertexCount; ++j) {
+		float theta = j*dtheta;
+		sin_theta[j] = sinf(theta);
+		cos_theta[j] = cosf(theta);
+	}
+
+	parallel_for(1u, Istacks, [&](uint32_t i) {
 		float phi = i*dphi;
-		for(uint32_t j = 0; j <= slices; ++j) {
+		float sin_phi = sinf(phi), cos_phi = cosf(phi);
+		vertex* ring = vertices.data() + 1 + (i-1)*ringVertexCount;
+		for(uint32_t j = 0; j < ringVertexCount; ++j) {
 			float theta = j*dtheta;
 			auto P = XMVectorSet(
-				radius*sinf(phi)*cosf(theta),
-				radius*cosf(phi),
-				radius*sinf(phi)*sinf(theta), 1.f);
+				radius*sin_phi*cos_theta[j],
+				radius*cos_phi,
+				radius*sin_phi*sin_theta[j], 1.f);
 			auto T = XMVectorSet(
-				-radius*sinf(phi)*sinf(theta),
+				-radius*sin_phi*sin_theta[j],
 				0.f,
-				radius*sinf(phi)*cosf(theta), 0.f);
-			vertices.push_back(vertex(P, XMVector3Normalize(P), XMVectorSet(theta/XM_2PI, phi/XM_PI,0.f,0.f), XMVector3Normalize(T)));
+				radius*sin_phi*cos_theta[j], 0.f);
+			ring[j] = vertex(P, XMVector3Normalize(P), XMVectorSet(theta/XM_2PI, phi/XM_PI,0.f,0.f), XMVector3Normalize(T));
 		}
-	}
+	});
 
-	vertices.push_back(vertex(0.f, -radius, 0.f, 0.f, -1.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f)); //top vertex
-	
+	uint32_t* idx = indices.data();
 	for(uint32_t i = 1; i <= slices; ++i) {
-		indices.push_back(0);
-		indices.push_back(i+1);
-		indices.push_back(i);
+		*idx++ = 0;
+		*idx++ = i+1;
+		*idx++ = i;
 	}
 
 	uint32_t baseIndex = 1;
-	uint32_t ringVertexCount = slices + 1;
-	for(uint32_t i = 0; i < stacks-2; ++i) {
-		for(uint32_t j = 0; j < slices; ++j) {
-			indices.push_back(baseIndex + i*ringVertexCount + j);
-			indices.push_back(baseIndex + i*ringVertexCount + j+1);
-			indices.push_back(baseIndex + (i+1)*ringVertexCount + j);
-
-			indices.push_back(baseIndex + (i+1)*ringVertexCount + j);
-			indices.push_back(baseIndex + i*ringVertexCount + j+1);
-			indices.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
-		}
+	uint32_t* body = idx;
+	if(Istacks > 2) {
+		parallel_for(0u, Istacks-2, [&](uint32_t i) {
+			uint32_t* ix = body + 6*i*Islices;
+			for(uint32_t j = 0; j < slices; ++j) {
+				*ix++ = baseIndex + i*ringVertexCount + j;
+				*ix++ = baseIndex + i*ringVertexCount + j+1;
+				*ix++ = baseIndex + (i+1)*ringVertexCount + j;
+
+				*ix++ = baseIndex + (i+1)*ringVertexCount + j;
+				*ix++ = baseIndex + i*ringVertexCount + j+1;
+				*ix++ = baseIndex + (i+1)*ringVertexCount + j+1;
+			}
+		});
+		idx += 6*(Istacks-2)*Islices;
 	}
 
 	uint32_t spix = (uint32_t)vertices.size()-1;
 	baseIndex = spix - ringVertexCount;
 	
 	for(uint32_t i = 0; i < slices; ++i) {
-		indices.push_back(spix);
-		indices.push_back(baseIndex+i);
-		indices.push_back(baseIndex+i+1);
+		*idx++ = spix;
+		*idx++ = baseIndex+i;
+		*idx++ = baseIndex+i+1;
 	}
 
-	return{ vertices,indices };
+	return{ move(vertices), move(indices) };
 }
 
 mesh_data generate_cube_mesh(XMFLOAT3 extents) {
@@ -262,17 +408,17 @@ unique_ptr<mesh> mesh::create_full_screen_quad(DXDevice* dv, ComPtr<ID3D12Graphi
 	v[1] = XMFLOAT2(extents.x, -extents.y);
 	v[2] = XMFLOAT2(-extents.x, -extents.y);
 	v[3] = XMFLOAT2(-extents.x, extents.y);
-	vector<uint32_t> i(6);
+	vector<uint16_t> i(6);
 	i[0] = 0; i[1] = 1; i[2] = 2;
 	i[3] = 2; i[4] = 3; i[5] = 0;
 	return make_unique<mesh>(
-		dv, commandList, (void*)v.data(), v.size()*sizeof(XMFLOAT2), sizeof(XMFLOAT2), (void*)i.data(), i.size()*sizeof(uint32_t), i.size());
+		dv, commandList, (void*)v.data(), v.size()*sizeof(XMFLOAT2), sizeof(XMFLOAT2), (void*)i.data(), i.size()*sizeof(uint16_t), i.size(),
+		DXGI_FORMAT_R16_UINT);
 }
 
 
 mesh_data generate_plane_mesh(XMFLOAT2 dims, XMFLOAT2 div, XMFLOAT3 norm)
 {
-	vector<vertex> vertices; vector<uint32_t> indices;
 	XMVECTOR nw = XMVector3Normalize(XMLoadFloat3(&norm));
 	XMVECTOR t = (fabsf(XMVectorGetX(nw)) > .1 ? XMVectorSet(0, 1, 0, 0) : XMVectorSet(1, 0, 0, 0));
 	XMVECTOR nu = XMVector3Normalize(XMVector3Cross(t, nw));
@@ -285,34 +431,47 @@ mesh_data generate_plane_mesh(XMFLOAT2 dims, XMFLOAT2 div, XMFLOAT3 norm)
 
 	XMVECTOR duv = XMVectorReciprocal(divm1);
 
-	for (float i = 0; i < div.y; ++i)
+	//div is given as floats, so the row/column counts are the number of integer steps below it
+	uint32_t rows = div.y > 0.f ? (uint32_t)ceilf(div.y) : 0;
+	uint32_t cols = div.x > 0.f ? (uint32_t)ceilf(div.x) : 0;
+	uint32_t qi = div.x > 1.f ? (uint32_t)ceilf(div.x - 1.f) : 0;
+	uint32_t qj = div.y > 1.f ? (uint32_t)ceilf(div.y - 1.f) : 0;
+
+	vector<vertex> vertices(rows*cols);
+	vector<uint32_t> indices(6*qi*qj);
+
+	parallel_for(0u, rows, [&](uint32_t r)
 	{
+		float i = (float)r;
 		float y = hdims.y - i*XMVectorGetY(dxy);
-		for (float j = 0; j < div.x; ++j)
+		vertex* row = vertices.data() + r*cols;
+		for (uint32_t c = 0; c < cols; ++c)
 		{
+			float j = (float)c;
 			float x = hdims.x - j*XMVectorGetX(dxy);
 
 			XMVECTOR p = nu*x + nv*y;
 			XMVECTOR tx = XMVectorSet(j, i, 0, 0)*duv;
-			vertices.push_back(vertex(p, -nw, tx, nu));
+			row[c] = vertex(p, -nw, tx, nu);
 		}
-	}
+	});
 
-	for (uint32_t i = 0; i < div.x - 1; ++i)
+	//indices are written back to front, which is the reversed winding the old push_back/reverse produced;
+	//rows are cols vertices apart, in full 32 bits, so grids of any size and aspect index correctly
+	parallel_for(0u, qj, [&](uint32_t r)
 	{
-		for (uint32_t j = 0; j < div.y - 1; ++j)
+		uint32_t* ix = indices.data() + indices.size() - 1 - 6*r*qi;
+		for (uint32_t c = 0; c < qi; ++c)
 		{
-			indices.push_back(i*(uint16_t)div.y + j);
-			indices.push_back(i*(uint16_t)div.y + j + 1);
-			indices.push_back((i + 1)*(uint16_t)div.y + j);
+			*ix-- = r*cols + c;
+			*ix-- = r*cols + c + 1;
+			*ix-- = (r + 1)*cols + c;
 
-			indices.push_back((i + 1)*(uint16_t)div.y + j);
-			indices.push_back(i*(uint16_t)div.y + j + 1);
-			indices.push_back((i + 1)*(uint16_t)div.y + j + 1);
+			*ix-- = (r + 1)*cols + c;
+			*ix-- = r*cols + c + 1;
+			*ix-- = (r + 1)*cols + c + 1;
 		}
-	}
-
-	reverse(indices.begin(), indices.end());
-	return{ vertices, indices };
-}
+	});
 
+	return{ move(vertices), move(indices) };
+}
\ No newline at end of file
@@ -0,0 +1,449 @@
+#include "dxut\cmmn.h"
+#include "dxut\mesh_codec.h"
+
+#ifdef _XM_SSE_INTRINSICS_
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+	const uint32_t mesh_codec_magic = 0x434d5844; //'DXMC'
+	const uint32_t mesh_codec_version = 1;
+
+	struct mesh_codec_header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertex_count;
+		uint32_t vertex_stride;
+		uint32_t index_count;
+		uint32_t index_bytes;
+		uint32_t vertex_bytes;
+		uint32_t reserved;
+	};
+
+#pragma region varints
+	inline void write_varint(vector<uint8_t>& out, uint32_t v) {
+		while (v >= 0x80) {
+			out.push_back((uint8_t)(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back((uint8_t)v);
+	}
+
+	inline bool read_varint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+		v = 0;
+		for (uint32_t shift = 0; shift < 35; shift += 7) {
+			if (p == end) return false;
+			uint8_t b = *p++;
+			v |= (uint32_t)(b & 0x7f) << shift;
+			if (b < 0x80) return true;
+		}
+		return false;
+	}
+
+	inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+	inline int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+#pragma endregion
+
+	//state shared by the index encoder and decoder; both sides must update it identically
+	struct index_coder_state {
+		uint32_t edge_a[16], edge_b[16];
+		uint32_t edge_head;
+		uint32_t vfifo[16];
+		uint32_t vertex_head;
+		uint32_t next;	//one past the highest vertex seen, the usual next new vertex
+		uint32_t last;	//last explicitly coded vertex
+
+		index_coder_state() : edge_head(0), vertex_head(0), next(0), last(0) {
+			memset(edge_a, 0xff, sizeof(edge_a));
+			memset(edge_b, 0xff, sizeof(edge_b));
+			memset(vfifo, 0xff, sizeof(vfifo));
+		}
+
+		void push_edge(uint32_t a, uint32_t b) {
+			edge_a[edge_head & 15] = a;
+			edge_b[edge_head & 15] = b;
+			edge_head++;
+		}
+
+		void push_vertex(uint32_t v) {
+			vfifo[vertex_head & 15] = v;
+			vertex_head++;
+			if (v >= next) next = v + 1;
+		}
+	};
+
+	//mode 0: the next new vertex, 1-14: vertex FIFO entry, 15: explicit zigzag delta follows
+	uint8_t encode_vertex_mode(index_coder_state& s, uint32_t v, vector<uint8_t>& explicit_values) {
+		uint8_t mode = 15;
+		if (v == s.next) mode = 0;
+		else {
+			for (uint32_t i = 0; i < 14; ++i) {
+				if (s.vfifo[(s.vertex_head - 1 - i) & 15] == v) {
+					mode = (uint8_t)(i + 1);
+					break;
+				}
+			}
+		}
+		if (mode == 15) {
+			write_varint(explicit_values, zigzag((int32_t)(v - s.last)));
+			s.last = v;
+		}
+		s.push_vertex(v);
+		return mode;
+	}
+
+	//vertices that are new to the stream are checked against vertex_count; FIFO entries and edges only
+	//ever hold vertices that already passed, and the FIFO starts out filled with an invalid one
+	bool decode_vertex_mode(index_coder_state& s, uint8_t mode, const uint8_t*& p, const uint8_t* end, size_t vertex_count,
+		uint32_t& v)
+	{
+		if (mode == 0) v = s.next;
+		else if (mode < 15) v = s.vfifo[(s.vertex_head - mode) & 15];
+		else {
+			uint32_t z;
+			if (!read_varint(p, end, z)) return false;
+			v = s.last + (uint32_t)unzigzag(z);
+			s.last = v;
+		}
+		if (v >= vertex_count) return false;
+		s.push_vertex(v);
+		return true;
+	}
+
+#pragma region vertex groups
+	const size_t vertex_block_size = 256;
+
+	inline uint8_t zigzag8(uint8_t d) { return (uint8_t)((d << 1) ^ (uint8_t)((int8_t)d >> 7)); }
+	inline uint8_t unzigzag8(uint8_t z) { return (uint8_t)((z >> 1) ^ (uint8_t)-(int8_t)(z & 1)); }
+
+	//payload sizes for the four group modes: all zero, 2 bit, 4 bit, raw bytes
+	const size_t group_payload[4] = { 0, 4, 8, 16 };
+
+	void encode_group(const uint8_t* z, vector<uint8_t>& out, uint8_t& mode) {
+		uint8_t m = 0;
+		for (int i = 0; i < 16; ++i) m = max(m, z[i]);
+		mode = m == 0 ? 0 : (m < 4 ? 1 : (m < 16 ? 2 : 3));
+		switch (mode) {
+		case 1:
+			//byte j holds values j, j+4, j+8, j+12 at bits 0, 2, 4, 6
+			for (int j = 0; j < 4; ++j)
+				out.push_back((uint8_t)(z[j] | (z[j + 4] << 2) | (z[j + 8] << 4) | (z[j + 12] << 6)));
+			break;
+		case 2:
+			//byte j holds value j in the low nibble and value j+8 in the high one
+			for (int j = 0; j < 8; ++j)
+				out.push_back((uint8_t)(z[j] | (z[j + 8] << 4)));
+			break;
+		case 3:
+			out.insert(out.end(), z, z + 16);
+			break;
+		}
+	}
+
+	//unpacks one group, undoes zigzag and integrates the deltas starting from carry
+	inline uint8_t decode_group(const uint8_t* src, uint8_t mode, uint8_t carry, uint8_t* dst) {
+#ifdef _XM_SSE_INTRINSICS_
+		__m128i z;
+		switch (mode) {
+		case 0:
+			_mm_storeu_si128((__m128i*)dst, _mm_set1_epi8((char)carry));
+			return carry;
+		case 1: {
+			int32_t packed;
+			memcpy(&packed, src, 4);
+			__m128i v = _mm_cvtsi32_si128(packed);
+			__m128i m3 = _mm_set1_epi8(3);
+			__m128i a = _mm_and_si128(v, m3);
+			__m128i b = _mm_and_si128(_mm_srli_epi16(v, 2), m3);
+			__m128i c = _mm_and_si128(_mm_srli_epi16(v, 4), m3);
+			__m128i d = _mm_and_si128(_mm_srli_epi16(v, 6), m3);
+			z = _mm_unpacklo_epi64(_mm_unpacklo_epi32(a, b), _mm_unpacklo_epi32(c, d));
+			break;
+		}
+		case 2: {
+			__m128i v = _mm_loadl_epi64((const __m128i*)src);
+			__m128i mf = _mm_set1_epi8(15);
+			z = _mm_unpacklo_epi64(_mm_and_si128(v, mf), _mm_and_si128(_mm_srli_epi16(v, 4), mf));
+			break;
+		}
+		default:
+			z = _mm_loadu_si128((const __m128i*)src);
+			break;
+		}
+		__m128i one = _mm_set1_epi8(1);
+		__m128i d = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(z, 1), _mm_set1_epi8(0x7f)),
+			_mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(z, one)));
+		//inclusive byte prefix sum in four shifted adds
+		d = _mm_add_epi8(d, _mm_slli_si128(d, 1));
+		d = _mm_add_epi8(d, _mm_slli_si128(d, 2));
+		d = _mm_add_epi8(d, _mm_slli_si128(d, 4));
+		d = _mm_add_epi8(d, _mm_slli_si128(d, 8));
+		d = _mm_add_epi8(d, _mm_set1_epi8((char)carry));
+		_mm_storeu_si128((__m128i*)dst, d);
+		return (uint8_t)(_mm_extract_epi16(d, 7) >> 8);
+#else
+		uint8_t z[16];
+		switch (mode) {
+		case 0: memset(z, 0, 16); break;
+		case 1:
+			for (int j = 0; j < 4; ++j) {
+				z[j] = src[j] & 3; z[j + 4] = (src[j] >> 2) & 3;
+				z[j + 8] = (src[j] >> 4) & 3; z[j + 12] = (src[j] >> 6) & 3;
+			}
+			break;
+		case 2:
+			for (int j = 0; j < 8; ++j) {
+				z[j] = src[j] & 15; z[j + 8] = src[j] >> 4;
+			}
+			break;
+		default: memcpy(z, src, 16); break;
+		}
+		for (int i = 0; i < 16; ++i) {
+			carry = (uint8_t)(carry + unzigzag8(z[i]));
+			dst[i] = carry;
+		}
+		return carry;
+#endif
+	}
+
+#ifdef _XM_SSE_INTRINSICS_
+	//one round of interleaving row j with row j + 8; four rounds transpose a 16 x 16 byte matrix. Spelled
+	//out so the rows stay in registers
+	inline void interleave_rows(__m128i (&x)[16]) {
+		__m128i y0 = _mm_unpacklo_epi8(x[0], x[8]), y1 = _mm_unpackhi_epi8(x[0], x[8]);
+		__m128i y2 = _mm_unpacklo_epi8(x[1], x[9]), y3 = _mm_unpackhi_epi8(x[1], x[9]);
+		__m128i y4 = _mm_unpacklo_epi8(x[2], x[10]), y5 = _mm_unpackhi_epi8(x[2], x[10]);
+		__m128i y6 = _mm_unpacklo_epi8(x[3], x[11]), y7 = _mm_unpackhi_epi8(x[3], x[11]);
+		__m128i y8 = _mm_unpacklo_epi8(x[4], x[12]), y9 = _mm_unpackhi_epi8(x[4], x[12]);
+		__m128i y10 = _mm_unpacklo_epi8(x[5], x[13]), y11 = _mm_unpackhi_epi8(x[5], x[13]);
+		__m128i y12 = _mm_unpacklo_epi8(x[6], x[14]), y13 = _mm_unpackhi_epi8(x[6], x[14]);
+		__m128i y14 = _mm_unpacklo_epi8(x[7], x[15]), y15 = _mm_unpackhi_epi8(x[7], x[15]);
+		x[0] = y0; x[1] = y1; x[2] = y2; x[3] = y3; x[4] = y4; x[5] = y5; x[6] = y6; x[7] = y7;
+		x[8] = y8; x[9] = y9; x[10] = y10; x[11] = y11; x[12] = y12; x[13] = y13; x[14] = y14; x[15] = y15;
+	}
+#endif
+
+	//writes the planes of one block back into n vertices; 16 vertices by 16 bytes at a time where SSE is
+	//available and the stride allows it
+	void transpose_block(const uint8_t* planes, size_t n, size_t stride, uint8_t* dst) {
+		size_t i = 0;
+#ifdef _XM_SSE_INTRINSICS_
+		if (stride >= 16) {
+			for (; i + 16 <= n; i += 16) {
+				for (size_t k = 0; k < stride; k += 16) {
+					//the last chunk of a stride that is not a multiple of 16 overlaps the one before it, rather
+					//than running into the next vertex
+					size_t k0 = min(k, stride - 16);
+					const uint8_t* src = planes + k0 * vertex_block_size + i;
+					__m128i x[16];
+					for (int r = 0; r < 16; ++r) x[r] = _mm_loadu_si128((const __m128i*)(src + r * vertex_block_size));
+					interleave_rows(x);
+					interleave_rows(x);
+					interleave_rows(x);
+					interleave_rows(x);
+					uint8_t* out = dst + i * stride + k0;
+					for (int c = 0; c < 16; ++c) _mm_storeu_si128((__m128i*)(out + c * stride), x[c]);
+				}
+			}
+		}
+#endif
+		for (; i < n; ++i) {
+			uint8_t* v = dst + i * stride;
+			for (size_t k = 0; k < stride; ++k) v[k] = planes[k * vertex_block_size + i];
+		}
+	}
+#pragma endregion
+
+	//smallest streams that can hold the counts a header claims: every triangle takes at least its code
+	//byte, and every byte plane of a block at least its group modes
+	uint64_t min_index_bytes(uint64_t index_count) {
+		return index_count / 3;
+	}
+
+	uint64_t min_vertex_bytes(uint64_t vertex_count, uint64_t vertex_stride) {
+		uint64_t full = vertex_count / vertex_block_size, rest = vertex_count % vertex_block_size;
+		uint64_t modes = full * (vertex_block_size / 16 + 3) / 4 + (rest ? ((rest + 15) / 16 + 3) / 4 : 0);
+		return modes * vertex_stride;
+	}
+}
+
+void encode_index_buffer(const uint32_t* indices, size_t index_count, vector<uint8_t>& out) {
+	assert(index_count % 3 == 0);
+	index_coder_state s;
+	vector<uint8_t> explicit_values;
+	out.reserve(out.size() + index_count / 2);
+
+	for (size_t i = 0; i < index_count; i += 3) {
+		uint32_t t[3] = { indices[i], indices[i + 1], indices[i + 2] };
+
+		//find a recent edge this triangle shares, walked in the opposite direction
+		uint32_t edge = 0, rot = 0;
+		for (uint32_t e = 0; e < 15 && edge == 0; ++e) {
+			uint32_t slot = (s.edge_head - 1 - e) & 15;
+			for (uint32_t r = 0; r < 3; ++r) {
+				if (s.edge_a[slot] == t[(r + 1) % 3] && s.edge_b[slot] == t[r]) {
+					edge = e + 1;
+					rot = r;
+					break;
+				}
+			}
+		}
+		uint32_t a = t[rot], b = t[(rot + 1) % 3], c = t[(rot + 2) % 3];
+
+		explicit_values.clear();
+		if (edge == 0) {
+			uint8_t ma = encode_vertex_mode(s, a, explicit_values);
+			uint8_t mb = encode_vertex_mode(s, b, explicit_values);
+			uint8_t mc = encode_vertex_mode(s, c, explicit_values);
+			out.push_back(mc);
+			out.push_back((uint8_t)((ma << 4) | mb));
+			s.push_edge(a, b);
+		} else {
+			uint8_t mc = encode_vertex_mode(s, c, explicit_values);
+			out.push_back((uint8_t)((edge << 4) | mc));
+		}
+		out.insert(out.end(), explicit_values.begin(), explicit_values.end());
+		s.push_edge(b, c);
+		s.push_edge(c, a);
+	}
+}
+
+bool decode_index_buffer(const uint8_t* data, size_t size, uint32_t* indices, size_t index_count, size_t vertex_count) {
+	if (index_count % 3 != 0) return false;
+	index_coder_state s;
+	const uint8_t* p = data;
+	const uint8_t* end = data + size;
+
+	for (size_t i = 0; i < index_count; i += 3) {
+		if (p == end) return false;
+		uint8_t code = *p++;
+		uint32_t edge = code >> 4, mc = code & 15;
+		uint32_t a, b, c;
+		if (edge == 0) {
+			if (p == end) return false;
+			uint8_t modes = *p++;
+			if (!decode_vertex_mode(s, modes >> 4, p, end, vertex_count, a)) return false;
+			if (!decode_vertex_mode(s, modes & 15, p, end, vertex_count, b)) return false;
+			if (!decode_vertex_mode(s, mc, p, end, vertex_count, c)) return false;
+			s.push_edge(a, b);
+		} else {
+			uint32_t slot = (s.edge_head - edge) & 15;
+			a = s.edge_b[slot];
+			b = s.edge_a[slot];
+			//an edge slot that was never written still holds the invalid vertex it started out with
+			if (a >= vertex_count) return false;
+			if (!decode_vertex_mode(s, mc, p, end, vertex_count, c)) return false;
+		}
+		indices[i] = a; indices[i + 1] = b; indices[i + 2] = c;
+		s.push_edge(b, c);
+		s.push_edge(c, a);
+	}
+	return p == end;
+}
+
+void encode_vertex_buffer(const void* vertices, size_t vertex_count, size_t vertex_stride, vector<uint8_t>& out) {
+	const uint8_t* src = (const uint8_t*)vertices;
+	vector<uint8_t> prev(vertex_stride, 0);
+	uint8_t z[vertex_block_size];
+	vector<uint8_t> payload;
+
+	for (size_t base = 0; base < vertex_count; base += vertex_block_size) {
+		size_t n = min(vertex_block_size, vertex_count - base);
+		size_t groups = (n + 15) / 16;
+		for (size_t k = 0; k < vertex_stride; ++k) {
+			//deltas past the end of a partial block are zero, which decodes to repeats of the last value
+			memset(z, 0, sizeof(z));
+			for (size_t i = 0; i < n; ++i) {
+				uint8_t v = src[(base + i) * vertex_stride + k];
+				z[i] = zigzag8((uint8_t)(v - prev[k]));
+				prev[k] = v;
+			}
+
+			size_t header_at = out.size();
+			out.resize(out.size() + (groups + 3) / 4, 0);
+			payload.clear();
+			for (size_t g = 0; g < groups; ++g) {
+				uint8_t mode;
+				encode_group(z + g * 16, payload, mode);
+				out[header_at + g / 4] |= (uint8_t)(mode << ((g % 4) * 2));
+			}
+			out.insert(out.end(), payload.begin(), payload.end());
+		}
+	}
+}
+
+bool decode_vertex_buffer(const uint8_t* data, size_t size, void* vertices, size_t vertex_count, size_t vertex_stride) {
+	uint8_t* dst = (uint8_t*)vertices;
+	const uint8_t* p = data;
+	const uint8_t* end = data + size;
+	vector<uint8_t> prev(vertex_stride, 0);
+	//planes of one block are decoded side by side, then transposed into vertices
+	vector<uint8_t> planes(vertex_stride * vertex_block_size);
+
+	for (size_t base = 0; base < vertex_count; base += vertex_block_size) {
+		size_t n = min(vertex_block_size, vertex_count - base);
+		size_t groups = (n + 15) / 16;
+		for (size_t k = 0; k < vertex_stride; ++k) {
+			const uint8_t* header = p;
+			p += (groups + 3) / 4;
+			if (p > end) return false;
+			uint8_t carry = prev[k];
+			uint8_t* plane = &planes[k * vertex_block_size];
+			for (size_t g = 0; g < groups; ++g) {
+				uint8_t mode = (header[g / 4] >> ((g % 4) * 2)) & 3;
+				if ((size_t)(end - p) < group_payload[mode]) return false;
+				carry = decode_group(p, mode, carry, plane + g * 16);
+				p += group_payload[mode];
+			}
+			prev[k] = plane[n - 1];
+		}
+
+		transpose_block(planes.data(), n, vertex_stride, dst + base * vertex_stride);
+	}
+	return p == end;
+}
+
+vector<uint8_t> encode_mesh(const mesh_data& D) {
+	const auto& vertices = get<0>(D);
+	const auto& indices = get<1>(D);
+
+	vector<uint8_t> out(sizeof(mesh_codec_header));
+	encode_index_buffer(indices.data(), indices.size(), out);
+	size_t index_bytes = out.size() - sizeof(mesh_codec_header);
+	encode_vertex_buffer(vertices.data(), vertices.size(), sizeof(vertex), out);
+
+	mesh_codec_header h = {};
+	h.magic = mesh_codec_magic;
+	h.version = mesh_codec_version;
+	h.vertex_count = (uint32_t)vertices.size();
+	h.vertex_stride = sizeof(vertex);
+	h.index_count = (uint32_t)indices.size();
+	h.index_bytes = (uint32_t)index_bytes;
+	h.vertex_bytes = (uint32_t)(out.size() - sizeof(mesh_codec_header) - index_bytes);
+	memcpy(out.data(), &h, sizeof(h));
+	return out;
+}
+
+bool decode_mesh(const uint8_t* data, size_t size, mesh_data& D) {
+	mesh_codec_header h;
+	if (size < sizeof(h)) return false;
+	memcpy(&h, data, sizeof(h));
+	if (h.magic != mesh_codec_magic || h.version != mesh_codec_version || h.vertex_stride != sizeof(vertex))
+		return false;
+	if ((uint64_t)sizeof(h) + h.index_bytes + h.vertex_bytes != size) return false;
+	//counts are checked against the payloads before anything is allocated for them
+	if (h.index_count % 3 != 0 || min_index_bytes(h.index_count) > h.index_bytes
+		|| min_vertex_bytes(h.vertex_count, h.vertex_stride) > h.vertex_bytes)
+		return false;
+
+	auto& vertices = get<0>(D);
+	auto& indices = get<1>(D);
+	vertices.resize(h.vertex_count);
+	indices.resize(h.index_count);
+	const uint8_t* p = data + sizeof(h);
+	return decode_index_buffer(p, h.index_bytes, indices.data(), indices.size(), vertices.size())
+		&& decode_vertex_buffer(p + h.index_bytes, h.vertex_bytes, vertices.data(), vertices.size(), sizeof(vertex));
+}
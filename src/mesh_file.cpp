@@ -0,0 +1,202 @@
+#include "dxut\cmmn.h"
+#include "dxut\mesh_file.h"
+#include <fstream>
+#include <stdexcept>
+
+using namespace DirectX;
+using namespace std;
+
+bool write_mesh_file(const wstring& path, const mesh_data& D,
+	const vector<lod_range>& lods, const vector<mesh_file_submesh>& submeshes, DXGI_FORMAT index_format)
+{
+	const auto& vertices = get<0>(D);
+	const auto& indices = get<1>(D);
+
+	uint32_t max_index = 0;
+	for (auto i : indices) max_index = max(max_index, i);
+	if (index_format == DXGI_FORMAT_UNKNOWN)
+		index_format = max_index <= 0xffff ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	if (index_format == DXGI_FORMAT_R16_UINT && max_index > 0xffff) return false;
+	size_t index_stride = index_format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	vector<lod_range> all_lods = lods;
+	if (all_lods.empty()) all_lods.push_back({ 0, (uint32_t)indices.size(), 0.f });
+
+	mesh_file_header h = {};
+	h.magic = mesh_file_magic;
+	h.version = mesh_file_version;
+	h.vertex_stride = sizeof(vertex);
+	h.index_format = index_format;
+	h.vertex_count = vertices.size();
+	h.index_count = indices.size();
+	h.vertex_size = vertices.size() * sizeof(vertex);
+	h.index_size = indices.size() * index_stride;
+	h.vertex_offset = aligned_size256(sizeof(h));
+	h.index_offset = aligned_size256(h.vertex_offset + h.vertex_size);
+	h.lod_offset = aligned_size256(h.index_offset + h.index_size);
+	h.lod_count = (uint32_t)all_lods.size();
+	h.submesh_offset = aligned_size256(h.lod_offset + h.lod_count * sizeof(lod_range));
+	h.submesh_count = (uint32_t)submeshes.size();
+
+	XMVECTOR bmin = XMVectorZero(), bmax = XMVectorZero();
+	if (!vertices.empty()) {
+		bmin = bmax = XMLoadFloat3(&vertices[0].position);
+		for (const auto& v : vertices) {
+			XMVECTOR p = XMLoadFloat3(&v.position);
+			bmin = XMVectorMin(bmin, p);
+			bmax = XMVectorMax(bmax, p);
+		}
+	}
+	XMStoreFloat3(&h.bounds_min, bmin);
+	XMStoreFloat3(&h.bounds_max, bmax);
+
+	ofstream out(path, ios::binary | ios::trunc);
+	if (!out) return false;
+	uint64_t at = 0;
+	auto pad_to = [&](uint64_t offset) {
+		static const char zeros[256] = {};
+		while (at < offset) {
+			size_t n = (size_t)min<uint64_t>(offset - at, sizeof(zeros));
+			out.write(zeros, n);
+			at += n;
+		}
+	};
+	auto write = [&](const void* data, size_t size) {
+		out.write((const char*)data, size);
+		at += size;
+	};
+
+	write(&h, sizeof(h));
+	pad_to(h.vertex_offset);
+	write(vertices.data(), (size_t)h.vertex_size);
+	pad_to(h.index_offset);
+	if (index_stride == sizeof(uint16_t)) {
+		vector<uint16_t> small_indices(indices.begin(), indices.end());
+		write(small_indices.data(), (size_t)h.index_size);
+	} else write(indices.data(), (size_t)h.index_size);
+	pad_to(h.lod_offset);
+	write(all_lods.data(), all_lods.size() * sizeof(lod_range));
+	pad_to(h.submesh_offset);
+	write(submeshes.data(), submeshes.size() * sizeof(mesh_file_submesh));
+	return (bool)out;
+}
+
+mapped_file::mapped_file(const wstring& path)
+	: file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr), file_size(0)
+{
+	CREATEFILE2_EXTENDED_PARAMETERS extendedParams = {};
+	extendedParams.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+	extendedParams.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	extendedParams.dwFileFlags = FILE_FLAG_SEQUENTIAL_SCAN;
+	extendedParams.dwSecurityQosFlags = SECURITY_ANONYMOUS;
+
+	file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &extendedParams);
+	if (file == INVALID_HANDLE_VALUE) throw runtime_error("file could not be opened: " + ws2s(path));
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw runtime_error("file size could not be read: " + ws2s(path));
+	}
+	file_size = (size_t)size.QuadPart;
+	//empty files can not be mapped, but are still valid to open
+	if (file_size == 0) return;
+
+	mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping != nullptr) view = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		if (mapping != nullptr) CloseHandle(mapping);
+		CloseHandle(file);
+		throw runtime_error("file could not be mapped: " + ws2s(path));
+	}
+}
+
+mapped_file::~mapped_file() {
+	if (view) UnmapViewOfFile(view);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+
+mapped_mesh_file::mapped_mesh_file(const wstring& path)
+	: map(path), view(map.data())
+{
+	size_t file_size = map.size();
+	if (file_size < sizeof(mesh_file_header)) throw runtime_error("mesh file is truncated: " + ws2s(path));
+
+	//every section has to lie inside the file before any pointer into it is handed out. Counts are checked
+	//against what the file could hold before they are multiplied, so a crafted header can not wrap the
+	//products around to sizes that pass; buffers and index counts also have to fit the 32 bit views
+	const mesh_file_header& h = header();
+	auto inside = [&](uint64_t offset, uint64_t bytes) { return offset <= file_size && bytes <= file_size - offset; };
+	size_t index_stride = h.index_format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+	bool valid = h.magic == mesh_file_magic && h.version == mesh_file_version
+		&& (h.index_format == DXGI_FORMAT_R16_UINT || h.index_format == DXGI_FORMAT_R32_UINT)
+		&& h.vertex_stride != 0 && h.vertex_count <= file_size / h.vertex_stride && h.index_count <= file_size / index_stride
+		&& h.vertex_size == h.vertex_count * h.vertex_stride && h.index_size == h.index_count * index_stride
+		&& h.vertex_size <= UINT32_MAX && h.index_size <= UINT32_MAX
+		&& inside(h.vertex_offset, h.vertex_size) && inside(h.index_offset, h.index_size)
+		&& inside(h.lod_offset, (uint64_t)h.lod_count * sizeof(lod_range))
+		&& inside(h.submesh_offset, (uint64_t)h.submesh_count * sizeof(mesh_file_submesh))
+		&& XMVector3LessOrEqual(XMLoadFloat3(&h.bounds_min), XMLoadFloat3(&h.bounds_max));
+	//LOD and submesh ranges are drawn as they are, so they have to stay inside the index buffer
+	for (uint32_t l = 0; valid && l < h.lod_count; ++l)
+		valid = (uint64_t)lods()[l].start_index + lods()[l].index_count <= h.index_count;
+	for (uint32_t s = 0; valid && s < h.submesh_count; ++s)
+		valid = (uint64_t)submeshes()[s].start_index + submeshes()[s].index_count <= h.index_count;
+	if (!valid) throw runtime_error("not a valid mesh file: " + ws2s(path));
+}
+
+unique_ptr<mesh> mesh::create_from_file(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList, const mapped_mesh_file& file) {
+	const mesh_file_header& h = file.header();
+	auto m = make_unique<mesh>();
+
+	chk(dv->device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(h.vertex_size),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&m->vbufres)));
+	chk(dv->device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(h.index_size),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&m->ibufres)));
+
+	//one upload resource holds both sections, filled directly from the mapped view
+	uint64_t index_at = aligned_size256(h.vertex_size);
+	auto up = dv->new_upload_resource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(index_at + h.index_size),
+		D3D12_RESOURCE_STATE_GENERIC_READ);
+	uint8_t* dst;
+	CD3DX12_RANGE no_read(0, 0);
+	chk(up->Map(0, &no_read, (void**)&dst));
+	file.copy_vertices(dst);
+	file.copy_indices(dst + index_at);
+	up->Unmap(0, nullptr);
+
+	commandList->CopyBufferRegion(m->vbufres.Get(), 0, up.Get(), 0, h.vertex_size);
+	commandList->CopyBufferRegion(m->ibufres.Get(), 0, up.Get(), index_at, h.index_size);
+
+	m->vbv.BufferLocation = m->vbufres->GetGPUVirtualAddress();
+	m->vbv.StrideInBytes = h.vertex_stride;
+	m->vbv.SizeInBytes = (UINT)h.vertex_size;
+	m->ibv.BufferLocation = m->ibufres->GetGPUVirtualAddress();
+	m->ibv.Format = (DXGI_FORMAT)h.index_format;
+	m->ibv.SizeInBytes = (UINT)h.index_size;
+	m->num_indices = (uint32_t)h.index_count;
+	//bounds come from the header, so the vertex section is not read a second time and its layout does not matter
+	BoundingBox::CreateFromPoints(m->bounding_box, XMLoadFloat3(&h.bounds_min), XMLoadFloat3(&h.bounds_max));
+	m->bounding_sphere.Center = m->bounding_box.Center;
+	m->bounding_sphere.Radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&m->bounding_box.Extents)));
+
+	D3D12_RESOURCE_BARRIER barriers[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(m->vbufres.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
+		CD3DX12_RESOURCE_BARRIER::Transition(m->ibufres.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER)
+	};
+	commandList->ResourceBarrier(2, barriers);
+	return m;
+}
@@ -0,0 +1,653 @@
+#include "dxut\cmmn.h"
+#include "dxut\mesh_import.h"
+#include "dxut\mesh_file.h"
+#include "dxut\transform.h"
+#include <stdexcept>
+#include <thread>
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+#pragma region text parsing
+	inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	inline const char* skip_space(const char* p, const char* end) {
+		while (p < end && is_space(*p)) ++p;
+		return p;
+	}
+
+	inline const char* next_line(const char* p, const char* end) {
+		while (p < end && *p != '\n') ++p;
+		return p < end ? p + 1 : end;
+	}
+
+	const double pow10_table[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	//decimal float parser for the common "-12.345e-6" shapes; anything else goes through strtod
+	const char* parse_float(const char* p, const char* end, float& out) {
+		p = skip_space(p, end);
+		const char* start = p;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+		uint64_t mantissa = 0;
+		int exponent = 0, digits = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+			if (mantissa < 100000000000000000ull) mantissa = mantissa * 10 + (*p - '0');
+			else exponent++;
+		}
+		if (p < end && *p == '.') {
+			for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+				if (mantissa < 100000000000000000ull) {
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
+			}
+		}
+		if (digits == 0) {
+			//nan, inf and other oddities; copy to a terminated buffer so strtod can not run off the end
+			char buf[64];
+			size_t n = 0;
+			while (start + n < end && n < sizeof(buf) - 1 && !is_space(start[n]) && start[n] != '\n') ++n;
+			memcpy(buf, start, n);
+			buf[n] = 0;
+			char* e;
+			out = strtof(buf, &e);
+			if (e == buf) throw runtime_error("expected a number");
+			return start + (e - buf);
+		}
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			++p;
+			bool eneg = false;
+			if (p < end && (*p == '-' || *p == '+')) eneg = *p++ == '-';
+			int e = 0;
+			for (; p < end && *p >= '0' && *p <= '9'; ++p) e = min(e * 10 + (*p - '0'), 10000);
+			exponent += eneg ? -e : e;
+		}
+
+		double v = (double)mantissa;
+		if (exponent < 0) v = exponent >= -22 ? v / pow10_table[-exponent] : v * pow(10.0, exponent);
+		else if (exponent > 0) v = exponent <= 22 ? v * pow10_table[exponent] : v * pow(10.0, exponent);
+		out = (float)(negative ? -v : v);
+		return p;
+	}
+
+	inline const char* parse_int(const char* p, const char* end, int64_t& out, bool& ok) {
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+		int64_t v = 0;
+		ok = false;
+		for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+			v = v * 10 + (*p - '0');
+			ok = true;
+		}
+		out = negative ? -v : v;
+		return p;
+	}
+#pragma endregion
+
+#pragma region obj
+	const uint32_t no_index = ~0u;
+
+	struct obj_chunk {
+		const char* begin;
+		const char* end;
+		size_t positions, texcoords, normals;	//counts in this chunk, then prefix sums after counting
+		vector<uint32_t> corners;	//position, texcoord, normal triples, three corners per triangle
+	};
+
+	inline bool starts_with(const char* p, const char* end, const char* tag, size_t n) {
+		return (size_t)(end - p) > n && memcmp(p, tag, n) == 0 && is_space(p[n]);
+	}
+
+	void count_obj_chunk(obj_chunk& c) {
+		c.positions = c.texcoords = c.normals = 0;
+		for (const char* p = c.begin; p < c.end; p = next_line(p, c.end)) {
+			p = skip_space(p, c.end);
+			if (starts_with(p, c.end, "v", 1)) c.positions++;
+			else if (starts_with(p, c.end, "vt", 2)) c.texcoords++;
+			else if (starts_with(p, c.end, "vn", 2)) c.normals++;
+		}
+	}
+
+	//obj indices are one based, or negative and relative to the number of elements defined so far
+	inline uint32_t resolve_obj_index(int64_t i, size_t defined, size_t total) {
+		int64_t r = i > 0 ? i - 1 : (int64_t)defined + i;
+		if (i == 0 || r < 0 || r >= (int64_t)total) throw runtime_error("OBJ face index out of range");
+		return (uint32_t)r;
+	}
+
+	void parse_obj_chunk(obj_chunk& c, XMFLOAT3* positions, XMFLOAT2* texcoords, XMFLOAT3* normals,
+		size_t total_positions, size_t total_texcoords, size_t total_normals)
+	{
+		size_t np = c.positions, nt = c.texcoords, nn = c.normals;
+		vector<uint32_t> polygon;
+		for (const char* p = c.begin; p < c.end; p = next_line(p, c.end)) {
+			p = skip_space(p, c.end);
+			if (starts_with(p, c.end, "v", 1)) {
+				XMFLOAT3& v = positions[np++];
+				p = parse_float(p + 1, c.end, v.x);
+				p = parse_float(p, c.end, v.y);
+				p = parse_float(p, c.end, v.z);
+			} else if (starts_with(p, c.end, "vt", 2)) {
+				XMFLOAT2& t = texcoords[nt++];
+				p = parse_float(p + 2, c.end, t.x);
+				p = parse_float(p, c.end, t.y);
+				t.y = 1.f - t.y;
+			} else if (starts_with(p, c.end, "vn", 2)) {
+				XMFLOAT3& n = normals[nn++];
+				p = parse_float(p + 2, c.end, n.x);
+				p = parse_float(p, c.end, n.y);
+				p = parse_float(p, c.end, n.z);
+			} else if (starts_with(p, c.end, "f", 1)) {
+				polygon.clear();
+				p = skip_space(p + 1, c.end);
+				while (p < c.end && *p != '\n' && *p != '#') {
+					int64_t i;
+					bool ok;
+					uint32_t corner[3] = { no_index, no_index, no_index };
+					p = parse_int(p, c.end, i, ok);
+					if (!ok) throw runtime_error("malformed OBJ face");
+					corner[0] = resolve_obj_index(i, np, total_positions);
+					if (p < c.end && *p == '/') {
+						p = parse_int(p + 1, c.end, i, ok);
+						if (ok) corner[1] = resolve_obj_index(i, nt, total_texcoords);
+						if (p < c.end && *p == '/') {
+							p = parse_int(p + 1, c.end, i, ok);
+							if (ok) corner[2] = resolve_obj_index(i, nn, total_normals);
+						}
+					}
+					polygon.insert(polygon.end(), corner, corner + 3);
+					p = skip_space(p, c.end);
+				}
+				//fan triangulation, which is exact for the convex polygons exporters write
+				size_t n = polygon.size() / 3;
+				for (size_t k = 1; k + 1 < n; ++k) {
+					c.corners.insert(c.corners.end(), polygon.data(), polygon.data() + 3);
+					c.corners.insert(c.corners.end(), polygon.data() + k * 3, polygon.data() + k * 3 + 6);
+				}
+			}
+		}
+	}
+
+	//open addressing table from a corner triple to its vertex, sized once up front so it never rehashes
+	struct corner_table {
+		vector<uint32_t> keys;	//three per slot
+		vector<uint32_t> values;
+		size_t mask;
+
+		corner_table(size_t max_entries) {
+			size_t capacity = 16;
+			while (capacity < max_entries * 2) capacity *= 2;
+			keys.assign(capacity * 3, no_index);
+			values.assign(capacity, no_index);
+			mask = capacity - 1;
+		}
+
+		//returns the existing vertex for the corner, or inserts next_vertex and returns it
+		uint32_t find_or_insert(const uint32_t* c, uint32_t next_vertex) {
+			size_t h = ((size_t)c[0] * 73856093u) ^ ((size_t)c[1] * 19349663u) ^ ((size_t)c[2] * 83492791u);
+			for (size_t slot = h & mask;; slot = (slot + 1) & mask) {
+				if (values[slot] == no_index) {
+					memcpy(&keys[slot * 3], c, 3 * sizeof(uint32_t));
+					values[slot] = next_vertex;
+					return next_vertex;
+				}
+				if (keys[slot * 3] == c[0] && keys[slot * 3 + 1] == c[1] && keys[slot * 3 + 2] == c[2])
+					return values[slot];
+			}
+		}
+	};
+#pragma endregion
+
+#pragma region json
+	struct json {
+		enum kind_t { null_value, boolean, number, string_value, array, object } kind;
+		double num;
+		bool b;
+		string str;
+		vector<json> items;	//array elements, or object values
+		vector<string> keys;	//object keys, parallel to items
+
+		json() : kind(null_value), num(0), b(false) {}
+
+		const json* find(const char* key) const {
+			if (kind != object) return nullptr;
+			for (size_t i = 0; i < keys.size(); ++i)
+				if (keys[i] == key) return &items[i];
+			return nullptr;
+		}
+		const json& at(const char* key) const {
+			const json* j = find(key);
+			if (!j) throw runtime_error(string("glTF is missing ") + key);
+			return *j;
+		}
+		const json& operator[](size_t i) const {
+			if (kind != array || i >= items.size()) throw runtime_error("glTF index out of range");
+			return items[i];
+		}
+		double number_or(const char* key, double def) const {
+			const json* j = find(key);
+			return j && j->kind == number ? j->num : def;
+		}
+		size_t size() const { return items.size(); }
+	};
+
+	struct json_parser {
+		const char* p;
+		const char* end;
+
+		void ws() { while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p; }
+
+		void expect(char c) {
+			ws();
+			if (p == end || *p != c) throw runtime_error("malformed glTF JSON");
+			++p;
+		}
+
+		string parse_string() {
+			expect('"');
+			string s;
+			while (p < end && *p != '"') {
+				if (*p == '\\') {
+					if (++p == end) break;
+					switch (*p) {
+					case 'n': s += '\n'; break;
+					case 't': s += '\t'; break;
+					case 'r': s += '\r'; break;
+					case 'b': s += '\b'; break;
+					case 'f': s += '\f'; break;
+					case 'u': {
+						//names and URIs are all we read, so non-ASCII escapes just become '?'
+						if (end - p < 5) throw runtime_error("malformed glTF JSON");
+						uint32_t cp = (uint32_t)strtoul(string(p + 1, p + 5).c_str(), nullptr, 16);
+						s += cp < 0x80 ? (char)cp : '?';
+						p += 4;
+						break;
+					}
+					default: s += *p; break;
+					}
+					++p;
+				} else s += *p++;
+			}
+			expect('"');
+			return s;
+		}
+
+		json parse_value(int depth = 0) {
+			if (depth > 256) throw runtime_error("glTF JSON nested too deeply");
+			ws();
+			if (p == end) throw runtime_error("malformed glTF JSON");
+			json j;
+			if (*p == '{') {
+				j.kind = json::object;
+				++p;
+				ws();
+				if (p < end && *p == '}') { ++p; return j; }
+				for (;;) {
+					j.keys.push_back(parse_string());
+					expect(':');
+					j.items.push_back(parse_value(depth + 1));
+					ws();
+					if (p < end && *p == ',') { ++p; continue; }
+					expect('}');
+					return j;
+				}
+			} else if (*p == '[') {
+				j.kind = json::array;
+				++p;
+				ws();
+				if (p < end && *p == ']') { ++p; return j; }
+				for (;;) {
+					j.items.push_back(parse_value(depth + 1));
+					ws();
+					if (p < end && *p == ',') { ++p; continue; }
+					expect(']');
+					return j;
+				}
+			} else if (*p == '"') {
+				j.kind = json::string_value;
+				j.str = parse_string();
+			} else if ((size_t)(end - p) >= 4 && memcmp(p, "true", 4) == 0) {
+				j.kind = json::boolean; j.b = true; p += 4;
+			} else if ((size_t)(end - p) >= 5 && memcmp(p, "false", 5) == 0) {
+				j.kind = json::boolean; p += 5;
+			} else if ((size_t)(end - p) >= 4 && memcmp(p, "null", 4) == 0) {
+				p += 4;
+			} else {
+				float f;
+				const char* q = parse_float(p, end, f);
+				//integers such as byte offsets must not go through float precision
+				int64_t i;
+				bool ok;
+				const char* qi = parse_int(p, end, i, ok);
+				j.kind = json::number;
+				j.num = (ok && qi == q) ? (double)i : (double)f;
+				p = q;
+			}
+			return j;
+		}
+	};
+#pragma endregion
+
+#pragma region gltf
+	struct byte_span {
+		const uint8_t* data;
+		size_t size;
+	};
+
+	vector<uint8_t> decode_base64(const char* s, size_t n) {
+		auto value = [](char c) -> int {
+			if (c >= 'A' && c <= 'Z') return c - 'A';
+			if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+			if (c >= '0' && c <= '9') return c - '0' + 52;
+			if (c == '+' || c == '-') return 62;
+			if (c == '/' || c == '_') return 63;
+			return -1;
+		};
+		vector<uint8_t> out;
+		out.reserve(n / 4 * 3);
+		uint32_t acc = 0;
+		int bits = 0;
+		for (size_t i = 0; i < n; ++i) {
+			int v = value(s[i]);
+			if (v < 0) continue;
+			acc = (acc << 6) | (uint32_t)v;
+			bits += 6;
+			if (bits >= 8) {
+				bits -= 8;
+				out.push_back((uint8_t)(acc >> bits));
+			}
+		}
+		return out;
+	}
+
+	struct gltf_accessor {
+		const uint8_t* data;
+		size_t count, stride;
+		uint32_t component_type, components;
+		bool normalized;
+
+		float component(size_t i, uint32_t c) const {
+			const uint8_t* e = data + i * stride;
+			switch (component_type) {
+			case 5126: { float f; memcpy(&f, e + c * 4, 4); return f; }
+			case 5121: { uint8_t v = e[c]; return normalized ? v / 255.f : (float)v; }
+			case 5120: { int8_t v = (int8_t)e[c]; return normalized ? max(v / 127.f, -1.f) : (float)v; }
+			case 5123: { uint16_t v; memcpy(&v, e + c * 2, 2); return normalized ? v / 65535.f : (float)v; }
+			case 5122: { int16_t v; memcpy(&v, e + c * 2, 2); return normalized ? max(v / 32767.f, -1.f) : (float)v; }
+			case 5125: { uint32_t v; memcpy(&v, e + c * 4, 4); return (float)v; }
+			}
+			return 0.f;
+		}
+
+		uint32_t index(size_t i) const {
+			const uint8_t* e = data + i * stride;
+			switch (component_type) {
+			case 5121: return e[0];
+			case 5123: { uint16_t v; memcpy(&v, e, 2); return v; }
+			case 5125: { uint32_t v; memcpy(&v, e, 4); return v; }
+			}
+			throw runtime_error("unsupported glTF index type");
+		}
+	};
+
+	struct gltf_document {
+		json root;
+		vector<byte_span> buffers;
+		vector<unique_ptr<mapped_file>> mapped;
+		vector<vector<uint8_t>> decoded;
+
+		gltf_accessor accessor(size_t i) const {
+			const json& a = root.at("accessors")[i];
+			if (a.find("sparse")) throw runtime_error("sparse glTF accessors are not supported");
+			const json& bv = root.at("bufferViews")[(size_t)a.at("bufferView").num];
+			const byte_span& buf = buffers.at((size_t)bv.at("buffer").num);
+
+			static const pair<const char*, uint32_t> types[] = {
+				{ "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 }, { "MAT4", 16 } };
+			gltf_accessor r;
+			r.components = 0;
+			for (auto& t : types) if (a.at("type").str == t.first) r.components = t.second;
+			r.component_type = (uint32_t)a.at("componentType").num;
+			size_t component_size = (r.component_type == 5126 || r.component_type == 5125) ? 4
+				: (r.component_type == 5123 || r.component_type == 5122) ? 2 : 1;
+			r.count = (size_t)a.at("count").num;
+			r.normalized = a.find("normalized") && a.at("normalized").b;
+			r.stride = (size_t)bv.number_or("byteStride", 0);
+			if (r.stride == 0) r.stride = component_size * r.components;
+
+			size_t offset = (size_t)bv.number_or("byteOffset", 0) + (size_t)a.number_or("byteOffset", 0);
+			size_t view_end = (size_t)bv.number_or("byteOffset", 0) + (size_t)bv.at("byteLength").num;
+			size_t needed = r.count ? (r.count - 1) * r.stride + component_size * r.components : 0;
+			if (r.components == 0 || view_end > buf.size || offset + needed > view_end)
+				throw runtime_error("glTF accessor out of bounds");
+			r.data = buf.data + offset;
+			return r;
+		}
+	};
+
+	XMMATRIX node_transform(const json& node) {
+		if (const json* m = node.find("matrix")) {
+			//glTF matrices are column major with column vectors, which is exactly DirectXMath's row major with row vectors
+			XMFLOAT4X4 f;
+			for (size_t i = 0; i < 16; ++i) (&f._11)[i] = (float)(*m)[i].num;
+			return XMLoadFloat4x4(&f);
+		}
+		XMVECTOR t = XMVectorZero(), r = XMQuaternionIdentity(), s = XMVectorSplatOne();
+		if (const json* j = node.find("translation")) t = XMVectorSet((float)(*j)[0].num, (float)(*j)[1].num, (float)(*j)[2].num, 0.f);
+		if (const json* j = node.find("rotation")) r = XMVectorSet((float)(*j)[0].num, (float)(*j)[1].num, (float)(*j)[2].num, (float)(*j)[3].num);
+		if (const json* j = node.find("scale")) s = XMVectorSet((float)(*j)[0].num, (float)(*j)[1].num, (float)(*j)[2].num, 0.f);
+		return XMMatrixScalingFromVector(s) * XMMatrixRotationQuaternion(r) * XMMatrixTranslationFromVector(t);
+	}
+
+	void append_primitive(const gltf_document& doc, const json& prim, FXMMATRIX world, mesh_data& D) {
+		if ((int)prim.number_or("mode", 4) != 4) return; //only triangle lists
+		const json& attributes = prim.at("attributes");
+		const json* pos = attributes.find("POSITION");
+		if (!pos) return;
+
+		gltf_accessor P = doc.accessor((size_t)pos->num);
+		bool has_normal = attributes.find("NORMAL") != nullptr;
+		bool has_uv = attributes.find("TEXCOORD_0") != nullptr;
+		bool has_tangent = attributes.find("TANGENT") != nullptr;
+		gltf_accessor N = has_normal ? doc.accessor((size_t)attributes.at("NORMAL").num) : P;
+		gltf_accessor T = has_uv ? doc.accessor((size_t)attributes.at("TEXCOORD_0").num) : P;
+		gltf_accessor G = has_tangent ? doc.accessor((size_t)attributes.at("TANGENT").num) : P;
+		if ((has_normal && N.count != P.count) || (has_uv && T.count != P.count) || (has_tangent && G.count != P.count))
+			throw runtime_error("glTF attribute counts differ");
+
+		auto& vertices = get<0>(D);
+		auto& indices = get<1>(D);
+		size_t base = vertices.size();
+		vertices.resize(base + P.count);
+
+		//decoded in object space first, then brought into world space in batches where they sit in the vertices
+		parallel_for(size_t(0), P.count, [&](size_t i) {
+			vertex& v = vertices[base + i];
+			v.position = XMFLOAT3(P.component(i, 0), P.component(i, 1), P.component(i, 2));
+			v.normal = has_normal ? XMFLOAT3(N.component(i, 0), N.component(i, 1), N.component(i, 2)) : XMFLOAT3(0.f, 0.f, 0.f);
+			v.texcoord = has_uv ? XMFLOAT2(T.component(i, 0), T.component(i, 1)) : XMFLOAT2(0.f, 0.f);
+			v.tangent = has_tangent ? XMFLOAT3(G.component(i, 0), G.component(i, 1), G.component(i, 2)) : XMFLOAT3(0.f, 0.f, 0.f);
+		});
+		if (P.count) {
+			vertex* v = &vertices[base];
+			transform_points(&v->position, sizeof(vertex), P.count, world, &v->position, sizeof(vertex));
+			if (has_normal) transform_normals(&v->normal, sizeof(vertex), P.count, XMMatrixTranspose(XMMatrixInverse(nullptr, world)),
+				&v->normal, sizeof(vertex));
+			if (has_tangent) transform_normals(&v->tangent, sizeof(vertex), P.count, world, &v->tangent, sizeof(vertex));
+		}
+
+		//a mirroring transform turns the winding around
+		bool flip = XMVectorGetX(XMMatrixDeterminant(world)) < 0.f;
+		size_t first = indices.size();
+		if (const json* ix = prim.find("indices")) {
+			gltf_accessor I = doc.accessor((size_t)ix->num);
+			indices.resize(first + I.count / 3 * 3);
+			for (size_t i = 0; i < I.count / 3 * 3; ++i) {
+				uint32_t v = I.index(i);
+				if (v >= P.count) throw runtime_error("glTF index out of range");
+				indices[first + i] = (uint32_t)base + v;
+			}
+		} else {
+			indices.resize(first + P.count / 3 * 3);
+			for (size_t i = 0; i < P.count / 3 * 3; ++i) indices[first + i] = (uint32_t)(base + i);
+		}
+		if (flip) for (size_t i = first; i < indices.size(); i += 3) swap(indices[i + 1], indices[i + 2]);
+	}
+
+	void append_node(const gltf_document& doc, size_t node_index, FXMMATRIX parent, mesh_data& D, int depth) {
+		if (depth > 64) throw runtime_error("glTF node hierarchy too deep");
+		const json& node = doc.root.at("nodes")[node_index];
+		XMMATRIX world = node_transform(node) * parent;
+		if (const json* m = node.find("mesh")) {
+			const json& prims = doc.root.at("meshes")[(size_t)m->num].at("primitives");
+			for (size_t p = 0; p < prims.size(); ++p) append_primitive(doc, prims[p], world, D);
+		}
+		if (const json* children = node.find("children"))
+			for (size_t c = 0; c < children->size(); ++c) append_node(doc, (size_t)(*children)[c].num, world, D, depth + 1);
+	}
+#pragma endregion
+}
+
+mesh_data import_obj(const char* text, size_t size, bool convert_handedness) {
+	const char* end = text + size;
+
+#pragma region chunking
+	//chunks end on line boundaries; a few per hardware thread keeps the parallel_for balanced
+	size_t chunk_count = max<size_t>(1, min<size_t>(thread::hardware_concurrency() * 4, size / (64 * 1024)));
+	vector<obj_chunk> chunks(chunk_count);
+	const char* at = text;
+	for (size_t i = 0; i < chunk_count; ++i) {
+		chunks[i].begin = at;
+		at = (i + 1 == chunk_count) ? end : next_line(min(end, text + size / chunk_count * (i + 1)), end);
+		at = max(at, chunks[i].begin);
+		chunks[i].end = at;
+	}
+#pragma endregion
+
+	//first pass counts elements, so every chunk knows where its elements land and what negative indices mean
+	parallel_for(size_t(0), chunk_count, [&](size_t i) { count_obj_chunk(chunks[i]); });
+	size_t total_positions = 0, total_texcoords = 0, total_normals = 0;
+	for (auto& c : chunks) {
+		size_t p = c.positions, t = c.texcoords, n = c.normals;
+		c.positions = total_positions; c.texcoords = total_texcoords; c.normals = total_normals;
+		total_positions += p; total_texcoords += t; total_normals += n;
+	}
+
+	vector<XMFLOAT3> positions(total_positions), normals(total_normals);
+	vector<XMFLOAT2> texcoords(total_texcoords);
+	parallel_for(size_t(0), chunk_count, [&](size_t i) {
+		parse_obj_chunk(chunks[i], positions.data(), texcoords.data(), normals.data(),
+			total_positions, total_texcoords, total_normals);
+	});
+
+#pragma region deduplication
+	size_t corner_count = 0;
+	for (auto& c : chunks) corner_count += c.corners.size() / 3;
+
+	mesh_data D;
+	auto& vertices = get<0>(D);
+	auto& indices = get<1>(D);
+	indices.resize(corner_count);
+	vector<const uint32_t*> unique_corners;
+	unique_corners.reserve(corner_count);
+
+	corner_table table(corner_count);
+	size_t k = 0;
+	for (auto& c : chunks) {
+		for (size_t i = 0; i < c.corners.size(); i += 3) {
+			uint32_t v = table.find_or_insert(&c.corners[i], (uint32_t)unique_corners.size());
+			if (v == unique_corners.size()) unique_corners.push_back(&c.corners[i]);
+			indices[k++] = v;
+		}
+	}
+
+	vertices.resize(unique_corners.size());
+	parallel_for(size_t(0), unique_corners.size(), [&](size_t i) {
+		const uint32_t* c = unique_corners[i];
+		const XMFLOAT3& p = positions[c[0]];
+		XMFLOAT2 t = c[1] != no_index ? texcoords[c[1]] : XMFLOAT2(0.f, 0.f);
+		XMFLOAT3 n = c[2] != no_index ? normals[c[2]] : XMFLOAT3(0.f, 0.f, 0.f);
+		float z = convert_handedness ? -1.f : 1.f;
+		vertices[i] = vertex(p.x, p.y, z * p.z, n.x, n.y, z * n.z, 0.f, 0.f, 0.f, t.x, t.y);
+	});
+#pragma endregion
+
+	//mirroring z turns counter-clockwise front faces into clockwise ones once the winding is reversed too
+	if (convert_handedness)
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) swap(indices[i + 1], indices[i + 2]);
+
+	return D;
+}
+
+mesh_data import_obj(const wstring& path, bool convert_handedness) {
+	mapped_file f(path);
+	return import_obj((const char*)f.data(), f.size(), convert_handedness);
+}
+
+mesh_data import_gltf(const wstring& path, bool convert_handedness) {
+	mapped_file f(path);
+	gltf_document doc;
+	wstring dir = path.substr(0, path.find_last_of(L"\\/") + 1);
+
+	//.glb: 12 byte header, then a JSON chunk and an optional binary chunk
+	byte_span json_text = { f.data(), f.size() };
+	byte_span bin = { nullptr, 0 };
+	if (f.size() >= 12 && memcmp(f.data(), "glTF", 4) == 0) {
+		size_t at = 12;
+		while (at + 8 <= f.size()) {
+			uint32_t length, type;
+			memcpy(&length, f.data() + at, 4);
+			memcpy(&type, f.data() + at + 4, 4);
+			if (length > f.size() - at - 8) throw runtime_error("truncated glb chunk");
+			if (type == 0x4e4f534a) json_text = { f.data() + at + 8, length };	//'JSON'
+			else if (type == 0x004e4942) bin = { f.data() + at + 8, length };	//'BIN\0'
+			at += 8 + ((length + 3) & ~3u);
+		}
+	}
+
+	json_parser parser = { (const char*)json_text.data, (const char*)json_text.data + json_text.size };
+	doc.root = parser.parse_value();
+
+	if (const json* buffers = doc.root.find("buffers")) {
+		for (size_t i = 0; i < buffers->size(); ++i) {
+			const json* uri = (*buffers)[i].find("uri");
+			if (!uri) {
+				doc.buffers.push_back(bin);
+				continue;
+			}
+			const string& u = uri->str;
+			if (u.compare(0, 5, "data:") == 0) {
+				size_t comma = u.find(',');
+				if (comma == string::npos || u.rfind(";base64", comma) == string::npos)
+					throw runtime_error("unsupported glTF data URI");
+				doc.decoded.push_back(decode_base64(u.data() + comma + 1, u.size() - comma - 1));
+				doc.buffers.push_back({ doc.decoded.back().data(), doc.decoded.back().size() });
+			} else {
+				doc.mapped.push_back(make_unique<mapped_file>(dir + s2ws(u)));
+				doc.buffers.push_back({ doc.mapped.back()->data(), doc.mapped.back()->size() });
+			}
+		}
+	}
+
+	//the conversion is one more mirroring transform above the scene, so positions, normals and tangents go
+	//through it with everything else and the determinant test in append_primitive reverses the winding
+	XMMATRIX root = convert_handedness ? XMMatrixScaling(1.f, 1.f, -1.f) : XMMatrixIdentity();
+	mesh_data D;
+	if (const json* scenes = doc.root.find("scenes")) {
+		const json& scene = (*scenes)[(size_t)doc.root.number_or("scene", 0)];
+		if (const json* roots = scene.find("nodes"))
+			for (size_t i = 0; i < roots->size(); ++i) append_node(doc, (size_t)(*roots)[i].num, root, D, 0);
+	} else if (const json* meshes = doc.root.find("meshes")) {
+		//a file without scenes is a library of meshes, so take them all without node transforms
+		for (size_t m = 0; m < meshes->size(); ++m) {
+			const json& prims = (*meshes)[m].at("primitives");
+			for (size_t p = 0; p < prims.size(); ++p) append_primitive(doc, prims[p], root, D);
+		}
+	}
+	return D;
+}
@@ -0,0 +1,401 @@
+#include "dxut\cmmn.h"
+#include "dxut\mesh_optimize.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace DirectX;
+using namespace std;
+
+vertex_cache_stats analyze_vertex_cache(const vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size) {
+	//a vertex is still in a FIFO cache if fewer than cache_size misses happened since it was inserted
+	vector<uint32_t> inserted(vertex_count, 0);
+	uint32_t misses = 0;
+	for (auto v : indices) {
+		if (inserted[v] == 0 || misses - inserted[v] >= cache_size) {
+			misses++;
+			inserted[v] = misses;
+		}
+	}
+	size_t tri_count = indices.size() / 3;
+	vertex_cache_stats s;
+	s.acmr = tri_count ? (float)misses / (float)tri_count : 0.f;
+	s.atvr = vertex_count ? (float)misses / (float)vertex_count : 0.f;
+	return s;
+}
+
+vertex_cache_report optimize_vertex_cache(vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size) {
+	vertex_cache_report report;
+	report.before = analyze_vertex_cache(indices, vertex_count, cache_size);
+
+	size_t tri_count = indices.size() / 3;
+	if (tri_count == 0 || vertex_count == 0) {
+		report.after = report.before;
+		return report;
+	}
+
+#pragma region adjacency
+	//live triangle count per vertex, and the triangles around each vertex in one flat array
+	vector<uint32_t> live(vertex_count, 0);
+	for (size_t i = 0; i < tri_count * 3; ++i) live[indices[i]]++;
+
+	vector<uint32_t> adj_offset(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; ++v) adj_offset[v + 1] = adj_offset[v] + live[v];
+
+	vector<uint32_t> adj(adj_offset[vertex_count]);
+	{
+		vector<uint32_t> fill(adj_offset.begin(), adj_offset.end() - 1);
+		for (size_t i = 0; i < tri_count * 3; ++i) adj[fill[indices[i]]++] = (uint32_t)(i / 3);
+	}
+#pragma endregion
+
+	vector<uint32_t> result;
+	result.reserve(tri_count * 3);
+	vector<bool> emitted(tri_count, false);
+	vector<uint32_t> cache_time(vertex_count, 0);
+	vector<uint32_t> dead_end;
+	dead_end.reserve(tri_count * 3);
+	vector<uint32_t> candidates;
+	candidates.reserve(64);
+
+	int64_t fan = 0;
+	uint32_t stamp = cache_size + 1;
+	size_t cursor = 0;
+
+	while (fan >= 0) {
+		candidates.clear();
+		for (uint32_t a = adj_offset[fan]; a < adj_offset[fan + 1]; ++a) {
+			uint32_t t = adj[a];
+			if (emitted[t]) continue;
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t v = indices[t * 3 + k];
+				result.push_back(v);
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (stamp - cache_time[v] > cache_size) cache_time[v] = stamp++;
+			}
+			emitted[t] = true;
+		}
+
+		//pick the candidate that has been in the cache longest but will still be there after its fan is emitted
+		fan = -1;
+		int64_t best = -1;
+		for (auto v : candidates) {
+			if (live[v] == 0) continue;
+			int64_t priority = 0;
+			if (stamp - cache_time[v] + 2 * live[v] <= cache_size) priority = stamp - cache_time[v];
+			if (priority > best) {
+				best = priority;
+				fan = v;
+			}
+		}
+
+		if (fan == -1) {
+			while (!dead_end.empty()) {
+				uint32_t d = dead_end.back();
+				dead_end.pop_back();
+				if (live[d] > 0) {
+					fan = d;
+					break;
+				}
+			}
+		}
+		if (fan == -1) {
+			for (; cursor < vertex_count; ++cursor) {
+				if (live[cursor] > 0) {
+					fan = cursor;
+					break;
+				}
+			}
+		}
+	}
+
+	//any trailing indices that do not form a whole triangle are kept as-is
+	result.insert(result.end(), indices.begin() + tri_count * 3, indices.end());
+	indices = move(result);
+
+	report.after = analyze_vertex_cache(indices, vertex_count, cache_size);
+	return report;
+}
+
+vertex_cache_report optimize_vertex_cache(mesh_data& D, uint32_t cache_size) {
+	return optimize_vertex_cache(get<1>(D), get<0>(D).size(), cache_size);
+}
+
+vertex_cache_report optimize_overdraw(mesh_data& D, float threshold, uint32_t cache_size) {
+	const auto& vertices = get<0>(D);
+	auto& indices = get<1>(D);
+	size_t vertex_count = vertices.size();
+	size_t tri_count = indices.size() / 3;
+
+	vertex_cache_report report;
+	report.before = analyze_vertex_cache(indices, vertex_count, cache_size);
+	if (tri_count < 2) {
+		report.after = report.before;
+		return report;
+	}
+
+#pragma region clustering
+	//same FIFO model as analyze_vertex_cache; flushing just advances time far enough to evict everything
+	vector<uint32_t> inserted(vertex_count, 0);
+	uint32_t time = 0;
+	auto access = [&](uint32_t v) -> uint32_t {
+		if (inserted[v] == 0 || time - inserted[v] >= cache_size) {
+			inserted[v] = ++time;
+			return 1;
+		}
+		return 0;
+	};
+
+	//hard boundaries: all three vertices miss, so the cache is effectively cold and cutting there is free
+	vector<bool> hard(tri_count, false);
+	for (size_t t = 0; t < tri_count; ++t) {
+		uint32_t m = access(indices[t*3]) + access(indices[t*3+1]) + access(indices[t*3+2]);
+		hard[t] = (m == 3);
+	}
+	hard[0] = true;
+
+	//soft boundaries: a cluster simulated from a cold cache is cut as soon as its own ACMR has come down
+	//to the target, so every cluster pays for its cold start and the total stays close to threshold
+	auto make_clusters = [&](float target_acmr) {
+		vector<uint32_t> cluster_start;
+		uint32_t cluster_misses = 0, cluster_tris = 0;
+		bool cut = true;
+		for (size_t t = 0; t < tri_count; ++t) {
+			if (cut || hard[t]) {
+				cluster_start.push_back((uint32_t)t);
+				time += cache_size;
+				cluster_misses = cluster_tris = 0;
+				cut = false;
+			}
+			cluster_misses += access(indices[t*3]) + access(indices[t*3+1]) + access(indices[t*3+2]);
+			cluster_tris++;
+			cut = (float)cluster_misses <= target_acmr * (float)cluster_tris;
+		}
+		cluster_start.push_back((uint32_t)tri_count);
+		return cluster_start;
+	};
+#pragma endregion
+
+#pragma region sorting
+	auto corner = [&](size_t t, uint32_t k) -> const XMFLOAT3& { return vertices[indices[t*3+k]].position; };
+
+	auto sort_clusters = [&](const vector<uint32_t>& cluster_start) {
+		size_t cluster_count = cluster_start.size() - 1;
+
+		//area weighted centroid and normal of every cluster, and the centroid of the whole mesh
+		float mesh_area = 0.f, mcx = 0.f, mcy = 0.f, mcz = 0.f;
+		vector<float> cluster_data(cluster_count * 7, 0.f); //centroid * area, normal * area, area
+		for (size_t c = 0; c < cluster_count; ++c) {
+			float* cd = &cluster_data[c * 7];
+			for (uint32_t t = cluster_start[c]; t < cluster_start[c+1]; ++t) {
+				const XMFLOAT3& a = corner(t, 0);
+				const XMFLOAT3& b = corner(t, 1);
+				const XMFLOAT3& d = corner(t, 2);
+				float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+				float e2x = d.x - a.x, e2y = d.y - a.y, e2z = d.z - a.z;
+				//the cross product has length 2*area, so summing it weights the normal by area
+				float nx = e1y*e2z - e1z*e2y, ny = e1z*e2x - e1x*e2z, nz = e1x*e2y - e1y*e2x;
+				float area = sqrtf(nx*nx + ny*ny + nz*nz);
+				cd[0] += area * (a.x + b.x + d.x) / 3.f;
+				cd[1] += area * (a.y + b.y + d.y) / 3.f;
+				cd[2] += area * (a.z + b.z + d.z) / 3.f;
+				cd[3] += nx; cd[4] += ny; cd[5] += nz;
+				cd[6] += area;
+			}
+			mcx += cd[0]; mcy += cd[1]; mcz += cd[2];
+			mesh_area += cd[6];
+		}
+		if (mesh_area > 0.f) {
+			mcx /= mesh_area; mcy /= mesh_area; mcz /= mesh_area;
+		}
+
+		//clusters far out along their own normal are likely to occlude the rest and go first
+		vector<float> sort_key(cluster_count, 0.f);
+		for (size_t c = 0; c < cluster_count; ++c) {
+			const float* cd = &cluster_data[c * 7];
+			if (cd[6] <= 0.f) continue;
+			float cx = cd[0] / cd[6] - mcx, cy = cd[1] / cd[6] - mcy, cz = cd[2] / cd[6] - mcz;
+			float nl = sqrtf(cd[3]*cd[3] + cd[4]*cd[4] + cd[5]*cd[5]);
+			if (nl > 0.f) sort_key[c] = (cx*cd[3] + cy*cd[4] + cz*cd[5]) / nl;
+		}
+
+		vector<uint32_t> order(cluster_count);
+		iota(order.begin(), order.end(), 0);
+		stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sort_key[a] > sort_key[b]; });
+
+		vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (auto c : order)
+			result.insert(result.end(), indices.begin() + cluster_start[c] * 3, indices.begin() + cluster_start[c+1] * 3);
+		result.insert(result.end(), indices.begin() + tri_count * 3, indices.end());
+		return result;
+	};
+#pragma endregion
+
+	//clusters that end early at a hard boundary can push the total slightly over the target,
+	//so tighten the cut criterion until the bound holds, and keep the input order if it never does
+	float max_acmr = threshold * report.before.acmr;
+	float lambda = threshold;
+	report.after = report.before;
+	for (int attempt = 0; attempt < 8 && lambda > 1.f; ++attempt) {
+		vector<uint32_t> result = sort_clusters(make_clusters(lambda * report.before.acmr));
+		vertex_cache_stats after = analyze_vertex_cache(result, vertex_count, cache_size);
+		if (after.acmr <= max_acmr) {
+			indices = move(result);
+			report.after = after;
+			break;
+		}
+		lambda = 1.f + (lambda - 1.f) * 0.5f;
+	}
+	return report;
+}
+
+size_t optimize_vertex_fetch(mesh_data& D) {
+	auto& vertices = get<0>(D);
+	auto& indices = get<1>(D);
+
+	const uint32_t unused = ~0u;
+	vector<uint32_t> remap(vertices.size(), unused);
+	vector<vertex> result;
+	result.reserve(vertices.size());
+
+	for (auto& i : indices) {
+		uint32_t& r = remap[i];
+		if (r == unused) {
+			r = (uint32_t)result.size();
+			result.push_back(vertices[i]);
+		}
+		i = r;
+	}
+
+	size_t removed = vertices.size() - result.size();
+	result.shrink_to_fit();
+	vertices = move(result);
+	return removed;
+}
+
+namespace {
+	const uint32_t weld_key_size = sizeof(vertex) / sizeof(float);
+	//two words per attribute: the low and high half of its 64 bit cell
+	const uint32_t weld_key_words = 2 * weld_key_size;
+	const double weld_max_cell = 4611686018427387904.;	//2^62
+
+	inline void weld_quantize(float x, float epsilon, uint32_t* key) {
+		//every NaN is the same cell, so vertices broken the same way still weld
+		if (x != x) {
+			key[0] = 0x7fc00000u;
+			key[1] = 0x80000000u;
+			return;
+		}
+		//cells are centered on multiples of epsilon, so values that sit on a round grid do not straddle a boundary
+		double cell = epsilon > 0.f ? floor((double)x / epsilon + .5) : HUGE_VAL;
+		if (fabs(cell) <= weld_max_cell) {
+			int64_t c = (int64_t)cell;
+			key[0] = (uint32_t)c;
+			key[1] = (uint32_t)((uint64_t)c >> 32);
+			return;
+		}
+		//exact values, and values too far out for a cell (infinities among them), weld only when equal; the
+		//high word is one no cell within 2^62 has, and -0 == 0
+		uint32_t bits;
+		memcpy(&bits, &x, sizeof(bits));
+		key[0] = x == 0.f ? 0u : bits;
+		key[1] = 0x80000000u;
+	}
+
+	inline uint32_t weld_hash(const uint32_t* key) {
+		//FNV-1a over the quantized words, then a final mix so the top bits pick the partition well
+		uint32_t h = 2166136261u;
+		for (uint32_t k = 0; k < weld_key_words; ++k) h = (h ^ key[k]) * 16777619u;
+		h ^= h >> 15;
+		h *= 0x2c1b3c6du;
+		h ^= h >> 12;
+		return h;
+	}
+}
+
+size_t weld_vertices(mesh_data& D, const weld_epsilon& epsilon) {
+	auto& vertices = get<0>(D);
+	auto& indices = get<1>(D);
+	size_t vertex_count = vertices.size();
+	if (vertex_count == 0) return 0;
+
+#pragma region keys
+	static_assert(sizeof(vertex) == weld_key_size * sizeof(float), "vertex is expected to be all floats");
+	float eps[weld_key_size];
+	for (uint32_t k = 0; k < 3; ++k) eps[k] = epsilon.position;
+	for (uint32_t k = 3; k < 6; ++k) eps[k] = epsilon.normal;
+	for (uint32_t k = 6; k < 8; ++k) eps[k] = epsilon.texcoord;
+	for (uint32_t k = 8; k < 11; ++k) eps[k] = epsilon.tangent;
+
+	vector<uint32_t> keys(vertex_count * weld_key_words);
+	vector<uint32_t> hashes(vertex_count);
+	parallel_for(size_t(0), vertex_count, [&](size_t v) {
+		const float* f = &vertices[v].position.x;
+		uint32_t* key = &keys[v * weld_key_words];
+		for (uint32_t k = 0; k < weld_key_size; ++k) weld_quantize(f[k], eps[k], key + 2 * k);
+		hashes[v] = weld_hash(key);
+	});
+#pragma endregion
+
+#pragma region partitions
+	//equal keys have equal hashes, so partitioning by the top hash bits lets every partition weld on
+	//its own; a counting sort keeps vertex order inside each partition
+	const uint32_t partition_bits = 6;
+	const uint32_t partition_count = 1u << partition_bits;
+	vector<uint32_t> partition_offset(partition_count + 1, 0);
+	for (auto h : hashes) partition_offset[(h >> (32 - partition_bits)) + 1]++;
+	for (uint32_t p = 0; p < partition_count; ++p) partition_offset[p + 1] += partition_offset[p];
+	vector<uint32_t> order(vertex_count);
+	{
+		vector<uint32_t> fill_at(partition_offset.begin(), partition_offset.end() - 1);
+		for (uint32_t v = 0; v < vertex_count; ++v) order[fill_at[hashes[v] >> (32 - partition_bits)]++] = v;
+	}
+
+	//remap[v] is the first vertex with the same key
+	vector<uint32_t> remap(vertex_count);
+	parallel_for(uint32_t(0), partition_count, [&](uint32_t p) {
+		uint32_t begin = partition_offset[p], end = partition_offset[p + 1];
+		if (begin == end) return;
+		size_t capacity = 16;
+		while (capacity < (size_t)(end - begin) * 2) capacity *= 2;
+		size_t mask = capacity - 1;
+		const uint32_t empty = ~0u;
+		vector<uint32_t> table(capacity, empty);
+
+		for (uint32_t i = begin; i < end; ++i) {
+			uint32_t v = order[i];
+			const uint32_t* key = &keys[v * weld_key_words];
+			for (size_t slot = hashes[v] & mask;; slot = (slot + 1) & mask) {
+				uint32_t r = table[slot];
+				if (r == empty) {
+					table[slot] = v;
+					remap[v] = v;
+					break;
+				}
+				if (hashes[r] == hashes[v] && memcmp(&keys[r * weld_key_words], key, weld_key_words * sizeof(uint32_t)) == 0) {
+					remap[v] = r;
+					break;
+				}
+			}
+		}
+	});
+#pragma endregion
+
+	//survivors keep their relative order
+	vector<uint32_t> new_index(vertex_count);
+	uint32_t kept = 0;
+	for (uint32_t v = 0; v < vertex_count; ++v)
+		if (remap[v] == v) {
+			new_index[v] = kept;
+			vertices[kept++] = vertices[v];
+		}
+	size_t removed = vertex_count - kept;
+	if (removed == 0) return 0;
+
+	parallel_for(size_t(0), indices.size(), [&](size_t i) { indices[i] = new_index[remap[indices[i]]]; });
+	vertices.resize(kept);
+	vertices.shrink_to_fit();
+	return removed;
+}
@@ -0,0 +1,286 @@
+#include "dxut\cmmn.h"
+#include "dxut\mesh_simplify.h"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+	//symmetric 4x4 error quadric of a set of planes, weighted by triangle area
+	struct quadric {
+		double a00, a01, a02, a03;
+		double a11, a12, a13;
+		double a22, a23;
+		double a33;
+		double w;
+
+		quadric() : a00(0), a01(0), a02(0), a03(0), a11(0), a12(0), a13(0), a22(0), a23(0), a33(0), w(0) {}
+
+		quadric(double a, double b, double c, double d, double weight)
+			: a00(a*a*weight), a01(a*b*weight), a02(a*c*weight), a03(a*d*weight),
+			a11(b*b*weight), a12(b*c*weight), a13(b*d*weight),
+			a22(c*c*weight), a23(c*d*weight), a33(d*d*weight), w(weight) {}
+
+		quadric& operator +=(const quadric& q) {
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23; a33 += q.a33;
+			w += q.w;
+			return *this;
+		}
+
+		//weighted mean squared distance of p to the planes
+		double error(const XMFLOAT3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			double e = a00*x*x + a11*y*y + a22*z*z + a33
+				+ 2.0*(a01*x*y + a02*x*z + a12*y*z + a03*x + a13*y + a23*z);
+			return w > 0.0 ? fabs(e) / w : 0.0;
+		}
+	};
+
+	struct collapse {
+		uint32_t from, to;
+		double cost;
+	};
+
+	XMVECTOR triangle_normal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c) {
+		XMVECTOR pa = XMLoadFloat3(&a);
+		return XMVector3Cross(XMLoadFloat3(&b) - pa, XMLoadFloat3(&c) - pa);
+	}
+}
+
+float simplify_mesh(const mesh_data& D, const vector<uint32_t>& indices, size_t target_index_count,
+	vector<uint32_t>& result, float max_error)
+{
+	const auto& vertices = get<0>(D);
+	size_t vertex_count = vertices.size();
+	result.assign(indices.begin(), indices.end() - indices.size() % 3);
+
+#pragma region seams and borders
+	//vertices that share a position are the sides of a UV or normal seam; they are chained into a ring per
+	//position, and everything below works on positions, named by the first vertex that has them
+	vector<uint32_t> position_rep(vertex_count), wedge_next(vertex_count);
+	{
+		struct position_hash {
+			size_t operator()(const XMFLOAT3& p) const {
+				uint32_t b[3];
+				memcpy(b, &p, sizeof(b));
+				return (b[0] * 73856093u) ^ (b[1] * 19349663u) ^ (b[2] * 83492791u);
+			}
+		};
+		struct position_eq {
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+		};
+		unordered_map<XMFLOAT3, uint32_t, position_hash, position_eq> reps;
+		reps.reserve(vertex_count);
+		for (uint32_t v = 0; v < vertex_count; ++v) {
+			auto r = reps.insert({ vertices[v].position, v });
+			uint32_t rep = r.first->second;
+			position_rep[v] = rep;
+			wedge_next[v] = v;
+			if (!r.second) {
+				wedge_next[v] = wedge_next[rep];
+				wedge_next[rep] = v;
+			}
+		}
+	}
+
+	//positions on an open border never move: an edge between two positions that only one triangle uses
+	vector<bool> locked(vertex_count, false);
+	{
+		unordered_map<uint64_t, int32_t> edges;
+		edges.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t a = position_rep[result[i + k]], b = position_rep[result[i + (k + 1) % 3]];
+				//directed count: +1 for a->b, -1 for b->a, so a closed manifold edge sums to zero
+				if (a < b) edges[((uint64_t)a << 32) | b] += 1;
+				else edges[((uint64_t)b << 32) | a] -= 1;
+			}
+		}
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t a = position_rep[result[i + k]], b = position_rep[result[i + (k + 1) % 3]];
+				uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+				if (edges[key] != 0) locked[a] = locked[b] = true;
+			}
+		}
+	}
+#pragma endregion
+
+#pragma region quadrics
+	//one quadric per position, so both sides of a seam see the whole surface around it
+	vector<quadric> Q(vertex_count);
+	for (size_t i = 0; i < result.size(); i += 3) {
+		const XMFLOAT3& a = vertices[result[i]].position;
+		XMVECTOR n = triangle_normal(a, vertices[result[i + 1]].position, vertices[result[i + 2]].position);
+		float len = XMVectorGetX(XMVector3Length(n));
+		if (len <= 0.f) continue;
+		n /= len;
+		XMFLOAT3 nf;
+		XMStoreFloat3(&nf, n);
+		double d = -(nf.x*a.x + nf.y*a.y + nf.z*a.z);
+		quadric q(nf.x, nf.y, nf.z, d, 0.5 * len);
+		for (uint32_t k = 0; k < 3; ++k) Q[position_rep[result[i + k]]] += q;
+	}
+#pragma endregion
+
+	double max_cost = (double)max_error * (double)max_error;
+	double error = 0.0;
+
+	vector<uint32_t> remap(vertex_count), target(vertex_count);
+	vector<bool> touched(vertex_count);
+	vector<uint32_t> adj_offset(vertex_count + 1), adj;
+	vector<collapse> candidates;
+
+	while (result.size() > target_index_count) {
+#pragma region adjacency
+		fill(adj_offset.begin(), adj_offset.end(), 0);
+		for (auto v : result) adj_offset[v + 1]++;
+		for (size_t v = 0; v < vertex_count; ++v) adj_offset[v + 1] += adj_offset[v];
+		adj.resize(result.size());
+		{
+			vector<uint32_t> fill_at(adj_offset.begin(), adj_offset.end() - 1);
+			for (size_t i = 0; i < result.size(); ++i) adj[fill_at[result[i]]++] = (uint32_t)(i / 3);
+		}
+#pragma endregion
+
+		//every edge between two positions is a candidate to collapse either one onto the other
+		candidates.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t a = position_rep[result[i + k]], b = position_rep[result[i + (k + 1) % 3]];
+				if (a == b) continue;
+				if (!locked[a]) candidates.push_back({ a, b, Q[a].error(vertices[b].position) });
+				if (!locked[b]) candidates.push_back({ b, a, Q[b].error(vertices[a].position) });
+			}
+		}
+		if (candidates.empty()) break;
+		sort(candidates.begin(), candidates.end(), [](const collapse& x, const collapse& y) {
+			return x.cost < y.cost || (x.cost == y.cost && (x.from < y.from || (x.from == y.from && x.to < y.to)));
+		});
+
+		for (uint32_t v = 0; v < vertex_count; ++v) remap[v] = v;
+		fill(touched.begin(), touched.end(), false);
+
+		//each collapse removes about two triangles; stop a pass once enough have been scheduled
+		size_t triangles_to_remove = (result.size() - target_index_count + 2) / 3;
+		size_t removed = 0;
+		size_t collapses = 0;
+		for (const auto& c : candidates) {
+			if (removed >= triangles_to_remove || c.cost > max_cost) break;
+			if (touched[c.from] || touched[c.to]) continue;
+
+			//every side of 'from' has to land on the side of 'to' it shares an edge with, and on its own one;
+			//that only holds along a seam (or away from one), so attributes are never dragged across it
+			bool valid = true;
+			uint32_t w = c.from;
+			do {
+				target[w] = UINT32_MAX;
+				for (uint32_t a = adj_offset[w]; a < adj_offset[w + 1] && valid; ++a) {
+					const uint32_t* tri = &result[adj[a] * 3];
+					for (uint32_t k = 0; k < 3; ++k) {
+						if (position_rep[tri[k]] != c.to) continue;
+						if (target[w] != UINT32_MAX && target[w] != tri[k]) valid = false;
+						target[w] = tri[k];
+					}
+				}
+				//a side no triangle uses anymore just stays where it is
+				if (adj_offset[w] == adj_offset[w + 1]) target[w] = w;
+				valid = valid && target[w] != UINT32_MAX;
+				for (uint32_t o = c.from; o != w && valid; o = wedge_next[o]) valid = target[o] != target[w];
+				w = wedge_next[w];
+			} while (w != c.from && valid);
+			if (!valid) continue;
+
+			//moving 'from' onto 'to' must not flip any triangle that survives the collapse
+			bool flips = false;
+			uint32_t dying = 0;
+			w = c.from;
+			do {
+				for (uint32_t a = adj_offset[w]; a < adj_offset[w + 1] && !flips; ++a) {
+					const uint32_t* tri = &result[adj[a] * 3];
+					if (position_rep[tri[0]] == c.to || position_rep[tri[1]] == c.to || position_rep[tri[2]] == c.to) {
+						dying++;
+						continue;
+					}
+					XMFLOAT3 p[3];
+					for (uint32_t k = 0; k < 3; ++k) p[k] = vertices[tri[k] == w ? target[w] : tri[k]].position;
+					XMVECTOR n0 = triangle_normal(vertices[tri[0]].position, vertices[tri[1]].position, vertices[tri[2]].position);
+					XMVECTOR n1 = triangle_normal(p[0], p[1], p[2]);
+					flips = XMVectorGetX(XMVector3Dot(n0, n1)) <= 0.f;
+				}
+				w = wedge_next[w];
+			} while (w != c.from && !flips);
+			if (flips) continue;
+
+			//the whole one-ring of 'from' changes shape, so none of it may move again in this pass
+			w = c.from;
+			do {
+				for (uint32_t a = adj_offset[w]; a < adj_offset[w + 1]; ++a) {
+					const uint32_t* tri = &result[adj[a] * 3];
+					for (uint32_t k = 0; k < 3; ++k) touched[position_rep[tri[k]]] = true;
+				}
+				remap[w] = target[w];
+				w = wedge_next[w];
+			} while (w != c.from);
+			Q[c.to] += Q[c.from];
+			error = max(error, c.cost);
+			removed += dying;
+			collapses++;
+		}
+		if (collapses == 0) break;
+
+		size_t out = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (a == b || b == c || c == a) continue;
+			result[out++] = a; result[out++] = b; result[out++] = c;
+		}
+		result.resize(out);
+	}
+
+	return (float)sqrt(error);
+}
+
+vector<mesh_lod> build_lod_chain(const mesh_data& D, const vector<float>& ratios, float max_error) {
+	const auto& indices = get<1>(D);
+	vector<mesh_lod> chain;
+	chain.reserve(ratios.size() + 1);
+	chain.push_back({ indices, 0.f });
+
+	for (float r : ratios) {
+		size_t target = (size_t)(r * (float)(indices.size() / 3)) * 3;
+		const mesh_lod& prev = chain.back();
+		if (target >= prev.indices.size()) continue;
+
+		mesh_lod lod;
+		float e = simplify_mesh(D, prev.indices, target, lod.indices, max_error);
+		//a level that could not get any simpler would only duplicate its parent; errors of successive
+		//levels are measured against their parent, so they add up
+		if (lod.indices.size() >= prev.indices.size()) break;
+		lod.error = prev.error + e;
+		chain.push_back(move(lod));
+	}
+	return chain;
+}
+
+lod_mesh::lod_mesh(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList,
+	const vector<vertex>& vertices, const vector<mesh_lod>& chain)
+{
+	vector<uint32_t> indices;
+	size_t total = 0;
+	for (const auto& l : chain) total += l.indices.size();
+	indices.reserve(total);
+
+	lods.reserve(chain.size());
+	for (const auto& l : chain) {
+		lods.push_back({ (uint32_t)indices.size(), (uint32_t)l.indices.size(), l.error });
+		indices.insert(indices.end(), l.indices.begin(), l.indices.end());
+	}
+
+	static_cast<mesh&>(*this) = mesh(dv, commandList, vertices, indices);
+	//the plain mesh draws go through num_indices, which should cover the finest level and not all of them
+	num_indices = lods.empty() ? 0 : lods[0].index_count;
+}
@@ -0,0 +1,193 @@
+#include "dxut\cmmn.h"
+#include "dxut\mesh_tangents.h"
+#include <unordered_map>
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+	//corners of each group in ascending corner order, as offsets into one flat array
+	struct corner_groups {
+		vector<uint32_t> offset;
+		vector<uint32_t> corners;
+
+		corner_groups(const vector<uint32_t>& group_of_corner, size_t group_count)
+			: offset(group_count + 1, 0), corners(group_of_corner.size())
+		{
+			for (auto g : group_of_corner) offset[g + 1]++;
+			for (size_t g = 0; g < group_count; ++g) offset[g + 1] += offset[g];
+			vector<uint32_t> fill_at(offset.begin(), offset.end() - 1);
+			for (uint32_t c = 0; c < (uint32_t)group_of_corner.size(); ++c) corners[fill_at[group_of_corner[c]]++] = c;
+		}
+
+		template <typename F>
+		XMVECTOR sum(size_t g, F corner_value) const {
+			XMVECTOR s = XMVectorZero();
+			for (uint32_t i = offset[g]; i < offset[g + 1]; ++i) s += corner_value(corners[i]);
+			return s;
+		}
+	};
+
+	//interior angle of the triangle at a, between the edges to b and c
+	inline float corner_angle(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) {
+		XMVECTOR e1 = XMVector3Normalize(b - a), e2 = XMVector3Normalize(c - a);
+		float d = XMVectorGetX(XMVector3Dot(e1, e2));
+		return acosf(d < -1.f ? -1.f : (d > 1.f ? 1.f : d));
+	}
+
+	//some unit vector perpendicular to n
+	inline XMVECTOR any_perpendicular(FXMVECTOR n) {
+		XMFLOAT3 f;
+		XMStoreFloat3(&f, n);
+		XMVECTOR axis = fabsf(f.x) < 0.9f ? XMVectorSet(1.f, 0.f, 0.f, 0.f) : XMVectorSet(0.f, 1.f, 0.f, 0.f);
+		return XMVector3Normalize(XMVector3Cross(n, axis));
+	}
+}
+
+void generate_normals(mesh_data& D, bool weld_seams) {
+	auto& vertices = get<0>(D);
+	const auto& indices = get<1>(D);
+	size_t corner_count = indices.size() / 3 * 3;
+	size_t vertex_count = vertices.size();
+
+	vector<XMFLOAT3> contribution(corner_count);
+	parallel_for(size_t(0), corner_count / 3, [&](size_t t) {
+		const uint32_t* tri = &indices[t * 3];
+		XMVECTOR p[3] = { XMLoadFloat3(&vertices[tri[0]].position), XMLoadFloat3(&vertices[tri[1]].position), XMLoadFloat3(&vertices[tri[2]].position) };
+		XMVECTOR n = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+		bool degenerate = XMVectorGetX(XMVector3LengthSq(n)) <= 0.f;
+		n = degenerate ? XMVectorZero() : XMVector3Normalize(n);
+		for (uint32_t k = 0; k < 3; ++k) {
+			float angle = degenerate ? 0.f : corner_angle(p[k], p[(k + 1) % 3], p[(k + 2) % 3]);
+			XMStoreFloat3(&contribution[t * 3 + k], n * angle);
+		}
+	});
+
+	//with weld_seams a corner counts towards the first vertex at its position
+	vector<uint32_t> group_of_vertex(vertex_count);
+	size_t group_count = vertex_count;
+	if (weld_seams) {
+		struct position_hash {
+			size_t operator()(const XMFLOAT3& p) const {
+				uint32_t b[3];
+				memcpy(b, &p, sizeof(b));
+				return (b[0] * 73856093u) ^ (b[1] * 19349663u) ^ (b[2] * 83492791u);
+			}
+		};
+		struct position_eq {
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+		};
+		unordered_map<XMFLOAT3, uint32_t, position_hash, position_eq> groups;
+		groups.reserve(vertex_count);
+		for (uint32_t v = 0; v < vertex_count; ++v)
+			group_of_vertex[v] = groups.insert({ vertices[v].position, (uint32_t)groups.size() }).first->second;
+		group_count = groups.size();
+	} else {
+		for (uint32_t v = 0; v < vertex_count; ++v) group_of_vertex[v] = v;
+	}
+
+	vector<uint32_t> group_of_corner(corner_count);
+	for (size_t c = 0; c < corner_count; ++c) group_of_corner[c] = group_of_vertex[indices[c]];
+	corner_groups G(group_of_corner, group_count);
+
+	vector<XMFLOAT3> normals(group_count);
+	parallel_for(size_t(0), group_count, [&](size_t g) {
+		XMVECTOR n = G.sum(g, [&](uint32_t c) { return XMLoadFloat3(&contribution[c]); });
+		XMStoreFloat3(&normals[g], XMVectorGetX(XMVector3LengthSq(n)) > 0.f ? XMVector3Normalize(n) : XMVectorZero());
+	});
+	parallel_for(size_t(0), vertex_count, [&](size_t v) { vertices[v].normal = normals[group_of_vertex[v]]; });
+}
+
+size_t generate_tangents(mesh_data& D, vector<XMFLOAT4>& tangents) {
+	auto& vertices = get<0>(D);
+	auto& indices = get<1>(D);
+	size_t corner_count = indices.size() / 3 * 3;
+	size_t triangle_count = corner_count / 3;
+	size_t original_count = vertices.size();
+
+#pragma region triangles
+	//dp/du from the two edges and their texcoord deltas, with the sign of the texcoord area folded in so
+	//it points along u either way; only its direction is kept. The sign itself is the orientation, 0 for
+	//triangles whose texcoords or positions are degenerate
+	vector<XMFLOAT3> direction(triangle_count);
+	vector<int8_t> orientation(triangle_count);
+	parallel_for(size_t(0), triangle_count, [&](size_t t) {
+		const uint32_t* tri = &indices[t * 3];
+		const vertex* v[3] = { &vertices[tri[0]], &vertices[tri[1]], &vertices[tri[2]] };
+		XMVECTOR e1 = XMLoadFloat3(&v[1]->position) - XMLoadFloat3(&v[0]->position);
+		XMVECTOR e2 = XMLoadFloat3(&v[2]->position) - XMLoadFloat3(&v[0]->position);
+		float du1 = v[1]->texcoord.x - v[0]->texcoord.x, dv1 = v[1]->texcoord.y - v[0]->texcoord.y;
+		float du2 = v[2]->texcoord.x - v[0]->texcoord.x, dv2 = v[2]->texcoord.y - v[0]->texcoord.y;
+		float area = du1 * dv2 - du2 * dv1;
+		XMVECTOR sdir = (e1 * dv2 - e2 * dv1) * (area < 0.f ? -1.f : 1.f);
+		bool degenerate = area == 0.f || XMVectorGetX(XMVector3LengthSq(sdir)) <= 0.f
+			|| XMVectorGetX(XMVector3LengthSq(XMVector3Cross(e1, e2))) <= 0.f;
+		XMStoreFloat3(&direction[t], degenerate ? XMVectorZero() : XMVector3Normalize(sdir));
+		orientation[t] = degenerate ? 0 : (area > 0.f ? 1 : -1);
+	});
+#pragma endregion
+
+#pragma region splits
+	//a vertex takes the orientation of the first corner that has one; corners of the other orientation
+	//move to a copy of it appended at the end, so mirrored halves of a texture never share a tangent frame.
+	//Corners of degenerate triangles stay where they are
+	const uint32_t unused = ~0u;
+	vector<int8_t> vertex_orientation(original_count, 0);
+	vector<uint32_t> mirrored(original_count, unused);
+	for (size_t c = 0; c < corner_count; ++c) {
+		int8_t o = orientation[c / 3];
+		uint32_t v = indices[c];
+		if (o == 0) continue;
+		if (vertex_orientation[v] == 0) vertex_orientation[v] = o;
+		else if (vertex_orientation[v] != o) {
+			if (mirrored[v] == unused) {
+				mirrored[v] = (uint32_t)vertices.size();
+				vertex copy = vertices[v];
+				vertices.push_back(copy);
+				vertex_orientation.push_back(o);
+			}
+			indices[c] = mirrored[v];
+		}
+	}
+	size_t vertex_count = vertices.size();
+#pragma endregion
+
+	//each corner's direction is projected into the plane of its vertex normal and weighted by the corner
+	//angle measured in that plane
+	vector<XMFLOAT3> contribution(corner_count);
+	parallel_for(size_t(0), triangle_count, [&](size_t t) {
+		const uint32_t* tri = &indices[t * 3];
+		XMVECTOR sdir = XMLoadFloat3(&direction[t]);
+		for (uint32_t k = 0; k < 3; ++k) {
+			XMVECTOR c = XMVectorZero();
+			if (orientation[t] != 0) {
+				const vertex& v = vertices[tri[k]];
+				XMVECTOR n = XMLoadFloat3(&v.normal);
+				auto in_plane = [&](FXMVECTOR e) { return e - n * XMVector3Dot(n, e); };
+				XMVECTOR projected = in_plane(sdir);
+				if (XMVectorGetX(XMVector3LengthSq(projected)) > 0.f) {
+					XMVECTOR p = XMLoadFloat3(&v.position);
+					float angle = corner_angle(XMVectorZero(), in_plane(XMLoadFloat3(&vertices[tri[(k + 1) % 3]].position) - p),
+						in_plane(XMLoadFloat3(&vertices[tri[(k + 2) % 3]].position) - p));
+					c = XMVector3Normalize(projected) * angle;
+				}
+			}
+			XMStoreFloat3(&contribution[t * 3 + k], c);
+		}
+	});
+
+	corner_groups G(vector<uint32_t>(indices.begin(), indices.begin() + corner_count), vertex_count);
+	tangents.resize(vertex_count);
+	parallel_for(size_t(0), vertex_count, [&](size_t v) {
+		XMVECTOR n = XMLoadFloat3(&vertices[v].normal);
+		XMVECTOR t = G.sum(v, [&](uint32_t c) { return XMLoadFloat3(&contribution[c]); });
+		//Gram-Schmidt, which only takes out rounding since every corner was projected against this normal
+		t -= n * XMVector3Dot(n, t);
+		t = XMVectorGetX(XMVector3LengthSq(t)) > 1e-12f ? XMVector3Normalize(t) : any_perpendicular(n);
+		XMStoreFloat3(&vertices[v].tangent, t);
+		XMFLOAT4& out = tangents[v];
+		XMStoreFloat4(&out, t);
+		out.w = vertex_orientation[v] < 0 ? -1.f : 1.f;
+	});
+	return vertex_count - original_count;
+}
@@ -0,0 +1,141 @@
+#include "dxut\cmmn.h"
+#include "dxut\meshlet.h"
+
+using namespace DirectX;
+using namespace std;
+
+meshlet_data build_meshlets(const mesh_data& D, uint32_t max_vertices, uint32_t max_triangles) {
+	assert(max_vertices >= 3 && max_vertices <= 256);
+	assert(max_triangles >= 1);
+
+	const auto& vertices = get<0>(D);
+	const auto& indices = get<1>(D);
+	size_t tri_count = indices.size() / 3;
+
+	meshlet_data M;
+	//worst case every meshlet is full, which is the usual case after cache optimization
+	M.meshlets.reserve(tri_count / max_triangles + 1);
+	M.vertex_indices.reserve(tri_count + max_vertices);
+	M.primitive_indices.reserve(tri_count);
+
+	//local index of every vertex in the meshlet being built, valid only while its stamp matches
+	vector<uint8_t> local(vertices.size(), 0);
+	vector<uint32_t> stamp(vertices.size(), 0);
+	uint32_t current = 1;
+
+	meshlet m = {};
+	auto finish = [&]() {
+		if (m.triangle_count == 0) return;
+		M.meshlets.push_back(m);
+		m.vertex_offset = (uint32_t)M.vertex_indices.size();
+		m.triangle_offset = (uint32_t)M.primitive_indices.size();
+		m.vertex_count = m.triangle_count = 0;
+		current++;
+	};
+
+	for (size_t t = 0; t < tri_count; ++t) {
+		const uint32_t* tri = &indices[t * 3];
+		uint32_t new_vertices = 0;
+		for (uint32_t k = 0; k < 3; ++k) {
+			bool seen = stamp[tri[k]] == current;
+			for (uint32_t j = 0; j < k; ++j) seen = seen || tri[j] == tri[k];
+			if (!seen) new_vertices++;
+		}
+		if (m.vertex_count + new_vertices > max_vertices || m.triangle_count + 1 > max_triangles)
+			finish();
+
+		uint32_t packed = 0;
+		for (uint32_t k = 0; k < 3; ++k) {
+			uint32_t v = tri[k];
+			if (stamp[v] != current) {
+				stamp[v] = current;
+				local[v] = (uint8_t)m.vertex_count++;
+				M.vertex_indices.push_back(v);
+			}
+			packed |= (uint32_t)local[v] << (8 * k);
+		}
+		M.primitive_indices.push_back(packed);
+		m.triangle_count++;
+	}
+	finish();
+
+	M.bounds.resize(M.meshlets.size());
+	parallel_for(size_t(0), M.meshlets.size(), [&](size_t i) {
+		M.bounds[i] = compute_meshlet_bounds(M, M.meshlets[i], vertices);
+	});
+	return M;
+}
+
+meshlet_bounds compute_meshlet_bounds(const meshlet_data& M, const meshlet& m, const vector<vertex>& vertices) {
+	meshlet_bounds b = {};
+	if (m.vertex_count == 0) return b;
+
+	auto position = [&](uint32_t i) { return XMLoadFloat3(&vertices[M.vertex_indices[m.vertex_offset + i]].position); };
+
+#pragma region bounding sphere
+	//Ritter's sphere: start from the most distant pair of axis extremes, then grow to include every point
+	auto coord = [&](uint32_t i, uint32_t a) {
+		const XMFLOAT3& p = vertices[M.vertex_indices[m.vertex_offset + i]].position;
+		return a == 0 ? p.x : a == 1 ? p.y : p.z;
+	};
+	uint32_t pmin[3] = { 0, 0, 0 }, pmax[3] = { 0, 0, 0 };
+	for (uint32_t i = 1; i < m.vertex_count; ++i) {
+		for (uint32_t a = 0; a < 3; ++a) {
+			if (coord(i, a) < coord(pmin[a], a)) pmin[a] = i;
+			if (coord(i, a) > coord(pmax[a], a)) pmax[a] = i;
+		}
+	}
+	uint32_t axis = 0;
+	float best = -1.f;
+	for (uint32_t a = 0; a < 3; ++a) {
+		float d = XMVectorGetX(XMVector3LengthSq(position(pmax[a]) - position(pmin[a])));
+		if (d > best) {
+			best = d;
+			axis = a;
+		}
+	}
+	XMVECTOR center = (position(pmin[axis]) + position(pmax[axis])) * 0.5f;
+	float radius = sqrtf(best) * 0.5f;
+	for (uint32_t i = 0; i < m.vertex_count; ++i) {
+		XMVECTOR p = position(i);
+		float d = XMVectorGetX(XMVector3Length(p - center));
+		if (d > radius) {
+			float r = (radius + d) * 0.5f;
+			center += (p - center) * ((r - radius) / d);
+			radius = r;
+		}
+	}
+	XMStoreFloat3(&b.center, center);
+	b.radius = radius;
+#pragma endregion
+
+#pragma region normal cone
+	vector<XMVECTOR> normals;
+	normals.reserve(m.triangle_count);
+	XMVECTOR axis_sum = XMVectorZero();
+	for (uint32_t t = 0; t < m.triangle_count; ++t) {
+		uint32_t packed = M.primitive_indices[m.triangle_offset + t];
+		XMVECTOR a = position(packed & 0xff), c = position((packed >> 8) & 0xff), d = position((packed >> 16) & 0xff);
+		XMVECTOR n = XMVector3Cross(c - a, d - a);
+		float len = XMVectorGetX(XMVector3Length(n));
+		if (len <= 0.f) continue; //degenerate triangles have no facing
+		n /= len;
+		normals.push_back(n);
+		axis_sum += n;
+	}
+
+	b.cone_axis = XMFLOAT3(0.f, 0.f, 0.f);
+	b.cone_cutoff = 1.f;
+	float axis_len = XMVectorGetX(XMVector3Length(axis_sum));
+	if (normals.empty() || axis_len <= 0.f) return b;
+
+	XMVECTOR cone_axis = axis_sum / axis_len;
+	float min_dp = 1.f;
+	for (auto& n : normals) min_dp = min(min_dp, XMVectorGetX(XMVector3Dot(n, cone_axis)));
+
+	XMStoreFloat3(&b.cone_axis, cone_axis);
+	//a cone wider than a hemisphere can not be entirely back facing from anywhere
+	if (min_dp > 0.f) b.cone_cutoff = sqrtf(1.f - min_dp * min_dp);
+#pragma endregion
+	return b;
+}
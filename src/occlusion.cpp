@@ -0,0 +1,222 @@
+#include "dxut\cmmn.h"
+#include "dxut\occlusion.h"
+#ifdef _XM_SSE_INTRINSICS_
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+using namespace std;
+
+occlusion_buffer::occlusion_buffer(uint32_t width, uint32_t height) {
+	tiles_x = max((width + tile_width - 1) / tile_width, 1u);
+	tiles_y = max((height + tile_height - 1) / tile_height, 1u);
+	w = tiles_x * tile_width;
+	h = tiles_y * tile_height;
+	pixels.assign((size_t)w * h, 1.f);
+	tile_max.assign((size_t)tiles_x * tiles_y, 1.f);
+	bins.resize((size_t)tiles_x * tiles_y);
+	XMStoreFloat4x4(&view_projection, XMMatrixIdentity());
+}
+
+void occlusion_buffer::clear(FXMMATRIX vp) {
+	XMStoreFloat4x4(&view_projection, vp);
+	fill(pixels.begin(), pixels.end(), 1.f);
+	fill(tile_max.begin(), tile_max.end(), 1.f);
+	triangles.clear();
+	for (auto& b : bins) b.clear();
+}
+
+void occlusion_buffer::add_occluder(const mesh_data& D, FXMMATRIX world) {
+	if (get<0>(D).empty()) return;
+	add_occluder(&get<0>(D)[0].position, sizeof(vertex), get<0>(D).size(), get<1>(D).data(), get<1>(D).size(), world);
+}
+
+void occlusion_buffer::add_occluder(const XMFLOAT3* positions, size_t vertex_stride, size_t vertex_count,
+	const uint32_t* indices, size_t index_count, FXMMATRIX world)
+{
+	if (vertex_count == 0) return;
+	XMMATRIX m = world * XMLoadFloat4x4(&view_projection);
+	clip.resize(vertex_count);
+	const size_t chunk_size = 1024;
+	parallel_for(size_t(0), (vertex_count + chunk_size - 1) / chunk_size, [&](size_t c) {
+		for (size_t i = c * chunk_size; i < min(vertex_count, (c + 1) * chunk_size); ++i) {
+			const XMFLOAT3* p = (const XMFLOAT3*)((const uint8_t*)positions + i * vertex_stride);
+			XMStoreFloat4(&clip[i], XMVector3Transform(XMLoadFloat3(p), m));
+		}
+	});
+
+	for (size_t t = 0; t + 2 < index_count; t += 3) {
+		const XMFLOAT4* v[3] = { &clip[indices[t]], &clip[indices[t + 1]], &clip[indices[t + 2]] };
+		//entirely outside one of the planes
+		uint32_t out = ~0u;
+		for (uint32_t k = 0; k < 3; ++k) {
+			const XMFLOAT4& p = *v[k];
+			out &= (p.x > p.w ? 1u : 0) | (p.x < -p.w ? 2u : 0) | (p.y > p.w ? 4u : 0) | (p.y < -p.w ? 8u : 0) |
+				(p.z > p.w ? 16u : 0) | (p.z < 0.f ? 32u : 0);
+		}
+		if (out) continue;
+		if (v[0]->z >= 0.f && v[1]->z >= 0.f && v[2]->z >= 0.f) {
+			setup(*v[0], *v[1], *v[2]);
+			continue;
+		}
+
+		//clipped to z >= 0, which leaves a triangle or a quad
+		XMFLOAT4 poly[4];
+		uint32_t n = 0;
+		for (uint32_t k = 0; k < 3; ++k) {
+			const XMFLOAT4& p = *v[k];
+			const XMFLOAT4& q = *v[(k + 1) % 3];
+			if (p.z >= 0.f) poly[n++] = p;
+			if ((p.z >= 0.f) != (q.z >= 0.f)) {
+				float s = p.z / (p.z - q.z);
+				XMStoreFloat4(&poly[n++], XMVectorLerp(XMLoadFloat4(&p), XMLoadFloat4(&q), s));
+			}
+		}
+		for (uint32_t k = 2; k < n; ++k) setup(poly[0], poly[k - 1], poly[k]);
+	}
+}
+
+void occlusion_buffer::setup(const XMFLOAT4& a, const XMFLOAT4& b, const XMFLOAT4& c) {
+	//to pixels, with y going down
+	XMFLOAT3 s[3];
+	const XMFLOAT4* v[3] = { &a, &b, &c };
+	for (uint32_t k = 0; k < 3; ++k) {
+		float iw = 1.f / v[k]->w;
+		s[k] = XMFLOAT3((v[k]->x * iw * 0.5f + 0.5f) * w, (0.5f - v[k]->y * iw * 0.5f) * h, v[k]->z * iw);
+	}
+	float area = (s[1].x - s[0].x) * (s[2].y - s[0].y) - (s[1].y - s[0].y) * (s[2].x - s[0].x);
+	if (fabsf(area) < 1e-8f) return;
+
+	raster_triangle r;
+	//pixels whose centers can be inside
+	float lo_x = min(min(s[0].x, s[1].x), s[2].x), hi_x = max(max(s[0].x, s[1].x), s[2].x);
+	float lo_y = min(min(s[0].y, s[1].y), s[2].y), hi_y = max(max(s[0].y, s[1].y), s[2].y);
+	r.x0 = max((int32_t)ceilf(lo_x - 0.5f), 0);
+	r.x1 = min((int32_t)floorf(hi_x - 0.5f), (int32_t)w - 1);
+	r.y0 = max((int32_t)ceilf(lo_y - 0.5f), 0);
+	r.y1 = min((int32_t)floorf(hi_y - 0.5f), (int32_t)h - 1);
+	if (r.x0 > r.x1 || r.y0 > r.y1) return;
+
+	//edge k goes from vertex k to the next, and is made positive inside whatever the winding
+	float sign = area > 0.f ? 1.f : -1.f;
+	for (uint32_t k = 0; k < 3; ++k) {
+		const XMFLOAT3& p = s[k];
+		const XMFLOAT3& q = s[(k + 1) % 3];
+		r.ea[k] = -(q.y - p.y) * sign;
+		r.eb[k] = (q.x - p.x) * sign;
+		r.ec[k] = ((q.y - p.y) * p.x - (q.x - p.x) * p.y) * sign;
+	}
+	float dz1 = s[1].z - s[0].z, dz2 = s[2].z - s[0].z;
+	r.za = (dz1 * (s[2].y - s[0].y) - dz2 * (s[1].y - s[0].y)) / area;
+	r.zb = (dz2 * (s[1].x - s[0].x) - dz1 * (s[2].x - s[0].x)) / area;
+	r.zc = s[0].z - r.za * s[0].x - r.zb * s[0].y;
+
+	uint32_t index = (uint32_t)triangles.size();
+	triangles.push_back(r);
+	for (int32_t ty = r.y0 / (int32_t)tile_height; ty <= r.y1 / (int32_t)tile_height; ++ty)
+		for (int32_t tx = r.x0 / (int32_t)tile_width; tx <= r.x1 / (int32_t)tile_width; ++tx)
+			bins[ty * tiles_x + tx].push_back(index);
+}
+
+void occlusion_buffer::rasterize() {
+	parallel_for(0u, tiles_x * tiles_y, [&](uint32_t t) { rasterize_tile(t); });
+}
+
+void occlusion_buffer::rasterize_tile(uint32_t tile) {
+	int32_t tx0 = (int32_t)((tile % tiles_x) * tile_width), ty0 = (int32_t)((tile / tiles_x) * tile_height);
+	int32_t tx1 = tx0 + (int32_t)tile_width - 1, ty1 = ty0 + (int32_t)tile_height - 1;
+	for (uint32_t i : bins[tile]) {
+		const raster_triangle& r = triangles[i];
+		//spans start on multiples of four; the edge functions reject the extra pixels, which are still in the tile
+		int32_t x0 = max(r.x0, tx0) & ~3, x1 = min(r.x1, tx1);
+		int32_t y0 = max(r.y0, ty0), y1 = min(r.y1, ty1);
+		for (int32_t y = y0; y <= y1; ++y) {
+			float fy = y + 0.5f;
+			float* row = pixels.data() + (size_t)y * w;
+#ifdef _XM_SSE_INTRINSICS_
+			__m128 e_row[3];
+			for (uint32_t k = 0; k < 3; ++k) e_row[k] = _mm_set1_ps(r.eb[k] * fy + r.ec[k]);
+			__m128 z_row = _mm_set1_ps(r.zb * fy + r.zc), zero = _mm_setzero_ps();
+			for (int32_t x = x0; x <= x1; x += 4) {
+				__m128 fx = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r.ea[0]), fx), e_row[0]), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r.ea[1]), fx), e_row[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r.ea[2]), fx), e_row[2]), zero));
+				__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r.za), fx), z_row);
+				__m128 d = _mm_loadu_ps(row + x);
+				__m128 nearer = _mm_min_ps(d, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, d)));
+			}
+#else
+			//the same operations in the same order as the SSE path, so both give the same pixels
+			float e_row[3];
+			for (uint32_t k = 0; k < 3; ++k) e_row[k] = r.eb[k] * fy + r.ec[k];
+			float z_row = r.zb * fy + r.zc;
+			for (int32_t x = x0; x <= x1; ++x) {
+				float fx = x + 0.5f;
+				if (r.ea[0] * fx + e_row[0] < 0.f) continue;
+				if (r.ea[1] * fx + e_row[1] < 0.f) continue;
+				if (r.ea[2] * fx + e_row[2] < 0.f) continue;
+				row[x] = min(row[x], r.za * fx + z_row);
+			}
+#endif
+		}
+	}
+
+	float m = 0.f;
+	for (int32_t y = ty0; y <= ty1; ++y) {
+		const float* row = pixels.data() + (size_t)y * w;
+		for (int32_t x = tx0; x <= tx1; ++x) m = max(m, row[x]);
+	}
+	tile_max[tile] = m;
+}
+
+bool occlusion_buffer::visible(const BoundingBox& box) const {
+	XMMATRIX m = XMLoadFloat4x4(&view_projection);
+	XMFLOAT3 corners[8];
+	box.GetCorners(corners);
+	float lo_x = FLT_MAX, hi_x = -FLT_MAX, lo_y = FLT_MAX, hi_y = -FLT_MAX, nearest = FLT_MAX;
+	for (uint32_t k = 0; k < 8; ++k) {
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, XMVector3Transform(XMLoadFloat3(&corners[k]), m));
+		if (c.z < 0.f) return true;
+		float iw = 1.f / c.w;
+		float x = (c.x * iw * 0.5f + 0.5f) * w, y = (0.5f - c.y * iw * 0.5f) * h;
+		lo_x = min(lo_x, x); hi_x = max(hi_x, x);
+		lo_y = min(lo_y, y); hi_y = max(hi_y, y);
+		nearest = min(nearest, c.z * iw);
+	}
+	//every pixel the box touches, not just the ones whose centers it covers
+	int32_t x0 = max((int32_t)floorf(lo_x), 0), x1 = min((int32_t)floorf(hi_x), (int32_t)w - 1);
+	int32_t y0 = max((int32_t)floorf(lo_y), 0), y1 = min((int32_t)floorf(hi_y), (int32_t)h - 1);
+	if (x0 > x1 || y0 > y1) return false;
+
+	for (int32_t ty = y0 / (int32_t)tile_height; ty <= y1 / (int32_t)tile_height; ++ty) {
+		for (int32_t tx = x0 / (int32_t)tile_width; tx <= x1 / (int32_t)tile_width; ++tx) {
+			if (nearest >= tile_max[ty * tiles_x + tx]) continue;
+			int32_t px0 = max(x0, tx * (int32_t)tile_width), px1 = min(x1, (tx + 1) * (int32_t)tile_width - 1);
+			int32_t py0 = max(y0, ty * (int32_t)tile_height), py1 = min(y1, (ty + 1) * (int32_t)tile_height - 1);
+			for (int32_t y = py0; y <= py1; ++y) {
+				const float* row = pixels.data() + (size_t)y * w;
+				for (int32_t x = px0; x <= px1; ++x)
+					if (nearest < row[x]) return true;
+			}
+		}
+	}
+	return false;
+}
+
+size_t occlusion_buffer::filter(const box_bounds_soa& boxes, vector<uint32_t>& indices) const {
+	vector<uint8_t> keep(indices.size());
+	parallel_for(size_t(0), indices.size(), [&](size_t k) {
+		uint32_t i = indices[k];
+		BoundingBox b(XMFLOAT3(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i]),
+			XMFLOAT3(boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]));
+		keep[k] = visible(b) ? 1 : 0;
+	});
+	size_t n = 0;
+	for (size_t k = 0; k < indices.size(); ++k)
+		if (keep[k]) indices[n++] = indices[k];
+	indices.resize(n);
+	return n;
+}
@@ -0,0 +1,84 @@
+#include "dxut\cmmn.h"
+#include "dxut\primitive_cache.h"
+
+using namespace DirectX;
+using namespace std;
+
+primitive_cache::primitive_cache(DXDevice* dv, geometry_pool* pool, uint32_t mantissa_bits)
+	: dv(dv), pool(pool), mantissa_bits(mantissa_bits), hit_count(0), miss_count(0)
+{
+	assert(mantissa_bits >= 1 && mantissa_bits <= 23);
+}
+
+shared_ptr<const mesh> primitive_cache::find_or_create(ComPtr<ID3D12GraphicsCommandList> commandList, const key& k,
+	const function<mesh_data()>& generate)
+{
+	lock_guard<mutex> l(lock);
+	auto it = meshes.find(k);
+	if (it != meshes.end()) {
+		hit_count++;
+		return it->second;
+	}
+	miss_count++;
+	mesh_data D = generate();
+	shared_ptr<const mesh> m = pool ? make_shared<mesh>(*pool, commandList, D) : make_shared<mesh>(dv, commandList, D);
+	meshes.emplace(k, m);
+	return m;
+}
+
+shared_ptr<const mesh> primitive_cache::cube(ComPtr<ID3D12GraphicsCommandList> commandList, XMFLOAT3 extents) {
+	key k = { primitive::cube, { canonical(extents.x), canonical(extents.y), canonical(extents.z) } };
+	return find_or_create(commandList, k, [&] {
+		return generate_cube_mesh(XMFLOAT3(value(k.params[0]), value(k.params[1]), value(k.params[2])));
+	});
+}
+
+shared_ptr<const mesh> primitive_cache::sphere(ComPtr<ID3D12GraphicsCommandList> commandList, float radius, uint32_t slices, uint32_t stacks) {
+	key k = { primitive::sphere, { canonical(radius), (int32_t)slices, (int32_t)stacks } };
+	return find_or_create(commandList, k, [&] {
+		return generate_sphere_mesh(value(k.params[0]), slices, stacks);
+	});
+}
+
+shared_ptr<const mesh> primitive_cache::quad(ComPtr<ID3D12GraphicsCommandList> commandList, XMFLOAT2 extents, bool xz) {
+	key k = { primitive::quad, { canonical(extents.x), canonical(extents.y), xz ? 1 : 0 } };
+	return find_or_create(commandList, k, [&] {
+		return generate_quad_mesh(XMFLOAT2(value(k.params[0]), value(k.params[1])), xz);
+	});
+}
+
+shared_ptr<const mesh> primitive_cache::plane(ComPtr<ID3D12GraphicsCommandList> commandList, XMFLOAT2 dims, XMFLOAT2 div,
+	XMFLOAT3 norm)
+{
+	//only the direction of the normal matters to the generator
+	XMStoreFloat3(&norm, XMVector3Normalize(XMLoadFloat3(&norm)));
+	key k = { primitive::plane, { canonical(dims.x), canonical(dims.y), canonical(div.x), canonical(div.y),
+		canonical(norm.x), canonical(norm.y), canonical(norm.z) } };
+	return find_or_create(commandList, k, [&] {
+		return generate_plane_mesh(XMFLOAT2(value(k.params[0]), value(k.params[1])),
+			XMFLOAT2(value(k.params[2]), value(k.params[3])),
+			XMFLOAT3(value(k.params[4]), value(k.params[5]), value(k.params[6])));
+	});
+}
+
+size_t primitive_cache::size() const {
+	lock_guard<mutex> l(lock);
+	return meshes.size();
+}
+
+size_t primitive_cache::trim() {
+	lock_guard<mutex> l(lock);
+	size_t n = 0;
+	for (auto it = meshes.begin(); it != meshes.end();) {
+		if (it->second.use_count() == 1) {
+			it = meshes.erase(it);
+			n++;
+		} else ++it;
+	}
+	return n;
+}
+
+void primitive_cache::clear() {
+	lock_guard<mutex> l(lock);
+	meshes.clear();
+}
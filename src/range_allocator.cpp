@@ -0,0 +1,98 @@
+#include "dxut\cmmn.h"
+#include "dxut\range_allocator.h"
+
+using namespace std;
+
+range_allocator::range_allocator(uint64_t capacity)
+	: total(capacity), in_use(0)
+{
+	if (capacity > 0) add_free(0, capacity);
+}
+
+void range_allocator::add_free(uint64_t offset, uint64_t size) {
+	free_by_offset[offset] = size;
+	free_by_size.insert({ size, offset });
+}
+
+void range_allocator::remove_free(map<uint64_t, uint64_t>::iterator it) {
+	auto range = free_by_size.equal_range(it->second);
+	for (auto s = range.first; s != range.second; ++s) {
+		if (s->second == it->first) {
+			free_by_size.erase(s);
+			break;
+		}
+	}
+	free_by_offset.erase(it);
+}
+
+uint64_t range_allocator::allocate(uint64_t size) {
+	if (size == 0) return invalid;
+	auto fit = free_by_size.lower_bound(size);
+	if (fit == free_by_size.end()) return invalid;
+
+	uint64_t offset = fit->second, free_size = fit->first;
+	remove_free(free_by_offset.find(offset));
+	if (free_size > size) add_free(offset + size, free_size - size);
+	live[offset] = size;
+	in_use += size;
+	return offset;
+}
+
+void range_allocator::release(uint64_t offset) {
+	auto it = live.find(offset);
+	assert(it != live.end());
+	if (it == live.end()) return;
+	uint64_t size = it->second;
+	live.erase(it);
+	in_use -= size;
+
+	//merge with the free neighbors on both sides
+	auto next = free_by_offset.lower_bound(offset);
+	if (next != free_by_offset.end() && next->first == offset + size) {
+		size += next->second;
+		remove_free(next);
+	}
+	auto prev = free_by_offset.lower_bound(offset);
+	if (prev != free_by_offset.begin()) {
+		--prev;
+		if (prev->first + prev->second == offset) {
+			offset = prev->first;
+			size += prev->second;
+			remove_free(prev);
+		}
+	}
+	add_free(offset, size);
+}
+
+void range_allocator::grow(uint64_t new_capacity) {
+	assert(new_capacity >= total);
+	if (new_capacity <= total) return;
+	uint64_t offset = total, size = new_capacity - total;
+	total = new_capacity;
+
+	auto last = free_by_offset.empty() ? free_by_offset.end() : prev(free_by_offset.end());
+	if (last != free_by_offset.end() && last->first + last->second == offset) {
+		offset = last->first;
+		size += last->second;
+		remove_free(last);
+	}
+	add_free(offset, size);
+}
+
+vector<range_allocator::relocation> range_allocator::defragment() {
+	vector<relocation> moves;
+	moves.reserve(live.size());
+	map<uint64_t, uint64_t> packed;
+	uint64_t at = 0;
+	for (const auto& r : live) {
+		moves.push_back({ r.first, at, r.second });
+		packed.emplace_hint(packed.end(), at, r.second);
+		at += r.second;
+	}
+	live = std::move(packed);
+
+	free_by_offset.clear();
+	free_by_size.clear();
+	if (at < total) add_free(at, total - at);
+	return moves;
+}
@@ -0,0 +1,119 @@
+#include "dxut\cmmn.h"
+#include "dxut\skinning.h"
+#include "dxut\cpu_features.h"
+#ifdef _XM_SSE_INTRINSICS_
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+using namespace std;
+
+vector<D3D12_INPUT_ELEMENT_DESC> skinned_vertex::input_layout() {
+	return {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "BLENDWEIGHT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+}
+
+namespace {
+	const size_t block_size = 1024;
+
+	//position, normal, texcoord and tangent, copied out in one go so the destination only sees writes
+	inline void write_vertex(uint8_t* dst, const float* f) {
+		memcpy(dst, f, sizeof(vertex));
+	}
+
+	void skin_block_xm(const skinned_vertex* vertices, size_t begin, size_t end, const XMFLOAT4X4* bones, uint8_t* out, size_t out_stride) {
+		for (size_t i = begin; i < end; ++i) {
+			const skinned_vertex& v = vertices[i];
+			const float* w = &v.weights.x;
+			XMVECTOR r[4] = { XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+			for (uint32_t k = 0; k < 4; ++k) {
+				XMVECTOR wk = XMVectorReplicate(w[k]);
+				const XMFLOAT4X4& m = bones[v.bones[k]];
+				r[0] = XMVectorMultiplyAdd(wk, XMLoadFloat4((const XMFLOAT4*)&m._11), r[0]);
+				r[1] = XMVectorMultiplyAdd(wk, XMLoadFloat4((const XMFLOAT4*)&m._21), r[1]);
+				r[2] = XMVectorMultiplyAdd(wk, XMLoadFloat4((const XMFLOAT4*)&m._31), r[2]);
+				r[3] = XMVectorMultiplyAdd(wk, XMLoadFloat4((const XMFLOAT4*)&m._41), r[3]);
+			}
+			auto linear = [&](const XMFLOAT3& a) {
+				return XMVectorMultiplyAdd(XMVectorReplicate(a.x), r[0],
+					XMVectorMultiplyAdd(XMVectorReplicate(a.y), r[1], XMVectorReplicate(a.z) * r[2]));
+			};
+			float f[11];
+			XMStoreFloat3((XMFLOAT3*)f, linear(v.position) + r[3]);
+			XMStoreFloat3((XMFLOAT3*)(f + 3), XMVector3Normalize(linear(v.normal)));
+			f[6] = v.texcoord.x;
+			f[7] = v.texcoord.y;
+			XMStoreFloat3((XMFLOAT3*)(f + 8), XMVector3Normalize(linear(v.tangent)));
+			write_vertex(out + i * out_stride, f);
+		}
+	}
+
+#ifdef _XM_SSE_INTRINSICS_
+	//rows 0 and 1 of the blended matrix share one register and rows 2 and 3 the other, so blending four
+	//bones takes eight FMAs and each transform three
+	inline __m128 low_plus_high(__m256 v) {
+		return _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	}
+
+	//zero length stays zero, as with XMVector3Normalize on the other path
+	inline __m128 normalize3(__m128 v) {
+		__m128 d = _mm_mul_ps(v, v);
+		__m128 len2 = _mm_add_ss(_mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 2, 2, 2)));
+		len2 = _mm_shuffle_ps(len2, len2, 0);
+		return _mm_and_ps(_mm_div_ps(v, _mm_sqrt_ps(len2)), _mm_cmpgt_ps(len2, _mm_setzero_ps()));
+	}
+
+	void skin_block_avx2(const skinned_vertex* vertices, size_t begin, size_t end, const XMFLOAT4X4* bones, uint8_t* out, size_t out_stride) {
+		for (size_t i = begin; i < end; ++i) {
+			const skinned_vertex& v = vertices[i];
+			__m256 r01 = _mm256_setzero_ps(), r23 = _mm256_setzero_ps();
+			for (uint32_t k = 0; k < 4; ++k) {
+				const float* m = &bones[v.bones[k]]._11;
+				__m256 wk = _mm256_set1_ps((&v.weights.x)[k]);
+				r01 = _mm256_fmadd_ps(wk, _mm256_loadu_ps(m), r01);
+				r23 = _mm256_fmadd_ps(wk, _mm256_loadu_ps(m + 8), r23);
+			}
+			//p * M = (x r0 + z r2) + (y r1 + w r3), with w 1 for positions and 0 for directions
+			auto transform = [&](const XMFLOAT3& a, float w) {
+				__m256 xy = _mm256_setr_ps(a.x, a.x, a.x, a.x, a.y, a.y, a.y, a.y);
+				__m256 zw = _mm256_setr_ps(a.z, a.z, a.z, a.z, w, w, w, w);
+				return low_plus_high(_mm256_fmadd_ps(xy, r01, _mm256_mul_ps(zw, r23)));
+			};
+			alignas(16) float f[16];
+			_mm_store_ps(f, transform(v.position, 1.f));
+			_mm_storeu_ps(f + 3, normalize3(transform(v.normal, 0.f)));
+			f[6] = v.texcoord.x;
+			f[7] = v.texcoord.y;
+			_mm_storeu_ps(f + 8, normalize3(transform(v.tangent, 0.f)));
+			write_vertex(out + i * out_stride, f);
+		}
+	}
+#endif
+}
+
+void skin_vertices(const skinned_vertex* vertices, size_t count, const XMFLOAT4X4* bone_matrices, size_t bone_count,
+	void* out, size_t out_stride)
+{
+	assert(out_stride >= sizeof(vertex));
+	//all four matrices are read even for zero weights, so unused slots need a valid bone too
+#ifndef NDEBUG
+	for (size_t i = 0; i < count; ++i)
+		for (uint32_t k = 0; k < 4; ++k) assert(vertices[i].bones[k] < bone_count);
+#else
+	(void)bone_count;
+#endif
+	auto block = skin_block_xm;
+#ifdef _XM_SSE_INTRINSICS_
+	if (max_simd_level() >= simd_level::avx2) block = skin_block_avx2;
+#endif
+	uint8_t* dst = (uint8_t*)out;
+	parallel_for(size_t(0), (count + block_size - 1) / block_size, [&](size_t b) {
+		block(vertices, b * block_size, min(count, (b + 1) * block_size), bone_matrices, dst, out_stride);
+	});
+}
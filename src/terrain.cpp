@@ -0,0 +1,406 @@
+#include "dxut\cmmn.h"
+#include "dxut\terrain.h"
+#include "dxut\mesh_file.h"
+#include <stdexcept>
+
+using namespace DirectX;
+using namespace std;
+
+#pragma region quadtree
+terrain_quadtree::terrain_quadtree(uint32_t leaves_x, uint32_t leaves_z, uint32_t levels, float leaf_size,
+	float min_height, float max_height)
+	: leaves_x(leaves_x), leaves_z(leaves_z), leaf_size(leaf_size)
+{
+	for (uint32_t l = 0; l < levels; ++l) {
+		uint32_t w = (leaves_x + (1u << l) - 1) >> l, h = (leaves_z + (1u << l) - 1) >> l;
+		width.push_back(w);
+		height.push_back(h);
+		bounds.emplace_back((size_t)w * h, XMFLOAT2(min_height, max_height));
+	}
+}
+
+size_t terrain_quadtree::node_count() const {
+	size_t n = 0;
+	for (const auto& b : bounds) n += b.size();
+	return n;
+}
+
+void terrain_quadtree::refresh(uint32_t x0, uint32_t z0, uint32_t x1, uint32_t z1) {
+	for (uint32_t l = 1; l < bounds.size(); ++l) {
+		x0 >>= 1; z0 >>= 1;
+		x1 = (x1 + 1) >> 1; z1 = (z1 + 1) >> 1;
+		const auto& below = bounds[l - 1];
+		uint32_t bw = width[l - 1], bh = height[l - 1];
+		for (uint32_t z = z0; z < z1; ++z) {
+			for (uint32_t x = x0; x < x1; ++x) {
+				XMFLOAT2 r(FLT_MAX, -FLT_MAX);
+				for (uint32_t cz = z * 2; cz < min(z * 2 + 2, bh); ++cz) {
+					for (uint32_t cx = x * 2; cx < min(x * 2 + 2, bw); ++cx) {
+						const XMFLOAT2& c = below[cz * bw + cx];
+						r.x = min(r.x, c.x);
+						r.y = max(r.y, c.y);
+					}
+				}
+				bounds[l][z * width[l] + x] = r;
+			}
+		}
+	}
+}
+
+BoundingBox terrain_quadtree::node_box(uint32_t level, uint32_t x, uint32_t z) const {
+	float size = leaf_size * (float)(1u << level);
+	float x0 = x * size, z0 = z * size;
+	//nodes on the far edges can hang over the end of the terrain
+	float x1 = min(x0 + size, leaves_x * leaf_size), z1 = min(z0 + size, leaves_z * leaf_size);
+	const XMFLOAT2& h = bounds[level][z * width[level] + x];
+	return BoundingBox(XMFLOAT3((x0 + x1) * 0.5f, (h.x + h.y) * 0.5f, (z0 + z1) * 0.5f),
+		XMFLOAT3((x1 - x0) * 0.5f, (h.y - h.x) * 0.5f, (z1 - z0) * 0.5f));
+}
+
+namespace {
+	inline bool within_range(const BoundingBox& b, const XMFLOAT3& p, float range) {
+		float dx = max(fabsf(p.x - b.Center.x) - b.Extents.x, 0.f);
+		float dy = max(fabsf(p.y - b.Center.y) - b.Extents.y, 0.f);
+		float dz = max(fabsf(p.z - b.Center.z) - b.Extents.z, 0.f);
+		return dx * dx + dy * dy + dz * dz <= range * range;
+	}
+}
+
+bool terrain_quadtree::select_node(uint32_t level, uint32_t x, uint32_t z, const XMFLOAT3& camera_position,
+	const vector<float>& ranges, const BoundingFrustum* frustum, vector<terrain_node>& nodes) const
+{
+	BoundingBox box = node_box(level, x, z);
+	//out of this level's range: the parent has to cover the area at its own, coarser level
+	if (!within_range(box, camera_position, ranges[level])) return false;
+	if (frustum && frustum->Contains(box) == DISJOINT) return true;
+
+	float size = leaf_size * (float)(1u << level);
+	XMFLOAT2 origin(x * size, z * size);
+	if (level == 0 || !within_range(box, camera_position, ranges[level - 1])) {
+		nodes.push_back({ origin, size, level, 4 });
+		return true;
+	}
+
+	//the children that are too far for the finer level leave their quadrant to this node
+	for (uint32_t q = 0; q < 4; ++q) {
+		uint32_t cx = x * 2 + (q & 1), cz = z * 2 + (q >> 1);
+		if (cx >= width[level - 1] || cz >= height[level - 1]) continue;
+		if (!select_node(level - 1, cx, cz, camera_position, ranges, frustum, nodes)) {
+			if (frustum && frustum->Contains(node_box(level - 1, cx, cz)) == DISJOINT) continue;
+			nodes.push_back({ origin, size, level, q });
+		}
+	}
+	return true;
+}
+
+void terrain_quadtree::select(const XMFLOAT3& camera_position, const vector<float>& ranges, const BoundingFrustum* frustum,
+	vector<terrain_node>& nodes) const
+{
+	assert(ranges.size() >= bounds.size());
+	nodes.clear();
+	if (bounds.empty()) return;
+	uint32_t top = (uint32_t)bounds.size() - 1;
+	float size = leaf_size * (float)(1u << top);
+	for (uint32_t z = 0; z < height[top]; ++z) {
+		for (uint32_t x = 0; x < width[top]; ++x) {
+			//roots beyond every range are still drawn, at the coarsest level
+			if (select_node(top, x, z, camera_position, ranges, frustum, nodes)) continue;
+			if (frustum && frustum->Contains(node_box(top, x, z)) == DISJOINT) continue;
+			nodes.push_back({ XMFLOAT2(x * size, z * size), size, top, 4 });
+		}
+	}
+}
+#pragma endregion
+
+terrain::terrain(DXDevice* dv, ComPtr<ID3D12GraphicsCommandList> commandList, const terrain_desc& d)
+	: desc(d), dv(dv), update_count(0), queue(make_shared<stream_queue>()), slots_dirty(false)
+{
+	assert(desc.patch_quads >= 2 && (desc.patch_quads & (desc.patch_quads - 1)) == 0);
+	assert(desc.tile_samples % desc.patch_quads == 0);
+	assert(desc.lod_count >= 1 && desc.resident_tiles >= 1);
+
+	uint32_t leaves_per_tile = desc.tile_samples / desc.patch_quads;
+	float leaf_size = desc.patch_quads * desc.sample_spacing;
+	tree = terrain_quadtree(desc.tiles_x * leaves_per_tile, desc.tiles_z * leaves_per_tile, desc.lod_count, leaf_size,
+		desc.height_offset, desc.height_offset + desc.height_scale);
+
+#pragma region lod ranges
+	ranges.resize(desc.lod_count);
+	lods.resize(desc.lod_count);
+	for (uint32_t l = 0; l < desc.lod_count; ++l) {
+		ranges[l] = desc.lod0_range * (float)(1u << l);
+		float previous = l ? ranges[l - 1] : 0.f;
+		terrain_lod_constants& c = lods[l];
+		c.morph_end = ranges[l];
+		c.morph_start = previous + (ranges[l] - previous) * desc.morph_ratio;
+		c.inv_morph_range = 1.f / max(c.morph_end - c.morph_start, 1e-6f);
+		c.node_size = leaf_size * (float)(1u << l);
+	}
+#pragma endregion
+
+#pragma region patch
+	//quadrant by quadrant so a node can draw just the parts its children leave; mesh narrows the indices to
+	//16 bit whenever the patch has few enough vertices
+	uint32_t n = desc.patch_quads, half = n / 2;
+	mesh_data P;
+	auto& pv = get<0>(P);
+	auto& pi = get<1>(P);
+	pv.resize((size_t)(n + 1) * (n + 1));
+	for (uint32_t z = 0; z <= n; ++z)
+		for (uint32_t x = 0; x <= n; ++x)
+			pv[z * (n + 1) + x] = vertex((float)x / n, 0.f, (float)z / n, 0.f, 1.f, 0.f, 1.f, 0.f, 0.f, (float)x / n, (float)z / n);
+	quadrant_index_count = 6 * half * half;
+	pi.reserve(4 * quadrant_index_count);
+	for (uint32_t q = 0; q < 4; ++q) {
+		uint32_t qx = (q & 1) * half, qz = (q >> 1) * half;
+		for (uint32_t z = qz; z < qz + half; ++z) {
+			for (uint32_t x = qx; x < qx + half; ++x) {
+				uint32_t a = z * (n + 1) + x, b = a + 1, c = a + n + 1, e = c + 1;
+				uint32_t tris[] = { a, c, b, b, c, e };
+				pi.insert(pi.end(), tris, tris + 6);
+			}
+		}
+	}
+	patch = mesh(dv, commandList, P);
+#pragma endregion
+
+#pragma region height tiles
+	uint32_t side = desc.tile_samples + 1;
+	chk(dv->device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16_UNORM, side, side, (UINT16)desc.resident_tiles, 1),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		nullptr,
+		IID_PPV_ARGS(&heights)));
+
+	uint32_t tile_count = desc.tiles_x * desc.tiles_z;
+	chk(dv->device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(tile_count * sizeof(int32_t)),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		nullptr,
+		IID_PPV_ARGS(&tile_slots)));
+
+	state.assign(tile_count, tile_state::unloaded);
+	slot_of_tile.assign(tile_count, -1);
+	tile_in_slot.assign(desc.resident_tiles, ~0u);
+	slot_last_used.assign(desc.resident_tiles, 0);
+	slots_dirty = true;
+#pragma endregion
+}
+
+terrain::~terrain() {
+	//the tasks only touch the shared queue, but they should not outlive the files' owner either
+	for (auto& t : in_flight) t.wait();
+}
+
+void terrain::create_views(descriptor_heap& heap, uint32_t index) {
+	D3D12_SHADER_RESOURCE_VIEW_DESC srv = {};
+	srv.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srv.Format = DXGI_FORMAT_R16_UNORM;
+	srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	srv.Texture2DArray.MipLevels = 1;
+	srv.Texture2DArray.ArraySize = desc.resident_tiles;
+	dv->device->CreateShaderResourceView(heights.Get(), &srv, heap.cpu_handle(index));
+
+	srv = {};
+	srv.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srv.Format = DXGI_FORMAT_R32_SINT;
+	srv.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+	srv.Buffer.NumElements = desc.tiles_x * desc.tiles_z;
+	dv->device->CreateShaderResourceView(tile_slots.Get(), &srv, heap.cpu_handle(index + 1));
+}
+
+void terrain::integrate(ComPtr<ID3D12GraphicsCommandList> commandList, loaded_tile& t) {
+	if (t.samples.empty()) {
+		state[t.tile] = tile_state::failed;
+		return;
+	}
+	uint32_t tx = t.tile % desc.tiles_x, tz = t.tile / desc.tiles_x;
+	uint32_t side = desc.tile_samples + 1;
+
+	//an empty slot if there is one, otherwise the one that went unused the longest. Tiles drawn in this update
+	//are never evicted; when they fill every slot the new tile is dropped and requested again once one frees up
+	uint32_t slot = ~0u;
+	for (uint32_t s = 0; s < desc.resident_tiles; ++s) {
+		if (tile_in_slot[s] == ~0u) {
+			slot = s;
+			break;
+		}
+		if (slot_last_used[s] < update_count && (slot == ~0u || slot_last_used[s] < slot_last_used[slot])) slot = s;
+	}
+	if (slot == ~0u) {
+		state[t.tile] = tile_state::unloaded;
+		return;
+	}
+
+#pragma region node bounds
+	//the heights stay valid after the tile is evicted again, so the quadtree keeps culling with them
+	uint32_t leaves_per_tile = desc.tile_samples / desc.patch_quads;
+	float scale = desc.height_scale / 65535.f;
+	parallel_for(0u, leaves_per_tile * leaves_per_tile, [&](uint32_t l) {
+		uint32_t lx = l % leaves_per_tile, lz = l / leaves_per_tile;
+		uint16_t lo = 0xffff, hi = 0;
+		for (uint32_t z = lz * desc.patch_quads; z <= (lz + 1) * desc.patch_quads; ++z) {
+			const uint16_t* row = t.samples.data() + (size_t)z * side;
+			for (uint32_t x = lx * desc.patch_quads; x <= (lx + 1) * desc.patch_quads; ++x) {
+				lo = min(lo, row[x]);
+				hi = max(hi, row[x]);
+			}
+		}
+		tree.set_leaf(tx * leaves_per_tile + lx, tz * leaves_per_tile + lz,
+			lo * scale + desc.height_offset, hi * scale + desc.height_offset);
+	});
+	tree.refresh(tx * leaves_per_tile, tz * leaves_per_tile, (tx + 1) * leaves_per_tile, (tz + 1) * leaves_per_tile);
+#pragma endregion
+
+	if (tile_in_slot[slot] != ~0u) {
+		state[tile_in_slot[slot]] = tile_state::unloaded;
+		slot_of_tile[tile_in_slot[slot]] = -1;
+	}
+	tile_in_slot[slot] = t.tile;
+	slot_of_tile[t.tile] = (int32_t)slot;
+	slot_last_used[slot] = update_count;
+	state[t.tile] = tile_state::resident;
+	slots_dirty = true;
+
+	auto up = dv->new_upload_resource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(heights.Get(), slot, 1)),
+		D3D12_RESOURCE_STATE_GENERIC_READ);
+	D3D12_SUBRESOURCE_DATA srd = {};
+	srd.pData = t.samples.data();
+	srd.RowPitch = side * sizeof(uint16_t);
+	srd.SlicePitch = srd.RowPitch * side;
+	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(heights.Get(),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST, slot));
+	UpdateSubresources<1>(commandList.Get(), heights.Get(), up.Get(), 0, slot, 1, &srd);
+	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(heights.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, slot));
+}
+
+void terrain::update(ComPtr<ID3D12GraphicsCommandList> commandList, const XMFLOAT3& camera_position) {
+	update_count++;
+
+#pragma region working set
+	//the nearest resident_tiles tiles within stream_range; the ones beyond that budget are neither requested
+	//nor kept, since loading them could only evict tiles that are closer
+	float tile_size = desc.tile_samples * desc.sample_spacing;
+	vector<pair<float, uint32_t>> wanted;
+	for (uint32_t tz = 0; tz < desc.tiles_z; ++tz) {
+		for (uint32_t tx = 0; tx < desc.tiles_x; ++tx) {
+			float dx = max(max(tx * tile_size - camera_position.x, camera_position.x - (tx + 1) * tile_size), 0.f);
+			float dz = max(max(tz * tile_size - camera_position.z, camera_position.z - (tz + 1) * tile_size), 0.f);
+			float d = sqrtf(dx * dx + dz * dz);
+			if (d <= desc.stream_range) wanted.push_back({ d, tz * desc.tiles_x + tx });
+		}
+	}
+	sort(wanted.begin(), wanted.end());
+	if (wanted.size() > desc.resident_tiles) wanted.resize(desc.resident_tiles);
+	for (auto& w : wanted)
+		if (state[w.second] == tile_state::resident) slot_last_used[slot_of_tile[w.second]] = update_count;
+#pragma endregion
+
+	vector<loaded_tile> done;
+	{
+		lock_guard<mutex> l(queue->lock);
+		done.swap(queue->done);
+	}
+	for (auto& t : done) integrate(commandList, t);
+	in_flight.erase(remove_if(in_flight.begin(), in_flight.end(),
+		[](const concurrency::task<void>& t) { return t.is_done(); }), in_flight.end());
+
+#pragma region requests
+	//nearest first, and only a few reads at a time so that close tiles are not queued behind far ones
+	const size_t max_in_flight = 4;
+	for (size_t i = 0; i < wanted.size() && in_flight.size() < max_in_flight; ++i) {
+		uint32_t tile = wanted[i].second;
+		if (state[tile] != tile_state::unloaded) continue;
+		state[tile] = tile_state::loading;
+		wchar_t path[MAX_PATH];
+		swprintf(path, MAX_PATH, desc.tile_path.c_str(), tile % desc.tiles_x, tile / desc.tiles_x);
+		size_t sample_count = (size_t)(desc.tile_samples + 1) * (desc.tile_samples + 1);
+		auto q = queue;
+		wstring file(path);
+		in_flight.push_back(concurrency::create_task([q, file, tile, sample_count] {
+			loaded_tile t;
+			t.tile = tile;
+			try {
+				mapped_file f(file);
+				if (f.size() >= sample_count * sizeof(uint16_t)) {
+					t.samples.resize(sample_count);
+					memcpy(t.samples.data(), f.data(), sample_count * sizeof(uint16_t));
+				}
+			} catch (const runtime_error&) {
+				//left empty, which marks the tile as failed
+			}
+			lock_guard<mutex> l(q->lock);
+			q->done.push_back(move(t));
+		}));
+	}
+#pragma endregion
+
+	if (slots_dirty) {
+		size_t size = slot_of_tile.size() * sizeof(int32_t);
+		auto up = dv->new_upload_resource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(size),
+			D3D12_RESOURCE_STATE_GENERIC_READ);
+		void* dst;
+		CD3DX12_RANGE no_read(0, 0);
+		chk(up->Map(0, &no_read, &dst));
+		memcpy(dst, slot_of_tile.data(), size);
+		up->Unmap(0, nullptr);
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(tile_slots.Get(),
+			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+		commandList->CopyBufferRegion(tile_slots.Get(), 0, up.Get(), 0, size);
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(tile_slots.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+		slots_dirty = false;
+	}
+}
+
+void terrain::select(const XMFLOAT3& camera_position, const BoundingFrustum* frustum, vector<terrain_node>& nodes) const {
+	tree.select(camera_position, ranges, frustum, nodes);
+}
+
+void terrain::draw(ComPtr<ID3D12GraphicsCommandList> commandList, const vector<terrain_node>& nodes,
+	dynamic_instance_buffer& instances, uint32_t frame) const
+{
+	assert(instances.stride() == sizeof(terrain_node));
+	if (nodes.empty()) return;
+
+	//instances grouped by quadrant kind, so each kind is one instanced draw over its index range
+	uint32_t first[6] = {};
+	for (const auto& n : nodes) first[n.quadrant + 1]++;
+	for (uint32_t k = 0; k < 5; ++k) first[k + 1] += first[k];
+	instances.resize((uint32_t)nodes.size());
+	uint32_t at[5];
+	memcpy(at, first, sizeof(at));
+	for (const auto& n : nodes) instances.at<terrain_node>(at[n.quadrant]++) = n;
+	const D3D12_VERTEX_BUFFER_VIEW& view = instances.upload(frame);
+
+	commandList->IASetVertexBuffers(0, 1, &patch.vertex_buffer_view());
+	commandList->IASetVertexBuffers(1, 1, &view);
+	commandList->IASetIndexBuffer(&patch.index_buffer_view());
+	for (uint32_t k = 0; k < 5; ++k) {
+		uint32_t count = first[k + 1] - first[k];
+		if (count == 0) continue;
+		uint32_t start = k == 4 ? 0 : k * quadrant_index_count;
+		uint32_t index_count = k == 4 ? 4 * quadrant_index_count : quadrant_index_count;
+		commandList->DrawIndexedInstanced(index_count, count, patch.start_index() + start, patch.base_vertex(), first[k]);
+	}
+}
+
+vector<D3D12_INPUT_ELEMENT_DESC> terrain::input_layout() {
+	return {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NODE_ORIGIN", 0, DXGI_FORMAT_R32G32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "NODE_SIZE", 0, DXGI_FORMAT_R32_FLOAT, 1, 8, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "NODE_LOD", 0, DXGI_FORMAT_R32_UINT, 1, 12, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "NODE_QUADRANT", 0, DXGI_FORMAT_R32_UINT, 1, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+	};
+}
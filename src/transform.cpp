@@ -0,0 +1,277 @@
+#include "dxut\cmmn.h"
+#include "dxut\transform.h"
+#include "dxut\cpu_features.h"
+#ifdef _XM_SSE_INTRINSICS_
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+	const size_t block_size = 4096;
+
+	inline const float* at(const void* base, size_t stride, size_t i) { return (const float*)((const uint8_t*)base + i * stride); }
+	inline float* at(void* base, size_t stride, size_t i) { return (float*)((uint8_t*)base + i * stride); }
+
+	//in blocks, in parallel once there is more than one
+	template <typename F>
+	void for_blocks(size_t count, F f) {
+		size_t blocks = (count + block_size - 1) / block_size;
+		if (blocks <= 1) {
+			if (count) f(size_t(0), count);
+			return;
+		}
+		parallel_for(size_t(0), blocks, [&](size_t b) { f(b * block_size, min(count, (b + 1) * block_size)); });
+	}
+
+#ifdef _XM_SSE_INTRINSICS_
+	//three floats in and out without touching the fourth, which may belong to someone else or not exist
+	inline __m128 load3(const float* p) {
+		return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)p)), _mm_load_ss(p + 2));
+	}
+	inline void store3(float* p, __m128 v) {
+		_mm_store_sd((double*)p, _mm_castps_pd(v));
+		_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+	}
+
+#pragma region sse
+	//one element per register, unfused and in the order DirectXMath's SSE2 path evaluates the same products, so
+	//it agrees with the DirectXMath loop of a build without _XM_FMA3_INTRINSICS_; it only saves the calls,
+	//loads and stores of whole XMVECTORs, while the wider kernels fuse and reorder
+	void points_sse(const void* in, size_t in_stride, size_t begin, size_t end, const XMFLOAT4X4& m, void* out, size_t out_stride,
+		bool direction, bool normalize)
+	{
+		__m128 r0 = _mm_loadu_ps(&m._11), r1 = _mm_loadu_ps(&m._21), r2 = _mm_loadu_ps(&m._31), r3 = _mm_loadu_ps(&m._41);
+		for (size_t i = begin; i < end; ++i) {
+			__m128 v = load3(at(in, in_stride, i));
+			__m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0xaa), r2);
+			if (!direction) r = _mm_add_ps(r, r3);
+			r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), r1), r);
+			r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), r0), r);
+			if (normalize) {
+				//x x + z z first, then y y, like XMVector3Dot
+				__m128 d = _mm_mul_ps(r, r);
+				__m128 len2 = _mm_add_ss(_mm_add_ss(d, _mm_shuffle_ps(d, d, 0x66)), _mm_shuffle_ps(d, d, 0x55));
+				len2 = _mm_shuffle_ps(len2, len2, 0x00);
+				r = _mm_and_ps(_mm_div_ps(r, _mm_sqrt_ps(len2)), _mm_cmpgt_ps(len2, _mm_setzero_ps()));
+			}
+			store3(at(out, out_stride, i), r);
+		}
+	}
+
+	void matrices_sse(const void* a, size_t a_stride, size_t begin, size_t end, const XMFLOAT4X4& b, void* out, size_t out_stride,
+		bool transpose)
+	{
+		__m128 b0 = _mm_loadu_ps(&b._11), b1 = _mm_loadu_ps(&b._21), b2 = _mm_loadu_ps(&b._31), b3 = _mm_loadu_ps(&b._41);
+		for (size_t i = begin; i < end; ++i) {
+			const float* s = at(a, a_stride, i);
+			float* d = at(out, out_stride, i);
+			__m128 p[4];
+			for (int r = 0; r < 4; ++r) {
+				//(x b0 + z b2) + (y b1 + w b3), the pairing XMMatrixMultiply uses
+				__m128 row = _mm_loadu_ps(s + 4 * r);
+				__m128 xz = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(row, row, 0x00), b0), _mm_mul_ps(_mm_shuffle_ps(row, row, 0xaa), b2));
+				__m128 yw = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(row, row, 0x55), b1), _mm_mul_ps(_mm_shuffle_ps(row, row, 0xff), b3));
+				p[r] = _mm_add_ps(xz, yw);
+			}
+			if (transpose) _MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+			for (int r = 0; r < 4; ++r) _mm_storeu_ps(d + 4 * r, p[r]);
+		}
+	}
+#pragma endregion
+
+#pragma region avx2
+	//two elements per register, one in each 128 bit half, against the matrix rows repeated in both halves
+	void points_avx2(const void* in, size_t in_stride, size_t begin, size_t end, const XMFLOAT4X4& m, void* out, size_t out_stride,
+		bool direction, bool normalize)
+	{
+		__m256 r0 = _mm256_broadcast_ps((const __m128*)&m._11), r1 = _mm256_broadcast_ps((const __m128*)&m._21);
+		__m256 r2 = _mm256_broadcast_ps((const __m128*)&m._31);
+		__m256 r3 = direction ? _mm256_setzero_ps() : _mm256_broadcast_ps((const __m128*)&m._41);
+		size_t i = begin;
+		for (; i < end; i += 2) {
+			bool pair = i + 1 < end;
+			__m128 a = load3(at(in, in_stride, i)), b = pair ? load3(at(in, in_stride, i + 1)) : a;
+			__m256 v = _mm256_set_m128(b, a);
+			__m256 r = _mm256_fmadd_ps(_mm256_permute_ps(v, 0x00), r0,
+				_mm256_fmadd_ps(_mm256_permute_ps(v, 0x55), r1, _mm256_fmadd_ps(_mm256_permute_ps(v, 0xaa), r2, r3)));
+			if (normalize) {
+				__m256 d = _mm256_mul_ps(r, r);
+				__m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_permute_ps(d, 0x00), _mm256_permute_ps(d, 0x55)), _mm256_permute_ps(d, 0xaa));
+				r = _mm256_and_ps(_mm256_div_ps(r, _mm256_sqrt_ps(len2)), _mm256_cmp_ps(len2, _mm256_setzero_ps(), _CMP_GT_OQ));
+			}
+			store3(at(out, out_stride, i), _mm256_castps256_ps128(r));
+			if (pair) store3(at(out, out_stride, i + 1), _mm256_extractf128_ps(r, 1));
+		}
+	}
+
+	void matrices_avx2(const void* a, size_t a_stride, size_t begin, size_t end, const XMFLOAT4X4& b, void* out, size_t out_stride,
+		bool transpose)
+	{
+		__m256 b0 = _mm256_broadcast_ps((const __m128*)&b._11), b1 = _mm256_broadcast_ps((const __m128*)&b._21);
+		__m256 b2 = _mm256_broadcast_ps((const __m128*)&b._31), b3 = _mm256_broadcast_ps((const __m128*)&b._41);
+		for (size_t i = begin; i < end; ++i) {
+			const float* s = at(a, a_stride, i);
+			float* d = at(out, out_stride, i);
+			//rows 0 and 1 of a in one register and rows 2 and 3 in the other; row r of the product is
+			//a[r][0] b0 + a[r][1] b1 + a[r][2] b2 + a[r][3] b3
+			__m256 a01 = _mm256_loadu_ps(s), a23 = _mm256_loadu_ps(s + 8);
+			__m256 p01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0x00), b0, _mm256_fmadd_ps(_mm256_permute_ps(a01, 0x55), b1,
+				_mm256_fmadd_ps(_mm256_permute_ps(a01, 0xaa), b2, _mm256_mul_ps(_mm256_permute_ps(a01, 0xff), b3))));
+			__m256 p23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, 0x00), b0, _mm256_fmadd_ps(_mm256_permute_ps(a23, 0x55), b1,
+				_mm256_fmadd_ps(_mm256_permute_ps(a23, 0xaa), b2, _mm256_mul_ps(_mm256_permute_ps(a23, 0xff), b3))));
+			if (transpose) {
+				__m128 q0 = _mm256_castps256_ps128(p01), q1 = _mm256_extractf128_ps(p01, 1);
+				__m128 q2 = _mm256_castps256_ps128(p23), q3 = _mm256_extractf128_ps(p23, 1);
+				_MM_TRANSPOSE4_PS(q0, q1, q2, q3);
+				_mm_storeu_ps(d, q0);
+				_mm_storeu_ps(d + 4, q1);
+				_mm_storeu_ps(d + 8, q2);
+				_mm_storeu_ps(d + 12, q3);
+			} else {
+				_mm256_storeu_ps(d, p01);
+				_mm256_storeu_ps(d + 8, p23);
+			}
+		}
+	}
+#pragma endregion
+
+#pragma region avx512
+	void points_avx512(const void* in, size_t in_stride, size_t begin, size_t end, const XMFLOAT4X4& m, void* out, size_t out_stride,
+		bool direction, bool normalize)
+	{
+		__m512 r0 = _mm512_broadcast_f32x4(_mm_loadu_ps(&m._11)), r1 = _mm512_broadcast_f32x4(_mm_loadu_ps(&m._21));
+		__m512 r2 = _mm512_broadcast_f32x4(_mm_loadu_ps(&m._31));
+		__m512 r3 = direction ? _mm512_setzero_ps() : _mm512_broadcast_f32x4(_mm_loadu_ps(&m._41));
+		for (size_t i = begin; i < end; i += 4) {
+			uint32_t n = (uint32_t)min((size_t)4, end - i);
+			__m128 p[4];
+			for (uint32_t k = 0; k < 4; ++k) p[k] = k < n ? load3(at(in, in_stride, i + k)) : p[0];
+			__m512 v = _mm512_insertf32x4(_mm512_insertf32x4(_mm512_insertf32x4(_mm512_castps128_ps512(p[0]), p[1], 1), p[2], 2), p[3], 3);
+			__m512 r = _mm512_fmadd_ps(_mm512_permute_ps(v, 0x00), r0,
+				_mm512_fmadd_ps(_mm512_permute_ps(v, 0x55), r1, _mm512_fmadd_ps(_mm512_permute_ps(v, 0xaa), r2, r3)));
+			if (normalize) {
+				__m512 d = _mm512_mul_ps(r, r);
+				__m512 len2 = _mm512_add_ps(_mm512_add_ps(_mm512_permute_ps(d, 0x00), _mm512_permute_ps(d, 0x55)), _mm512_permute_ps(d, 0xaa));
+				__mmask16 nonzero = _mm512_cmp_ps_mask(len2, _mm512_setzero_ps(), _CMP_GT_OQ);
+				r = _mm512_maskz_div_ps(nonzero, r, _mm512_sqrt_ps(len2));
+			}
+			store3(at(out, out_stride, i), _mm512_castps512_ps128(r));
+			if (n > 1) store3(at(out, out_stride, i + 1), _mm512_extractf32x4_ps(r, 1));
+			if (n > 2) store3(at(out, out_stride, i + 2), _mm512_extractf32x4_ps(r, 2));
+			if (n > 3) store3(at(out, out_stride, i + 3), _mm512_extractf32x4_ps(r, 3));
+		}
+	}
+
+	void matrices_avx512(const void* a, size_t a_stride, size_t begin, size_t end, const XMFLOAT4X4& b, void* out, size_t out_stride,
+		bool transpose)
+	{
+		__m512 b0 = _mm512_broadcast_f32x4(_mm_loadu_ps(&b._11)), b1 = _mm512_broadcast_f32x4(_mm_loadu_ps(&b._21));
+		__m512 b2 = _mm512_broadcast_f32x4(_mm_loadu_ps(&b._31)), b3 = _mm512_broadcast_f32x4(_mm_loadu_ps(&b._41));
+		for (size_t i = begin; i < end; ++i) {
+			const float* s = at(a, a_stride, i);
+			float* d = at(out, out_stride, i);
+			//the whole matrix in one register, a row per 128 bit lane
+			__m512 m = _mm512_loadu_ps(s);
+			__m512 p = _mm512_fmadd_ps(_mm512_permute_ps(m, 0x00), b0, _mm512_fmadd_ps(_mm512_permute_ps(m, 0x55), b1,
+				_mm512_fmadd_ps(_mm512_permute_ps(m, 0xaa), b2, _mm512_mul_ps(_mm512_permute_ps(m, 0xff), b3))));
+			if (transpose) {
+				__m128 q0 = _mm512_castps512_ps128(p), q1 = _mm512_extractf32x4_ps(p, 1);
+				__m128 q2 = _mm512_extractf32x4_ps(p, 2), q3 = _mm512_extractf32x4_ps(p, 3);
+				_MM_TRANSPOSE4_PS(q0, q1, q2, q3);
+				_mm_storeu_ps(d, q0);
+				_mm_storeu_ps(d + 4, q1);
+				_mm_storeu_ps(d + 8, q2);
+				_mm_storeu_ps(d + 12, q3);
+			} else _mm512_storeu_ps(d, p);
+		}
+	}
+#pragma endregion
+#endif
+
+#pragma region directxmath
+	void points_xm(const void* in, size_t in_stride, size_t begin, size_t end, const XMFLOAT4X4& m, void* out, size_t out_stride,
+		bool direction, bool normalize)
+	{
+		XMMATRIX M = XMLoadFloat4x4(&m);
+		for (size_t i = begin; i < end; ++i) {
+			XMVECTOR v = XMLoadFloat3((const XMFLOAT3*)at(in, in_stride, i));
+			v = direction ? XMVector3TransformNormal(v, M) : XMVector3Transform(v, M);
+			if (normalize) v = XMVector3Normalize(v);
+			XMStoreFloat3((XMFLOAT3*)at(out, out_stride, i), v);
+		}
+	}
+
+	void matrices_xm(const void* a, size_t a_stride, size_t begin, size_t end, const XMFLOAT4X4& b, void* out, size_t out_stride,
+		bool transpose)
+	{
+		XMMATRIX B = XMLoadFloat4x4(&b);
+		for (size_t i = begin; i < end; ++i) {
+			XMMATRIX p = XMMatrixMultiply(XMLoadFloat4x4((const XMFLOAT4X4*)at(a, a_stride, i)), B);
+			XMStoreFloat4x4((XMFLOAT4X4*)at(out, out_stride, i), transpose ? XMMatrixTranspose(p) : p);
+		}
+	}
+#pragma endregion
+
+	typedef void(*points_kernel)(const void*, size_t, size_t, size_t, const XMFLOAT4X4&, void*, size_t, bool, bool);
+	typedef void(*matrices_kernel)(const void*, size_t, size_t, size_t, const XMFLOAT4X4&, void*, size_t, bool);
+
+	points_kernel pick_points() {
+#ifdef _XM_SSE_INTRINSICS_
+		switch (max_simd_level()) {
+		case simd_level::avx512: return points_avx512;
+		case simd_level::avx2: return points_avx2;
+		case simd_level::sse: return points_sse;
+		default: break;
+		}
+#endif
+		return points_xm;
+	}
+
+	matrices_kernel pick_matrices() {
+#ifdef _XM_SSE_INTRINSICS_
+		switch (max_simd_level()) {
+		case simd_level::avx512: return matrices_avx512;
+		case simd_level::avx2: return matrices_avx2;
+		case simd_level::sse: return matrices_sse;
+		default: break;
+		}
+#endif
+		return matrices_xm;
+	}
+}
+
+void transform_points(const void* in, size_t in_stride, size_t count, FXMMATRIX m, void* out, size_t out_stride) {
+	XMFLOAT4X4 mf;
+	XMStoreFloat4x4(&mf, m);
+	points_kernel k = pick_points();
+	for_blocks(count, [&](size_t begin, size_t end) { k(in, in_stride, begin, end, mf, out, out_stride, false, false); });
+}
+
+void transform_normals(const void* in, size_t in_stride, size_t count, FXMMATRIX m, void* out, size_t out_stride, bool normalize) {
+	XMFLOAT4X4 mf;
+	XMStoreFloat4x4(&mf, m);
+	points_kernel k = pick_points();
+	for_blocks(count, [&](size_t begin, size_t end) { k(in, in_stride, begin, end, mf, out, out_stride, true, normalize); });
+}
+
+void multiply_matrices(const void* a, size_t a_stride, size_t count, FXMMATRIX b, void* out, size_t out_stride, bool transpose) {
+	XMFLOAT4X4 bf;
+	XMStoreFloat4x4(&bf, b);
+	matrices_kernel k = pick_matrices();
+	for_blocks(count, [&](size_t begin, size_t end) { k(a, a_stride, begin, end, bf, out, out_stride, transpose); });
+}
+
+void transform_mesh(mesh_data& D, FXMMATRIX world) {
+	auto& V = get<0>(D);
+	auto& I = get<1>(D);
+	if (!V.empty()) {
+		XMMATRIX normal_matrix = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+		transform_points(&V[0].position, sizeof(vertex), V.size(), world, &V[0].position, sizeof(vertex));
+		transform_normals(&V[0].normal, sizeof(vertex), V.size(), normal_matrix, &V[0].normal, sizeof(vertex));
+		transform_normals(&V[0].tangent, sizeof(vertex), V.size(), world, &V[0].tangent, sizeof(vertex));
+	}
+	if (XMVectorGetX(XMMatrixDeterminant(world)) < 0.f)
+		for (size_t t = 0; t + 2 < I.size(); t += 3) swap(I[t + 1], I[t + 2]);
+}
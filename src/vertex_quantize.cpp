@@ -0,0 +1,201 @@
+#include "dxut\cmmn.h"
+#include "dxut\vertex_quantize.h"
+#include <DirectXPackedVector.h>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+using namespace std;
+
+namespace {
+	struct stream_offsets {
+		uint32_t position, texcoord, normal, tangent, stride;
+	};
+
+	stream_offsets offsets_for(const quantize_options& opt) {
+		stream_offsets o;
+		uint32_t frame_size = opt.octahedral_frame ? 2 * (opt.frame_bits / 8) : 12;
+		o.position = 0;
+		o.texcoord = o.position + (opt.position_unorm16 ? 8 : 12);
+		o.normal = o.texcoord + (opt.half_texcoords ? 4 : 8);
+		o.tangent = o.normal + frame_size;
+		o.stride = (o.tangent + frame_size + 3) & ~3u;
+		return o;
+	}
+
+	inline float sign_not_zero(float x) { return x >= 0.f ? 1.f : -1.f; }
+
+	template <typename T>
+	inline T to_snorm(float x, float max_value) {
+		x = x < -1.f ? -1.f : (x > 1.f ? 1.f : x);
+		return (T)lroundf(x * max_value);
+	}
+}
+
+XMFLOAT2 octahedral_encode(FXMVECTOR n) {
+	XMFLOAT3 v;
+	XMStoreFloat3(&v, n);
+	float l1 = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+	if (l1 <= 0.f) return XMFLOAT2(0.f, 0.f);
+	float x = v.x / l1, y = v.y / l1;
+	if (v.z < 0.f) {
+		float ox = (1.f - fabsf(y)) * sign_not_zero(x);
+		float oy = (1.f - fabsf(x)) * sign_not_zero(y);
+		x = ox; y = oy;
+	}
+	return XMFLOAT2(x, y);
+}
+
+XMVECTOR octahedral_decode(XMFLOAT2 e) {
+	float x = e.x, y = e.y;
+	float z = 1.f - fabsf(x) - fabsf(y);
+	if (z < 0.f) {
+		float ox = (1.f - fabsf(y)) * sign_not_zero(x);
+		float oy = (1.f - fabsf(x)) * sign_not_zero(y);
+		x = ox; y = oy;
+	}
+	return XMVector3Normalize(XMVectorSet(x, y, z, 0.f));
+}
+
+quantized_vertex_stream quantize_vertices(const vector<vertex>& vertices, const quantize_options& opt) {
+	assert(!opt.octahedral_frame || opt.frame_bits == 8 || opt.frame_bits == 16);
+
+	quantized_vertex_stream s;
+	stream_offsets o = offsets_for(opt);
+	s.options = opt;
+	s.stride = o.stride;
+	s.vertex_count = vertices.size();
+	s.data.assign(vertices.size() * o.stride, 0);
+
+#pragma region layout
+	DXGI_FORMAT frame_format = opt.octahedral_frame
+		? (opt.frame_bits == 8 ? DXGI_FORMAT_R8G8_SNORM : DXGI_FORMAT_R16G16_SNORM)
+		: DXGI_FORMAT_R32G32B32_FLOAT;
+	s.layout = {
+		{ "POSITION", 0, opt.position_unorm16 ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT,
+			0, o.position, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, opt.half_texcoords ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R32G32_FLOAT,
+			0, o.texcoord, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, frame_format, 0, o.normal, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, frame_format, 0, o.tangent, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+#pragma endregion
+
+#pragma region position range
+	XMVECTOR pmin = XMVectorReplicate(FLT_MAX), pmax = XMVectorReplicate(-FLT_MAX);
+	for (const auto& v : vertices) {
+		XMVECTOR p = XMLoadFloat3(&v.position);
+		pmin = XMVectorMin(pmin, p);
+		pmax = XMVectorMax(pmax, p);
+	}
+	if (vertices.empty()) pmin = pmax = XMVectorZero();
+	//a flat axis still needs a nonzero scale so the encoder does not divide by zero
+	XMVECTOR extent = XMVectorMax(pmax - pmin, XMVectorReplicate(FLT_MIN));
+	if (opt.position_unorm16) {
+		XMStoreFloat4(&s.constants.position_scale, XMVectorSetW(extent, 0.f));
+		XMStoreFloat4(&s.constants.position_offset, XMVectorSetW(pmin, 0.f));
+	} else {
+		s.constants.position_scale = XMFLOAT4(1.f, 1.f, 1.f, 0.f);
+		s.constants.position_offset = XMFLOAT4(0.f, 0.f, 0.f, 0.f);
+	}
+	XMVECTOR inv_extent = XMVectorReciprocal(extent);
+#pragma endregion
+
+	parallel_for(size_t(0), vertices.size(), [&](size_t i) {
+		const vertex& v = vertices[i];
+		uint8_t* dst = s.data.data() + i * o.stride;
+
+		if (opt.position_unorm16) {
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, (XMLoadFloat3(&v.position) - pmin) * inv_extent);
+			uint16_t q[4] = {
+				(uint16_t)lroundf(max(0.f, min(1.f, p.x)) * 65535.f),
+				(uint16_t)lroundf(max(0.f, min(1.f, p.y)) * 65535.f),
+				(uint16_t)lroundf(max(0.f, min(1.f, p.z)) * 65535.f),
+				0 };
+			memcpy(dst + o.position, q, sizeof(q));
+		} else memcpy(dst + o.position, &v.position, sizeof(XMFLOAT3));
+
+		if (opt.half_texcoords) {
+			HALF h[2] = { XMConvertFloatToHalf(v.texcoord.x), XMConvertFloatToHalf(v.texcoord.y) };
+			memcpy(dst + o.texcoord, h, sizeof(h));
+		} else memcpy(dst + o.texcoord, &v.texcoord, sizeof(XMFLOAT2));
+
+		const XMFLOAT3* frame[2] = { &v.normal, &v.tangent };
+		uint32_t frame_offset[2] = { o.normal, o.tangent };
+		for (uint32_t f = 0; f < 2; ++f) {
+			if (!opt.octahedral_frame) {
+				memcpy(dst + frame_offset[f], frame[f], sizeof(XMFLOAT3));
+				continue;
+			}
+			XMFLOAT2 e = octahedral_encode(XMLoadFloat3(frame[f]));
+			if (opt.frame_bits == 8) {
+				int8_t q[2] = { to_snorm<int8_t>(e.x, 127.f), to_snorm<int8_t>(e.y, 127.f) };
+				memcpy(dst + frame_offset[f], q, sizeof(q));
+			} else {
+				int16_t q[2] = { to_snorm<int16_t>(e.x, 32767.f), to_snorm<int16_t>(e.y, 32767.f) };
+				memcpy(dst + frame_offset[f], q, sizeof(q));
+			}
+		}
+	});
+
+	return s;
+}
+
+vertex dequantize_vertex(const quantized_vertex_stream& s, size_t i) {
+	const quantize_options& opt = s.options;
+	stream_offsets o = offsets_for(opt);
+	const uint8_t* src = s.data.data() + i * s.stride;
+	vertex v;
+
+	if (opt.position_unorm16) {
+		uint16_t q[4];
+		memcpy(q, src + o.position, sizeof(q));
+		const XMFLOAT4& sc = s.constants.position_scale;
+		const XMFLOAT4& of = s.constants.position_offset;
+		v.position = XMFLOAT3(
+			q[0] / 65535.f * sc.x + of.x,
+			q[1] / 65535.f * sc.y + of.y,
+			q[2] / 65535.f * sc.z + of.z);
+	} else memcpy(&v.position, src + o.position, sizeof(XMFLOAT3));
+
+	if (opt.half_texcoords) {
+		HALF h[2];
+		memcpy(h, src + o.texcoord, sizeof(h));
+		v.texcoord = XMFLOAT2(XMConvertHalfToFloat(h[0]), XMConvertHalfToFloat(h[1]));
+	} else memcpy(&v.texcoord, src + o.texcoord, sizeof(XMFLOAT2));
+
+	XMFLOAT3* frame[2] = { &v.normal, &v.tangent };
+	uint32_t frame_offset[2] = { o.normal, o.tangent };
+	for (uint32_t f = 0; f < 2; ++f) {
+		if (!opt.octahedral_frame) {
+			memcpy(frame[f], src + frame_offset[f], sizeof(XMFLOAT3));
+			continue;
+		}
+		XMFLOAT2 e;
+		//SNORM decode clamps the most negative value to -1, same as the hardware
+		if (opt.frame_bits == 8) {
+			int8_t q[2];
+			memcpy(q, src + frame_offset[f], sizeof(q));
+			e = XMFLOAT2(max(-1.f, q[0] / 127.f), max(-1.f, q[1] / 127.f));
+		} else {
+			int16_t q[2];
+			memcpy(q, src + frame_offset[f], sizeof(q));
+			e = XMFLOAT2(max(-1.f, q[0] / 32767.f), max(-1.f, q[1] / 32767.f));
+		}
+		XMStoreFloat3(frame[f], octahedral_decode(e));
+	}
+	return v;
+}
+
+void compute_bounds(const quantized_vertex_stream& s, BoundingBox& box, BoundingSphere& sphere) {
+	if (!s.options.position_unorm16 || s.vertex_count == 0) {
+		compute_bounds(s.data.data() + offsets_for(s.options).position, s.vertex_count, s.stride, box, sphere);
+		return;
+	}
+	XMVECTOR extents = XMLoadFloat4(&s.constants.position_scale) * .5f;
+	XMVECTOR center = XMLoadFloat4(&s.constants.position_offset) + extents;
+	XMStoreFloat3(&box.Center, center);
+	XMStoreFloat3(&box.Extents, extents);
+	sphere.Center = box.Center;
+	sphere.Radius = XMVectorGetX(XMVector3Length(extents));
+}
@@ -0,0 +1,42 @@
+#include "test.h"
+#include <cstring>
+
+namespace {
+	struct test_case {
+		const char* name;
+		test_function run;
+	};
+	vector<test_case>& tests() {
+		static vector<test_case> all;
+		return all;
+	}
+	uint32_t failures;
+}
+
+void register_test(const char* name, test_function f) {
+	tests().push_back({ name, f });
+}
+
+void test_failure(const char* file, int line, const char* expression) {
+	//only the first few failures of a case are worth reading
+	if (failures++ < 8) printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+}
+
+int main(int argc, char** argv) {
+	const char* filter = argc > 1 ? argv[1] : "";
+	int failed = 0;
+	for (auto& t : tests()) {
+		if (!strstr(t.name, filter)) continue;
+		failures = 0;
+		try {
+			t.run();
+		} catch (const exception& e) {
+			printf("  exception: %s\n", e.what());
+			failures++;
+		}
+		printf("%-40s %s\n", t.name, failures ? "FAILED" : "ok");
+		fflush(stdout);
+		if (failures) failed++;
+	}
+	return failed;
+}
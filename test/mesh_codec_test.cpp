@@ -0,0 +1,106 @@
+#include "test.h"
+#include "dxut\mesh_codec.h"
+#include "dxut\mesh_optimize.h"
+#include <set>
+
+namespace {
+	mesh_data optimized_sphere(uint32_t slices, uint32_t stacks) {
+		mesh_data D = generate_sphere_mesh(2.f, slices, stacks);
+		optimize_vertex_cache(D);
+		optimize_vertex_fetch(D);
+		return D;
+	}
+
+	//triangles rotated to start at their smallest index, so the sets compare equal when only the
+	//rotation differs; the winding has to survive
+	multiset<tuple<uint32_t, uint32_t, uint32_t>> triangle_set(const vector<uint32_t>& indices) {
+		multiset<tuple<uint32_t, uint32_t, uint32_t>> t;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			if (b < a && b < c) t.insert(make_tuple(b, c, a));
+			else if (c < a && c < b) t.insert(make_tuple(c, a, b));
+			else t.insert(make_tuple(a, b, c));
+		}
+		return t;
+	}
+}
+
+TEST(mesh_codec_round_trip) {
+	vector<mesh_data> meshes;
+	meshes.push_back(optimized_sphere(300, 200));
+	meshes.push_back(generate_sphere_mesh(1.f, 7, 5));	//not reordered, and a partial vertex block
+	meshes.push_back(generate_cube_mesh(XMFLOAT3(1.f, 2.f, 3.f)));
+	meshes.push_back(generate_plane_mesh(XMFLOAT2(4.f, 4.f), XMFLOAT2(33.f, 9.f)));
+	meshes.push_back(mesh_data());
+	for (auto& D : meshes) {
+		vector<uint8_t> blob = encode_mesh(D);
+		mesh_data R;
+		CHECK(decode_mesh(blob.data(), blob.size(), R));
+		CHECK(get<0>(R).size() == get<0>(D).size());
+		CHECK(get<0>(R).empty() || memcmp(get<0>(R).data(), get<0>(D).data(), get<0>(D).size() * sizeof(vertex)) == 0);
+		CHECK(triangle_set(get<1>(R)) == triangle_set(get<1>(D)));
+	}
+	//a reordered mesh has to compress well below its raw size
+	auto& big = meshes[0];
+	size_t raw = get<0>(big).size() * sizeof(vertex) + get<1>(big).size() * sizeof(uint32_t);
+	CHECK(encode_mesh(big).size() * 2 < raw);
+}
+
+TEST(vertex_codec_strides) {
+	//strides below, at and between multiples of the 16 byte transpose, over full and partial blocks
+	size_t strides[] = { 1, 4, 12, 16, 20, 44, 64, 67 };
+	for (size_t stride : strides) {
+		for (size_t count : { (size_t)1, (size_t)255, (size_t)256, (size_t)1000 }) {
+			vector<uint8_t> v(stride * count);
+			for (size_t i = 0; i < v.size(); ++i) v[i] = (uint8_t)((i * 2654435761u) >> (i % 3 == 0 ? 28 : 8));
+			vector<uint8_t> blob;
+			encode_vertex_buffer(v.data(), count, stride, blob);
+			//one byte of slack behind the buffer catches writes past the last vertex
+			vector<uint8_t> r(v.size() + 1, 0xcd);
+			CHECK(decode_vertex_buffer(blob.data(), blob.size(), r.data(), count, stride));
+			CHECK(memcmp(r.data(), v.data(), v.size()) == 0);
+			CHECK(r.back() == 0xcd);
+		}
+	}
+}
+
+TEST(mesh_codec_rejects_corrupt_streams) {
+	mesh_data D = optimized_sphere(64, 32);
+	vector<uint8_t> blob = encode_mesh(D);
+	mesh_data R;
+
+	//every truncation fails
+	for (size_t size = 0; size < blob.size(); size += 1 + size / 8) CHECK(!decode_mesh(blob.data(), size, R));
+
+	//counts no payload could hold fail before anything is allocated for them
+	for (uint32_t field : { 2u, 4u }) {
+		vector<uint8_t> bad = blob;
+		uint32_t huge = 0xfffffff0u;
+		memcpy(&bad[field * sizeof(uint32_t)], &huge, sizeof(huge));
+		CHECK(!decode_mesh(bad.data(), bad.size(), R));
+	}
+
+	//indices past the vertices fail, whether the index or the vertex count is what is wrong
+	vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+	vector<uint8_t> stream;
+	encode_index_buffer(indices.data(), indices.size(), stream);
+	vector<uint32_t> out(indices.size());
+	CHECK(decode_index_buffer(stream.data(), stream.size(), out.data(), out.size(), 4));
+	CHECK(!decode_index_buffer(stream.data(), stream.size(), out.data(), out.size(), 3));
+	indices[4] = 1000;
+	stream.clear();
+	encode_index_buffer(indices.data(), indices.size(), stream);
+	CHECK(!decode_index_buffer(stream.data(), stream.size(), out.data(), out.size(), 4));
+
+	//flipped bytes either fail or still decode to indices that are in range
+	uint32_t state = 12345;
+	for (int trial = 0; trial < 2000; ++trial) {
+		vector<uint8_t> bad = blob;
+		state = state * 1664525u + 1013904223u;
+		bad[32 + state % (bad.size() - 32)] ^= (uint8_t)(1 + (state >> 24) % 255);
+		if (!decode_mesh(bad.data(), bad.size(), R)) continue;
+		bool in_range = true;
+		for (auto i : get<1>(R)) in_range = in_range && i < get<0>(R).size();
+		CHECK(in_range);
+	}
+}
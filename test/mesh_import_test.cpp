@@ -0,0 +1,96 @@
+#include "test.h"
+#include "dxut\mesh_import.h"
+#include <fstream>
+
+namespace {
+	//a quad at z = .5 facing +z, counter-clockwise seen from there, the way right-handed tools write it
+	const char quad_obj[] =
+		"v -1 -1 .5\nv 1 -1 .5\nv 1 1 .5\nv -1 1 .5\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+		"vn 0 0 1\n"
+		"f 1/1/1 2/2/1 3/3/1 4/4/1\n";
+
+	//the same quad as a .glb, with 16 bit indices after the positions and normals
+	void write_quad_glb(const wstring& path) {
+		float positions[] = { -1, -1, .5f, 1, -1, .5f, 1, 1, .5f, -1, 1, .5f };
+		float normals[] = { 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1 };
+		uint16_t indices[] = { 0, 1, 2, 0, 2, 3 };
+		vector<uint8_t> bin(sizeof(positions) + sizeof(normals) + sizeof(indices));
+		memcpy(bin.data(), positions, sizeof(positions));
+		memcpy(bin.data() + sizeof(positions), normals, sizeof(normals));
+		memcpy(bin.data() + sizeof(positions) + sizeof(normals), indices, sizeof(indices));
+		string json =
+			"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":108}],\"bufferViews\":["
+			"{\"buffer\":0,\"byteOffset\":0,\"byteLength\":48},{\"buffer\":0,\"byteOffset\":48,\"byteLength\":48},"
+			"{\"buffer\":0,\"byteOffset\":96,\"byteLength\":12}],"
+			"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+			"{\"bufferView\":1,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+			"{\"bufferView\":2,\"componentType\":5123,\"count\":6,\"type\":\"SCALAR\"}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2}]}],"
+			"\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}]}";
+		json.resize((json.size() + 3) & ~size_t(3), ' ');
+		bin.resize((bin.size() + 3) & ~size_t(3), 0);
+
+		uint32_t header[3] = { 0x46546c67, 2, (uint32_t)(12 + 8 + json.size() + 8 + bin.size()) };	//'glTF'
+		uint32_t json_chunk[2] = { (uint32_t)json.size(), 0x4e4f534a };
+		uint32_t bin_chunk[2] = { (uint32_t)bin.size(), 0x004e4942 };
+		ofstream out(path, ios::binary | ios::trunc);
+		out.write((const char*)header, sizeof(header));
+		out.write((const char*)json_chunk, sizeof(json_chunk));
+		out.write(json.data(), json.size());
+		out.write((const char*)bin_chunk, sizeof(bin_chunk));
+		out.write((const char*)bin.data(), bin.size());
+	}
+
+	//which side of each triangle its first normal is on: +1 or -1 for every triangle, 0 if they disagree. It
+	//does not change under a mirroring that also reverses the winding, which is what keeps front faces front
+	float winding_against_normals(const mesh_data& D) {
+		const auto& vertices = get<0>(D);
+		const auto& indices = get<1>(D);
+		float side = 0.f;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t]].position);
+			XMVECTOR e1 = XMLoadFloat3(&vertices[indices[t + 1]].position) - p0, e2 = XMLoadFloat3(&vertices[indices[t + 2]].position) - p0;
+			float s = XMVectorGetX(XMVector3Dot(XMVector3Cross(e1, e2), XMLoadFloat3(&vertices[indices[t]].normal))) > 0.f ? 1.f : -1.f;
+			if (t == 0) side = s;
+			else if (s != side) return 0.f;
+		}
+		return side;
+	}
+
+	//converted, the quad sits at z = -.5 facing -z; either way it is wound like generate_cube_mesh
+	void check_quad(const mesh_data& D, bool converted) {
+		float z = converted ? -1.f : 1.f;
+		CHECK(get<0>(D).size() == 4 && get<1>(D).size() == 6);
+		for (auto& v : get<0>(D)) CHECK(v.position.z == .5f * z && v.normal.z == z);
+		float library = winding_against_normals(generate_cube_mesh(XMFLOAT3(1.f, 1.f, 1.f)));
+		CHECK(library != 0.f);
+		CHECK(winding_against_normals(D) == library);
+	}
+}
+
+TEST(mesh_import_obj_handedness) {
+	mesh_data D = import_obj(quad_obj, sizeof(quad_obj) - 1);
+	check_quad(D, true);
+	CHECK((get<1>(D) == vector<uint32_t>{ 0, 2, 1, 0, 3, 2 }));
+
+	//without the conversion the quad is kept as written, fanned in file order
+	mesh_data R = import_obj(quad_obj, sizeof(quad_obj) - 1, false);
+	check_quad(R, false);
+	CHECK((get<1>(R) == vector<uint32_t>{ 0, 1, 2, 0, 2, 3 }));
+}
+
+TEST(mesh_import_gltf_handedness) {
+	wchar_t dir[MAX_PATH];
+	GetTempPathW(MAX_PATH, dir);
+	wstring path = wstring(dir) + L"dxut_test_mesh_import.glb";
+	write_quad_glb(path);
+	mesh_data D = import_gltf(path);
+	mesh_data R = import_gltf(path, false);
+	DeleteFileW(path.c_str());
+
+	check_quad(D, true);
+	CHECK((get<1>(D) == vector<uint32_t>{ 0, 2, 1, 0, 3, 2 }));
+	check_quad(R, false);
+	CHECK((get<1>(R) == vector<uint32_t>{ 0, 1, 2, 0, 2, 3 }));
+}
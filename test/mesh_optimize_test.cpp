@@ -0,0 +1,35 @@
+#include "test.h"
+#include "dxut\mesh_optimize.h"
+
+namespace {
+	//one triangle per x, each made of three copies of the same vertex
+	mesh_data copies_of(const vector<float>& xs) {
+		mesh_data D;
+		for (float x : xs) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				get<1>(D).push_back((uint32_t)get<0>(D).size());
+				get<0>(D).push_back(vertex(x, 1.f, 2.f, 0.f, 1.f, 0.f));
+			}
+		}
+		return D;
+	}
+}
+
+TEST(weld_far_and_invalid_values) {
+	//world space positions with a tiny epsilon are billions of cells out, past any 32 bit cell
+	weld_epsilon e;
+	e.position = 1e-6f;
+	float inf = numeric_limits<float>::infinity(), nan = numeric_limits<float>::quiet_NaN();
+	vector<float> xs = { 1e4f, 2e4f, -1e4f, 3e9f, 1e30f, 2e30f, inf, -inf, nan, 0.f, -0.f };
+	mesh_data D = copies_of(xs);
+	CHECK(weld_vertices(D, e) == 2 * xs.size() + 1);
+	CHECK(get<0>(D).size() == xs.size() - 1);
+	//every triangle collapsed onto its own vertex, and -0 onto 0
+	const auto& indices = get<1>(D);
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) CHECK(indices[t] == indices[t + 1] && indices[t] == indices[t + 2]);
+	CHECK(indices.back() == indices[indices.size() - 4]);
+
+	//a NaN and the NaN from another vertex are the same value to the weld
+	mesh_data N = copies_of({ nan, -nan });
+	CHECK(weld_vertices(N) == 5);
+}
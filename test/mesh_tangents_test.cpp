@@ -0,0 +1,62 @@
+#include "test.h"
+#include "dxut\mesh_tangents.h"
+
+namespace {
+	//two quads facing -z that share the column at x = 0, textured with u = |x|, so the left one is a mirror
+	//image of the right one; v grows downwards like the rest of the library's texcoords
+	mesh_data mirrored_quads() {
+		mesh_data D;
+		auto& vertices = get<0>(D);
+		for (float y : { 0.f, 1.f })
+			for (float x : { -1.f, 0.f, 1.f })
+				vertices.push_back(vertex(x, y, 0.f, 0.f, 0.f, -1.f, 0.f, 0.f, 0.f, fabsf(x), 1.f - y));
+		//bottom left, top left, top right and bottom left, top right, bottom right, wound like generate_cube_mesh
+		get<1>(D) = { 0, 3, 4, 0, 4, 1, 1, 4, 5, 1, 5, 2 };
+		return D;
+	}
+
+	XMVECTOR bitangent(const vertex& v, const XMFLOAT4& t) {
+		return XMVector3Cross(XMLoadFloat3(&v.normal), XMLoadFloat3(&v.tangent)) * t.w;
+	}
+
+	bool near(FXMVECTOR a, FXMVECTOR b) {
+		return XMVectorGetX(XMVector3LengthSq(a - b)) < 1e-10f;
+	}
+}
+
+TEST(tangents_match_authored_cube) {
+	//the cube's hand written tangents follow its texcoords, with no mirroring anywhere
+	mesh_data D = generate_cube_mesh(XMFLOAT3(1.f, 2.f, 3.f));
+	vector<vertex> authored = get<0>(D);
+	vector<XMFLOAT4> tangents;
+	CHECK(generate_tangents(D, tangents) == 0);
+	CHECK(tangents.size() == authored.size());
+	for (size_t v = 0; v < authored.size(); ++v) {
+		CHECK(near(XMLoadFloat3(&get<0>(D)[v].tangent), XMLoadFloat3(&authored[v].tangent)));
+		CHECK(tangents[v].w == 1.f);
+	}
+}
+
+TEST(tangents_split_mirrored_uvs) {
+	mesh_data D = mirrored_quads();
+	vector<XMFLOAT4> tangents;
+	//both vertices on the mirror line get a copy
+	CHECK(generate_tangents(D, tangents) == 2);
+	const auto& vertices = get<0>(D);
+	const auto& indices = get<1>(D);
+	CHECK(vertices.size() == 8 && tangents.size() == 8);
+	CHECK(indices.size() == 12);
+
+	for (size_t c = 0; c < indices.size(); ++c) {
+		uint32_t v = indices[c];
+		bool left = c < 6;
+		//u runs along -x on the left, so the frame is mirrored there and only there
+		CHECK(tangents[v].w == (left ? -1.f : 1.f));
+		CHECK(near(XMLoadFloat4(&tangents[v]), XMVectorSet(left ? -1.f : 1.f, 0.f, 0.f, tangents[v].w)));
+		//the bitangent follows +v, which is not mirrored, on both sides
+		CHECK(near(bitangent(vertices[v], tangents[v]), XMVectorSet(0.f, -1.f, 0.f, 0.f)));
+	}
+	//the copies are of the mirror line and belong to the right quad only
+	for (uint32_t v : { 6u, 7u }) CHECK(vertices[v].position.x == 0.f && tangents[v].w == 1.f);
+	for (size_t c = 0; c < 6; ++c) CHECK(indices[c] < 6);
+}
@@ -0,0 +1,130 @@
+#include "test.h"
+#include "dxut\occlusion.h"
+
+namespace {
+	struct occluder {
+		mesh_data D;
+		XMMATRIX world;
+	};
+
+	//a sphere partly in front of a rotated cube, both in front of a tilted ground sheet that reaches past the
+	//edges of the view; nothing crosses the near plane, so the reference needs no clipping
+	vector<occluder> test_scene() {
+		vector<occluder> scene;
+		scene.push_back({ generate_sphere_mesh(2.f, 48, 24), XMMatrixTranslation(.5f, 0.f, 8.f) });
+		scene.push_back({ generate_cube_mesh(XMFLOAT3(1.f, 1.5f, 1.f)),
+			XMMatrixRotationRollPitchYaw(.4f, .7f, .1f) * XMMatrixTranslation(-2.f, 1.f, 9.f) });
+		scene.push_back({ generate_plane_mesh(XMFLOAT2(24.f, 60.f), XMFLOAT2(8.f, 8.f), XMFLOAT3(0.f, 1.f, -.4f)),
+			XMMatrixTranslation(0.f, -2.f, 20.f) });
+		return scene;
+	}
+
+	XMMATRIX test_view_projection() {
+		XMMATRIX view = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.f, 0.f, 1.f, 0.f), XMVectorSet(0.f, 1.f, 0.f, 0.f));
+		return view * XMMatrixPerspectiveFovLH(XMConvertToRadians(60.f), 2.f, .5f, 100.f);
+	}
+
+	//nearest depth at every pixel center in double precision, once with every triangle shrunk by slack pixels
+	//and once with it grown by as much; any rasterizer that samples pixel centers in float lies in between
+	struct reference_depth {
+		vector<double> tight, loose;
+	};
+
+	reference_depth reference_rasterize(const vector<occluder>& scene, FXMMATRIX view_projection, uint32_t w, uint32_t h, double slack) {
+		reference_depth ref;
+		ref.tight.assign((size_t)w * h, 1.);
+		ref.loose.assign((size_t)w * h, 1.);
+		for (const auto& o : scene) {
+			XMMATRIX m = o.world * view_projection;
+			const auto& vertices = get<0>(o.D);
+			const auto& indices = get<1>(o.D);
+			for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+				double sx[3], sy[3], sz[3];
+				for (uint32_t k = 0; k < 3; ++k) {
+					XMFLOAT4 c;
+					XMStoreFloat4(&c, XMVector3Transform(XMLoadFloat3(&vertices[indices[t + k]].position), m));
+					sx[k] = ((double)c.x / c.w * .5 + .5) * w;
+					sy[k] = (.5 - (double)c.y / c.w * .5) * h;
+					sz[k] = (double)c.z / c.w;
+				}
+				double area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+				if (fabs(area) < 1e-8) continue;
+				double sign = area > 0. ? 1. : -1.;
+
+				int32_t x0 = max((int32_t)floor(min(min(sx[0], sx[1]), sx[2]) - 1.), 0);
+				int32_t x1 = min((int32_t)ceil(max(max(sx[0], sx[1]), sx[2]) + 1.), (int32_t)w - 1);
+				int32_t y0 = max((int32_t)floor(min(min(sy[0], sy[1]), sy[2]) - 1.), 0);
+				int32_t y1 = min((int32_t)ceil(max(max(sy[0], sy[1]), sy[2]) + 1.), (int32_t)h - 1);
+				for (int32_t y = y0; y <= y1; ++y) {
+					for (int32_t x = x0; x <= x1; ++x) {
+						double px = x + .5, py = y + .5;
+						//distance of the center to each edge in pixels, positive inside
+						double nearest_edge = DBL_MAX;
+						for (uint32_t k = 0; k < 3; ++k) {
+							uint32_t j = (k + 1) % 3;
+							double ex = sx[j] - sx[k], ey = sy[j] - sy[k];
+							double d = (ex * (py - sy[k]) - ey * (px - sx[k])) * sign / sqrt(ex * ex + ey * ey);
+							nearest_edge = min(nearest_edge, d);
+						}
+						if (nearest_edge < -slack) continue;
+						double b1 = ((px - sx[0]) * (sy[2] - sy[0]) - (py - sy[0]) * (sx[2] - sx[0])) / area;
+						double b2 = ((sx[1] - sx[0]) * (py - sy[0]) - (sy[1] - sy[0]) * (px - sx[0])) / area;
+						double z = sz[0] + b1 * (sz[1] - sz[0]) + b2 * (sz[2] - sz[0]);
+						size_t i = (size_t)y * w + x;
+						ref.loose[i] = min(ref.loose[i], z);
+						if (nearest_edge >= slack) ref.tight[i] = min(ref.tight[i], z);
+					}
+				}
+			}
+		}
+		return ref;
+	}
+}
+
+TEST(occlusion_depth_matches_reference) {
+	XMMATRIX vp = test_view_projection();
+	vector<occluder> scene = test_scene();
+	occlusion_buffer buffer(256, 128);
+	buffer.clear(vp);
+	for (const auto& o : scene) buffer.add_occluder(o.D, o.world);
+	buffer.rasterize();
+
+	uint32_t w = buffer.width(), h = buffer.height();
+	reference_depth ref = reference_rasterize(scene, vp, w, h, 1e-2);
+	const double depth_tolerance = 1e-5;
+	size_t wrong = 0, covered = 0;
+	for (size_t i = 0; i < (size_t)w * h; ++i) {
+		double d = buffer.depth()[i];
+		bool ok = ref.loose[i] == 1. ? d == 1. : (d >= ref.loose[i] - depth_tolerance && d <= ref.tight[i] + depth_tolerance);
+		if (!ok) wrong++;
+		if (d < 1.) covered++;
+	}
+	CHECK(wrong == 0);
+	//the scene is not trivially empty or full
+	CHECK(covered > (size_t)w * h / 4 && covered < (size_t)w * h);
+}
+
+TEST(occlusion_box_tests) {
+	XMMATRIX vp = test_view_projection();
+	occlusion_buffer buffer(256, 128);
+	buffer.clear(vp);
+	for (const auto& o : test_scene()) buffer.add_occluder(o.D, o.world);
+	buffer.rasterize();
+
+	BoundingBox behind_sphere(XMFLOAT3(.5f, 0.f, 12.f), XMFLOAT3(.3f, .3f, .3f));
+	BoundingBox before_sphere(XMFLOAT3(.5f, 0.f, 4.f), XMFLOAT3(.3f, .3f, .3f));
+	BoundingBox above_ground(XMFLOAT3(6.f, 4.f, 12.f), XMFLOAT3(.3f, .3f, .3f));
+	BoundingBox under_ground(XMFLOAT3(0.f, -8.f, 30.f), XMFLOAT3(1.f, 1.f, 1.f));
+	BoundingBox across_near(XMFLOAT3(0.f, 0.f, .5f), XMFLOAT3(.2f, .2f, .2f));
+	CHECK(!buffer.visible(behind_sphere));
+	CHECK(buffer.visible(before_sphere));
+	CHECK(buffer.visible(above_ground));
+	CHECK(!buffer.visible(under_ground));
+	CHECK(buffer.visible(across_near));
+
+	box_bounds_soa boxes;
+	for (auto& b : { behind_sphere, before_sphere, above_ground, under_ground, across_near }) boxes.push_back(b);
+	vector<uint32_t> indices = { 0, 1, 2, 3, 4 };
+	CHECK(buffer.filter(boxes, indices) == 3);
+	CHECK((indices == vector<uint32_t>{ 1, 2, 4 }));
+}
@@ -0,0 +1,107 @@
+#include "test.h"
+#include "dxut\range_allocator.h"
+#include <random>
+
+namespace {
+	//what the allocator should look like: the live ranges and the capacity, from which the free ranges follow
+	struct reference_ranges {
+		map<uint64_t, uint64_t> live;	//offset -> size
+		uint64_t capacity;
+
+		vector<pair<uint64_t, uint64_t>> free_ranges() const {
+			vector<pair<uint64_t, uint64_t>> gaps;
+			uint64_t at = 0;
+			for (auto& r : live) {
+				if (r.first > at) gaps.push_back({ at, r.first - at });
+				at = r.first + r.second;
+			}
+			if (at < capacity) gaps.push_back({ at, capacity - at });
+			return gaps;
+		}
+	};
+
+	//free ranges are fully coalesced, so their count, the largest and the total follow from the live ranges
+	void check_matches(const range_allocator& a, const reference_ranges& ref) {
+		auto gaps = ref.free_ranges();
+		uint64_t used = 0, largest = 0;
+		for (auto& r : ref.live) used += r.second;
+		for (auto& g : gaps) largest = max(largest, g.second);
+		CHECK(a.capacity() == ref.capacity);
+		CHECK(a.used() == used);
+		CHECK(a.allocation_count() == ref.live.size());
+		CHECK(a.free_range_count() == gaps.size());
+		CHECK(a.largest_free() == largest);
+	}
+}
+
+TEST(range_allocator_random_operations) {
+	mt19937 rng(3);
+	range_allocator a(1000);
+	reference_ranges ref = { {}, 1000 };
+
+	for (int step = 0; step < 20000; ++step) {
+		uint32_t op = rng() % 100;
+		if (op < 55) {
+			uint64_t size = 1 + rng() % 40;
+			uint64_t offset = a.allocate(size);
+			//best fit: the smallest free range that is large enough, or none at all
+			auto gaps = ref.free_ranges();
+			uint64_t best = range_allocator::invalid;
+			for (auto& g : gaps) if (g.second >= size) best = min(best, g.second);
+			if (best == range_allocator::invalid) CHECK(offset == range_allocator::invalid);
+			else {
+				bool from_best_gap = false;
+				for (auto& g : gaps) from_best_gap = from_best_gap || (g.second == best && offset == g.first);
+				CHECK(from_best_gap);
+				ref.live[offset] = size;
+			}
+		} else if (op < 95) {
+			if (ref.live.empty()) continue;
+			auto it = ref.live.begin();
+			advance(it, rng() % ref.live.size());
+			a.release(it->first);
+			ref.live.erase(it);
+		} else if (op < 97) {
+			ref.capacity += rng() % 200;
+			a.grow(ref.capacity);
+		} else {
+			vector<range_allocator::relocation> moves = a.defragment();
+			CHECK(moves.size() == ref.live.size());
+			//ascending and packed from 0, so a front to back copy never overwrites a range it has yet to read
+			map<uint64_t, uint64_t> packed;
+			uint64_t at = 0;
+			auto r = ref.live.begin();
+			for (auto& m : moves) {
+				CHECK(r != ref.live.end() && m.from == r->first && m.size == r->second);
+				CHECK(m.to == at && m.to <= m.from);
+				packed[m.to] = m.size;
+				at += m.size;
+				++r;
+			}
+			ref.live = move(packed);
+			CHECK(a.free_range_count() <= 1);
+		}
+		check_matches(a, ref);
+	}
+}
+
+TEST(range_allocator_coalescing) {
+	range_allocator a(100);
+	uint64_t r0 = a.allocate(10), r1 = a.allocate(10), r2 = a.allocate(10);
+	CHECK(r0 == 0 && r1 == 10 && r2 == 20);
+	CHECK(a.free_range_count() == 1 && a.largest_free() == 70);
+	//a hole, then its left and right neighbours join it one at a time
+	a.release(r1);
+	CHECK(a.free_range_count() == 2 && a.largest_free() == 70);
+	a.release(r0);
+	CHECK(a.free_range_count() == 2 && a.largest_free() == 70);
+	a.release(r2);
+	CHECK(a.free_range_count() == 1 && a.largest_free() == 100 && a.used() == 0);
+
+	//growing extends a free tail instead of adding a range next to it
+	range_allocator b(10);
+	CHECK(b.allocate(4) == 0);
+	b.grow(20);
+	CHECK(b.free_range_count() == 1 && b.largest_free() == 16);
+	CHECK(b.allocate(0) == range_allocator::invalid && b.allocate(17) == range_allocator::invalid);
+}
@@ -0,0 +1,72 @@
+#include "test.h"
+#include "dxut\skinning.h"
+#include "dxut\cpu_features.h"
+#include <random>
+
+namespace {
+	//scaled rotations with translations, and vertices on four random bones each
+	void test_rig(vector<XMFLOAT4X4>& bones, vector<skinned_vertex>& vertices) {
+		mt19937 rng(5);
+		uniform_real_distribution<float> u(-1.f, 1.f);
+		bones.resize(32);
+		for (auto& b : bones) {
+			XMVECTOR q = XMQuaternionNormalize(XMVectorSet(u(rng), u(rng), u(rng), u(rng)));
+			float s = 1.f + fabsf(u(rng));
+			XMStoreFloat4x4(&b, XMMatrixScaling(s, s, s) * XMMatrixRotationQuaternion(q) * XMMatrixTranslation(u(rng), u(rng), u(rng)));
+		}
+		vertices.resize(5000);
+		for (auto& v : vertices) {
+			XMVECTOR n = XMVector3Normalize(XMVectorSet(u(rng), u(rng), u(rng), 0.f));
+			vertex base(u(rng), u(rng), u(rng), 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, u(rng), u(rng));
+			XMStoreFloat3(&base.normal, n);
+			XMStoreFloat3(&base.tangent, XMVector3Normalize(XMVector3Cross(n, XMVectorSet(1.f, 0.f, 0.f, 0.f))));
+			uint8_t b[4];
+			float w[4], sum = 0.f;
+			for (uint32_t k = 0; k < 4; ++k) {
+				b[k] = (uint8_t)(rng() % bones.size());
+				sum += w[k] = fabsf(u(rng)) + .01f;
+			}
+			v = skinned_vertex(base, b, XMFLOAT4(w[0] / sum, w[1] / sum, w[2] / sum, w[3] / sum));
+		}
+		//degenerate frames, as importers leave them on points and lines
+		vertices[0].normal = XMFLOAT3(0.f, 0.f, 0.f);
+		vertices[1].tangent = XMFLOAT3(0.f, 0.f, 0.f);
+	}
+
+	bool finite(const vertex& v) {
+		const float* f = &v.position.x;
+		for (uint32_t k = 0; k < sizeof(vertex) / sizeof(float); ++k)
+			if (!isfinite(f[k])) return false;
+		return true;
+	}
+}
+
+TEST(skinning_levels_agree) {
+	vector<XMFLOAT4X4> bones;
+	vector<skinned_vertex> vertices;
+	test_rig(bones, vertices);
+	simd_level initial = max_simd_level();
+
+	set_max_simd_level(simd_level::scalar);
+	vector<vertex> reference;
+	skin_vertices(vertices, bones, reference);
+	set_max_simd_level(simd_level::avx512);
+	vector<vertex> fast;
+	skin_vertices(vertices, bones, fast);
+	set_max_simd_level(initial);
+
+	CHECK(fast.size() == vertices.size());
+	float largest = 0.f;
+	for (size_t i = 0; i < fast.size(); ++i) {
+		CHECK(finite(fast[i]) && finite(reference[i]));
+		const float* a = &reference[i].position.x;
+		const float* b = &fast[i].position.x;
+		for (uint32_t k = 0; k < sizeof(vertex) / sizeof(float); ++k) largest = max(largest, fabsf(a[k] - b[k]));
+	}
+	CHECK(largest < 1e-5f);
+	//a zero normal or tangent is skinned to zero on every path
+	for (auto* out : { &reference, &fast }) {
+		CHECK(XMVector3Equal(XMLoadFloat3(&(*out)[0].normal), XMVectorZero()));
+		CHECK(XMVector3Equal(XMLoadFloat3(&(*out)[1].tangent), XMVectorZero()));
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "dxut\cmmn.h"
+#include <cstdio>
+
+//CPU-only tests of the library; none of them creates a device, so they run on any machine the library
+//builds on. Each file in test/ adds its cases with TEST, and the executable runs every case whose name
+//contains the first command line argument (all of them without one); it returns the number of cases
+//that failed
+typedef void(*test_function)();
+void register_test(const char* name, test_function f);
+
+struct test_registration {
+	test_registration(const char* name, test_function f) { register_test(name, f); }
+};
+
+#define TEST(name) \
+	static void name(); \
+	static test_registration name##_registration(#name, name); \
+	static void name()
+
+//records a failure of the running case and carries on with it
+void test_failure(const char* file, int line, const char* expression);
+#define CHECK(e) ((e) ? (void)0 : test_failure(__FILE__, __LINE__, #e))
@@ -0,0 +1,58 @@
+#include "test.h"
+#include "dxut\transform.h"
+#include "dxut\cpu_features.h"
+#include <random>
+
+namespace {
+	vector<simd_level> supported_levels() {
+		const cpu_features& f = get_cpu_features();
+		vector<simd_level> levels = { simd_level::scalar, simd_level::sse };
+		if (f.avx2 && f.fma) levels.push_back(simd_level::avx2);
+		if (f.avx512f && f.avx2 && f.fma) levels.push_back(simd_level::avx512);
+		return levels;
+	}
+
+	bool near(const float* a, const float* b, size_t count) {
+		for (size_t i = 0; i < count; ++i)
+			if (fabsf(a[i] - b[i]) > 1e-5f * max(1.f, fabsf(b[i]))) return false;
+		return true;
+	}
+}
+
+TEST(transform_levels_agree) {
+	//an odd count, so every kernel runs into a tail, and vertices in place so neighbouring fields are in reach
+	const size_t count = 4096 + 7;
+	mt19937 rng(5);
+	uniform_real_distribution<float> u(-2.f, 2.f);
+	vector<vertex> vertices(count);
+	for (auto& v : vertices) v = vertex(u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng), u(rng));
+	vertices[3].normal = XMFLOAT3(0.f, 0.f, 0.f);
+	vector<XMFLOAT4X4> worlds(count);
+	for (auto& w : worlds) XMStoreFloat4x4(&w, XMMatrixRotationRollPitchYaw(u(rng), u(rng), u(rng)) * XMMatrixTranslation(u(rng), u(rng), u(rng)));
+	XMMATRIX m = XMMatrixScaling(1.f, 2.f, .5f) * XMMatrixRotationRollPitchYaw(.3f, -.7f, 1.1f) * XMMatrixTranslation(4.f, -1.f, 2.f);
+
+	simd_level initial = max_simd_level();
+	vector<vertex> reference;
+	vector<XMFLOAT4X4> reference_matrices;
+	for (simd_level level : supported_levels()) {
+		set_max_simd_level(level);
+		vector<vertex> out = vertices;
+		transform_points(&vertices[0].position, sizeof(vertex), count, m, &out[0].position, sizeof(vertex));
+		transform_normals(&out[0].normal, sizeof(vertex), count, m, &out[0].normal, sizeof(vertex));
+		vector<XMFLOAT4X4> matrices(count);
+		multiply_matrices(worlds.data(), sizeof(XMFLOAT4X4), count, m, matrices.data(), sizeof(XMFLOAT4X4), true);
+		//the texcoords and tangents between the transformed fields are left alone, and zero normals stay zero
+		for (size_t i = 0; i < count; ++i)
+			CHECK(!memcmp(&out[i].texcoord, &vertices[i].texcoord, sizeof(vertex) - offsetof(vertex, texcoord)));
+		CHECK(out[3].normal.x == 0.f && out[3].normal.y == 0.f && out[3].normal.z == 0.f);
+
+		if (reference.empty()) {
+			reference = out;
+			reference_matrices = matrices;
+			continue;
+		}
+		CHECK(near(&out[0].position.x, &reference[0].position.x, count * sizeof(vertex) / sizeof(float)));
+		CHECK(near(&matrices[0]._11, &reference_matrices[0]._11, count * 16));
+	}
+	set_max_simd_level(initial);
+}
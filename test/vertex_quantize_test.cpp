@@ -0,0 +1,117 @@
+#include "test.h"
+#include "dxut\vertex_quantize.h"
+
+namespace {
+	vector<mesh_data> test_meshes() {
+		vector<mesh_data> meshes;
+		meshes.push_back(generate_sphere_mesh(3.f, 96, 48));
+		meshes.push_back(generate_cube_mesh(XMFLOAT3(1.f, 20.f, .25f)));
+		meshes.push_back(generate_plane_mesh(XMFLOAT2(50.f, 8.f), XMFLOAT2(64.f, 17.f), XMFLOAT3(.3f, .8f, -.5f)));
+		return meshes;
+	}
+
+	float angle_between(const XMFLOAT3& a, const XMFLOAT3& b) {
+		//acos of the dot product has no resolution left for the small angles of 16 bit encodings
+		XMVECTOR u = XMVector3Normalize(XMLoadFloat3(&a)), v = XMVector3Normalize(XMLoadFloat3(&b));
+		return atan2f(XMVectorGetX(XMVector3Length(XMVector3Cross(u, v))), XMVectorGetX(XMVector3Dot(u, v)));
+	}
+
+	//quantizes every test mesh with opt, decodes every vertex again and checks each attribute against the
+	//bound its encoding guarantees; frame_tolerance is the largest angle a decoded normal or tangent may be off
+	void round_trip(const quantize_options& opt, float frame_tolerance) {
+		for (auto& D : test_meshes()) {
+			const auto& vertices = get<0>(D);
+			quantized_vertex_stream s = quantize_vertices(D, opt);
+			CHECK(s.vertex_count == vertices.size());
+			CHECK(s.data.size() == s.vertex_count * s.stride);
+			if (opt.position_unorm16 && opt.octahedral_frame && opt.half_texcoords) CHECK(2 * s.stride < sizeof(vertex));
+
+			XMFLOAT3 lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (auto& v : vertices) {
+				lo = XMFLOAT3(min(lo.x, v.position.x), min(lo.y, v.position.y), min(lo.z, v.position.z));
+				hi = XMFLOAT3(max(hi.x, v.position.x), max(hi.y, v.position.y), max(hi.z, v.position.z));
+			}
+			//half a step of the 16 bit grid over the box, plus float rounding of the decode
+			float step[3] = { (hi.x - lo.x) / 65535.f, (hi.y - lo.y) / 65535.f, (hi.z - lo.z) / 65535.f };
+
+			for (size_t i = 0; i < vertices.size(); ++i) {
+				const vertex& a = vertices[i];
+				vertex b = dequantize_vertex(s, i);
+
+				const float* pa = &a.position.x;
+				const float* pb = &b.position.x;
+				for (uint32_t k = 0; k < 3; ++k) {
+					float bound = opt.position_unorm16 ? .5f * step[k] + 1e-6f * (fabsf(pa[k]) + step[k] * 65535.f) : 0.f;
+					CHECK(fabsf(pa[k] - pb[k]) <= bound);
+				}
+
+				//half floats keep 11 significant bits
+				float uv_bound[2] = {
+					opt.half_texcoords ? fabsf(a.texcoord.x) * (1.f / 2048.f) + 1e-7f : 0.f,
+					opt.half_texcoords ? fabsf(a.texcoord.y) * (1.f / 2048.f) + 1e-7f : 0.f };
+				CHECK(fabsf(a.texcoord.x - b.texcoord.x) <= uv_bound[0]);
+				CHECK(fabsf(a.texcoord.y - b.texcoord.y) <= uv_bound[1]);
+
+				if (opt.octahedral_frame) {
+					CHECK(angle_between(a.normal, b.normal) <= frame_tolerance);
+					CHECK(angle_between(a.tangent, b.tangent) <= frame_tolerance);
+				} else {
+					CHECK(memcmp(&a.normal, &b.normal, sizeof(XMFLOAT3)) == 0);
+					CHECK(memcmp(&a.tangent, &b.tangent, sizeof(XMFLOAT3)) == 0);
+				}
+			}
+		}
+	}
+}
+
+TEST(quantize_round_trip_16bit_frame) {
+	round_trip(quantize_options(), 1e-4f);
+}
+
+TEST(quantize_round_trip_8bit_frame) {
+	quantize_options opt;
+	opt.frame_bits = 8;
+	round_trip(opt, .02f);
+}
+
+TEST(quantize_round_trip_full_precision) {
+	quantize_options opt;
+	opt.position_unorm16 = false;
+	opt.octahedral_frame = false;
+	opt.half_texcoords = false;
+	round_trip(opt, 0.f);
+}
+
+TEST(quantized_stream_bounds) {
+	quantize_options full;
+	full.position_unorm16 = false;
+	for (auto& opt : { quantize_options(), full }) {
+		for (auto& D : test_meshes()) {
+			quantized_vertex_stream s = quantize_vertices(D, opt);
+			BoundingBox box;
+			BoundingSphere sphere;
+			compute_bounds(s, box, sphere);
+			XMVECTOR lo = XMLoadFloat3(&box.Center) - XMLoadFloat3(&box.Extents), hi = XMLoadFloat3(&box.Center) + XMLoadFloat3(&box.Extents);
+			float slack = 1e-5f * (1.f + XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.Extents))));
+			for (size_t i = 0; i < s.vertex_count; ++i) {
+				vertex v = dequantize_vertex(s, i);
+				XMVECTOR p = XMLoadFloat3(&v.position);
+				CHECK(XMVector3LessOrEqual(lo - XMVectorReplicate(slack), p) && XMVector3LessOrEqual(p, hi + XMVectorReplicate(slack)));
+				CHECK(XMVectorGetX(XMVector3Length(p - XMLoadFloat3(&sphere.Center))) <= sphere.Radius + slack);
+			}
+		}
+	}
+}
+
+TEST(octahedral_axes_and_signs) {
+	//the fold has to pick the same side for components that are exactly zero as the shader does
+	XMVECTOR axes[] = {
+		XMVectorSet(1, 0, 0, 0), XMVectorSet(-1, 0, 0, 0), XMVectorSet(0, 1, 0, 0), XMVectorSet(0, -1, 0, 0),
+		XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 0, -1, 0), XMVectorSet(0, 1, -1, 0), XMVectorSet(-1, 0, -1, 0),
+	};
+	for (auto& n : axes) {
+		XMVECTOR d = octahedral_decode(octahedral_encode(n));
+		CHECK(XMVectorGetX(XMVector3Length(d - XMVector3Normalize(n))) < 1e-6f);
+	}
+	CHECK(XMVectorGetX(XMVector3Length(octahedral_decode(octahedral_encode(XMVectorZero())) - XMVectorSet(0, 0, 1, 0))) < 1e-6f);
+}